@@ -8,6 +8,7 @@
 #include <vector>
 #include <iostream>
 #include <sstream>
+#include <fstream>
 #include <random>
 
 #include <cstdio>
@@ -62,12 +63,15 @@ const char* scheduler_sampler_fuc_str[] = {
     "pndm",
     "ipndm",
     "deis_m",
+    "adaptive",
 };
 
 // below order match AvailableSigmaType order
 const char* scheduler_sigma_type_str[] = {
     "default",
     "karras",
+    "ays_sd15",
+    "ays_sdxl",
 };
 
 // below order match AvailablePredictionType order
@@ -76,6 +80,21 @@ const char* tokenizer_series_str[] = {
     "word_piece",
 };
 
+// below order match AvailablePrecisionType order
+const char* precision_type_str[] = {
+    "auto",
+    "fp32",
+    "fp16",
+    "int8",
+};
+
+// below order match AvailableGuidanceScheduleType order
+const char* guidance_schedule_str[] = {
+    "constant",
+    "linear",
+    "cosine",
+};
+
 // below order match AvailableExecutionType order
 const char* type_str[] = {
     "cpu",
@@ -125,11 +144,13 @@ struct CommandLineInput {
     AvailableBetaType scheduler_beta_type = BETA_TYPE_LINEAR;               // Scheduler: Beta Style (Linear. ScaleLinear, CAP_V2)
     AvailableAlphaType scheduler_alpha_type = ALPHA_TYPE_COSINE;            // Scheduler: Alpha(Beta) Method (Cos, Exp)
     AvailablePredictionType scheduler_predict_type = PREDICT_TYPE_EPSILON;  // Scheduler: Prediction Style (Epsilon, V_Pred, Sample)
-    AvailableSigmaType scheduler_sigma_type = SIGMA_TYPE_DEFAULT;           // Scheduler: Sigma Schedule Style (Default, Karras)
+    AvailableSigmaType scheduler_sigma_type = SIGMA_TYPE_DEFAULT;           // Scheduler: Sigma Schedule Style (Default, Karras, AYS)
+    float scheduler_tolerance = 0.05f;                                      // Scheduler: relative error tolerance (only for adaptive)
 
-    AvailableTokenizerType sd_tokenizer_type = AVAILABLE_TOKENIZER_BPE;     // Tokenizer: tokenizer type (currently only provide BPE)
+    AvailableTokenizerType sd_tokenizer_type = AVAILABLE_TOKENIZER_BPE;     // Tokenizer: tokenizer type (BPE for CLIP, WordPiece for BERT-style encoders)
     std::string tokenizer_dictionary_at;                                    // Tokenizer: vocabulary lib <one vocab per line, row treate as index>
     std::string tokenizer_aggregates_at;                                    // Tokenizer: merges file <one merge-pair per line, currently only for BPE>
+    std::string tokenizer_compile_at;                                       // Tokenizer: write --dict / --merges as a compiled *.adtk asset and exit
     int32_t avail_token_count = 49408;                                      // Tokenizer: all available token in vocabulary totally
     int32_t avail_token_size = 77;                                          // Tokenizer: max token length (include <start> & <end>, so 75 avail)
     int32_t major_hidden_dim = 768;                                         // Tokenizer: out token length
@@ -144,6 +165,27 @@ struct CommandLineInput {
     float sd_scale_guidance = 7.5f;                                         // Infer_Major: immersion rate for [value * (Positive - Negative)] residual
     float sd_random_intensity = 1.0f;                                       // Infer_Major: random intensity for in stepping noise Add (only avail when method supported)
     float sd_decode_scale_strength = 0.18215f;                              // Infer_Major: for VAE Decoding result merged (Recommend 0.18215f)
+    float sd_img2img_strength = 1.0f;                                       // Infer_Major: img2img denoise strength, runs only this fraction of the steps
+    float sd_guidance_start = 0.0f;                                         // Guidance: fraction of steps where CFG starts
+    float sd_guidance_end = 1.0f;                                           // Guidance: fraction of steps where CFG ends
+    AvailableGuidanceScheduleType sd_guidance_schedule = AVAILABLE_GUIDANCE_CONSTANT;   // Guidance: scale inside the window (constant, linear, cosine)
+
+    AvailablePrecisionType sd_clip_precision = AVAILABLE_PRECISION_AUTO;    // Precision: CLIP model precision (auto, fp32, fp16, int8)
+    AvailablePrecisionType sd_unet_precision = AVAILABLE_PRECISION_AUTO;    // Precision: UNet model precision (auto, fp32, fp16, int8)
+    AvailablePrecisionType sd_vae_precision = AVAILABLE_PRECISION_AUTO;     // Precision: VAE model precision (auto, fp32, fp16, int8)
+    std::string sd_calibration_dump_at;                                     // Calibration: dir to dump CLIP/UNet inputs as .npy (empty: off)
+    std::string sd_embedding_bank_at;                                       // Conditioning: precompiled prompt-embedding bank (empty: off)
+    std::string bank_compile_at;                                            // Conditioning: encode --bank-prompts into a *.adeb bank and exit
+    std::string bank_prompts_at;                                            // Conditioning: prompt catalog for --compile-bank, one prompt per line
+
+    std::string snapshot_path;                                              // Snapshot: file for the trajectory state (empty: off)
+    uint64_t snapshot_step = 0;                                             // Snapshot: written before this UNet step
+    bool snapshot_stop = false;                                             // Snapshot: end the run once written, no image
+    std::string resume_path;                                                // Resume: continue this snapshot instead of a fresh run
+    int64_t resume_seed = -1;                                               // Resume: seed for the remaining noise (-1: snapshot's)
+    float resume_guidance = 0.0f;                                           // Resume: guidance of the remaining steps (0: snapshot's)
+    uint64_t resume_steps = 0;                                              // Resume: re-grid the rest to this step count (0: snapshot's)
+    bool resume_prompt = false;                                             // Resume: condition on -p / -n instead of the snapshot's prompts
 
     bool verbose = false;  // CLI-Mark: for extra infos of this tools
 };
@@ -209,6 +251,7 @@ void print_params(const CommandLineInput& params) {
     printf("    safty_path:                     %s\n", params.onnx_safty_path.c_str());
     printf("    dictionary_path:                %s\n", params.tokenizer_dictionary_at.c_str());
     printf("    mergesfile_path:                %s\n", params.tokenizer_aggregates_at.c_str());
+    printf("    tokenizer_compile_at:           %s\n", params.tokenizer_compile_at.c_str());
 
     printf("  Major  (by User   [necessary]): \n");
     printf("    current OrtSD mode:             %s\n"  , modes_str[params.mode]);
@@ -220,6 +263,8 @@ void print_params(const CommandLineInput& params) {
     printf("    guidance_factor (UNet):         %.6f\n", params.sd_scale_guidance);
     printf("    decoding_factor (VAE):          %.6f\n", params.sd_decode_scale_strength);
     printf("    strength_factor (Hyper):        %.6f\n", params.sd_random_intensity);
+    printf("    img2img_strength:               %.6f\n", params.sd_img2img_strength);
+    printf("    guidance_window:                [%.4f, %.4f)\n", params.sd_guidance_start, params.sd_guidance_end);
     printf("    inference steps:                %llu\n", params.sd_inference_steps);
 
     printf("  Types  (by User   [maintain]): \n");
@@ -228,7 +273,21 @@ void print_params(const CommandLineInput& params) {
     printf("    scheduler_alpha_type:           %s\n", scheduler_alpha_type_str[params.scheduler_alpha_type]);
     printf("    scheduler_prediction:           %s\n", scheduler_prediction_str[params.scheduler_predict_type]);
     printf("    scheduler_sigma_schedule:       %s\n", scheduler_sigma_type_str[params.scheduler_sigma_type]);
+    printf("    scheduler_tolerance:            %.6f\n", params.scheduler_tolerance);
     printf("    tokenizer_series:               %s\n", tokenizer_series_str[params.sd_tokenizer_type]);
+    printf("    clip_precision:                 %s\n", precision_type_str[params.sd_clip_precision]);
+    printf("    unet_precision:                 %s\n", precision_type_str[params.sd_unet_precision]);
+    printf("    vae_precision:                  %s\n", precision_type_str[params.sd_vae_precision]);
+    printf("    calibration_dump_at:            %s\n", params.sd_calibration_dump_at.c_str());
+    printf("    embedding_bank_at:              %s\n", params.sd_embedding_bank_at.c_str());
+    printf("    guidance_schedule:              %s\n", guidance_schedule_str[params.sd_guidance_schedule]);
+    printf("    snapshot_path:                  %s\n", params.snapshot_path.c_str());
+    printf("    snapshot_step:                  %llu%s\n", (unsigned long long) params.snapshot_step, params.snapshot_stop ? " (stop)" : "");
+    printf("    resume_path:                    %s\n", params.resume_path.c_str());
+    printf("    resume_seed:                    %lld\n", (long long) params.resume_seed);
+    printf("    resume_guidance:                %.6f\n", params.resume_guidance);
+    printf("    resume_steps:                   %llu\n", (unsigned long long) params.resume_steps);
+    printf("    resume_prompt:                  %s\n", params.resume_prompt ? "true" : "false");
 
     printf("  Static (by Models [const]): \n");
     printf("    training steps:                 %llu\n", params.scheduler_training_steps);
@@ -277,21 +336,51 @@ void print_usage(int argc, const char* argv[]) {
     printf("  --safety [SAFETY_PATH]             path to safe security\n");
     printf("  --dict [DICTIONARY_PATH]           path to vocab dictionary \n");
     printf("  --merges [MERGES_FILE_PATH]        path to merges file (only for BPE Tokenizer) \n");
+    printf("  --compile-tokenizer [ASSET_PATH]   compile --dict (+ --merges) into a binary *.adtk asset and exit, \n");
+    printf("                                     pass the asset as --dict afterwards (memory-mapped, no merges file needed) \n");
+    printf("  --embedding-bank [BANK_PATH]       precompiled prompt embeddings (*.adeb), its prompts skip tokenizer and CLIP, \n");
+    printf("                                     CLIP is only loaded when a prompt is not in the bank \n");
+    printf("  --compile-bank [BANK_PATH]         encode every line of --bank-prompts with --clip (+ --clip2) into a bank and exit \n");
+    printf("  --bank-prompts [FILE]              prompt catalog for --compile-bank, one prompt per line (the empty prompt is always added) \n");
 
     printf("  --beta-start <float>               Beta start (default 0.00085f) \n");
     printf("  --beta-end <float>                 Beta end (default 0.012f) \n");
     printf("  --guidance <float>                 Scale for classifier-free guidance, immersion rate for [value * (Positive - Negative)] residual (default 7.5f) \n");
     printf("  --decoding <float>                 for VAE Decoding result merged (default 0.18215f) \n");
     printf("  --strength <float>                 set random intensity to control noise adding each step in [0.0, 1.0] (default 1.0f) \n");
+    printf("  --img2img-strength <float>         img2img denoise strength in (0.0, 1.0], noise the input to that level and run only that fraction of steps (default 1.0f) \n");
+    printf("  --guidance-start <float>           fraction of steps where guidance starts, only the positive pass runs before it (default 0.0f) \n");
+    printf("  --guidance-end <float>             fraction of steps where guidance ends, only the positive pass runs after it (default 1.0f) \n");
+    printf("                                     (INFO: e.g. 0.6 skips the negative UNet pass on the last 40%% of steps) \n");
     printf("  --steps <uint>                     inference step to generate output (default 3) \n");
 
     printf("arguments (optional, unrecommended):\n");
-    printf("  --scheduler [TYPE]                 Scheduler Type [euler / euler_a / lms / lcm / heun / ddpm / ddim / unipc / dpm_m / dpm_sde / dpm_s / pndm / ipndm / deis_m] (default euler_a) \n");
-    printf("  --sigma [TYPE]                     Sigma Schedule Style [default / karras] (default default) \n");
+    printf("  --scheduler [TYPE]                 Scheduler Type [euler / euler_a / lms / lcm / heun / ddpm / ddim / unipc / dpm_m / dpm_sde / dpm_s / pndm / ipndm / deis_m / adaptive] (default euler_a) \n");
+    printf("  --tolerance <float>                relative error tolerance of the adaptive scheduler, lower runs more steps (default 0.05f) \n");
+    printf("                                     (INFO: adaptive uses --steps only for its first step size and caps UNet runs at 2x steps) \n");
+    printf("  --sigma [TYPE]                     Sigma Schedule Style [default / karras / ays_sd15 / ays_sdxl] (default default) \n");
+    printf("                                     (INFO: ays_* are Align-Your-Steps schedules, ~10 steps match 25-30 default steps) \n");
     printf("  --beta [TYPE]                      Beta Style [linear / scale_linear / squared_cos_cap_v2) (default linear) \n");
     printf("  --alpha [TYPE]                     Alpha(Beta) Method [cos / exp] (default cos) \n");
     printf("  --predictor [TYPE]                 Prediction Style [epsilon / v_prediction, sample) (default epsilon) \n");
     printf("  --tokenizer [TYPE]                 Tokenizer Type [bpe / word_piece] (default bpe) \n");
+    printf("  --clip-precision [TYPE]            CLIP model precision [auto / fp32 / fp16 / int8] (default auto) \n");
+    printf("  --unet-precision [TYPE]            UNet model precision [auto / fp32 / fp16 / int8] (default auto) \n");
+    printf("  --vae-precision [TYPE]             VAE model precision [auto / fp32 / fp16 / int8] (default auto) \n");
+    printf("                                     (INFO: int8 expects a quantized export, see sd/quantize; fp16 an fp16 export, \n");
+    printf("                                            a mismatch with the model's declared IO types is reported) \n");
+    printf("  --calibration-dump [DIR]           dump CLIP/UNet inputs of this run as .npy into DIR, for offline quantization \n");
+    printf("  --guidance-schedule [TYPE]         guidance scale inside the window [constant / linear / cosine] (default constant) \n");
+    printf("                                     (INFO: linear / cosine decay from --guidance to 1.0 at the window end) \n");
+    printf("  --snapshot [FILE]                  write the trajectory state (latent, scheduler history, noise stream, prompts) into FILE \n");
+    printf("  --snapshot-at <uint>               UNet step to snapshot before (default 0) \n");
+    printf("  --snapshot-stop                    end the run once the snapshot is written, no image is saved \n");
+    printf("  --resume [FILE]                    continue a snapshot instead of a fresh run (shared steps are not repeated) \n");
+    printf("  --resume-seed <int>                seed for the remaining noise (default -1: snapshot's) \n");
+    printf("  --resume-guidance <float>          guidance scale of the remaining steps (default 0: snapshot's) \n");
+    printf("  --resume-steps <uint>              re-grid the remaining trajectory to this step count (default 0: snapshot's) \n");
+    printf("  --resume-prompt                    condition the remaining steps on -p / -n instead of the snapshot's prompts \n");
+    printf("                                     (INFO: K variations sharing the first 60%% of steps cost 0.6 + 0.4 * K runs) \n");
 
     printf("  --cache <uint>                     scheduler maintain history count, only avail when used by method (default 4) \n");
     printf("  --train-steps <uint>               scheduler steps when at model training stage (default 1000) \n");
@@ -476,6 +565,30 @@ void parse_args(int argc, const char** argv, CommandLineInput& params) {
                 break;
             }
             params.tokenizer_aggregates_at = argv[i];
+        } else if (arg == "--compile-tokenizer") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.tokenizer_compile_at = argv[i];
+        } else if (arg == "--embedding-bank") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_embedding_bank_at = argv[i];
+        } else if (arg == "--compile-bank") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.bank_compile_at = argv[i];
+        } else if (arg == "--bank-prompts") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.bank_prompts_at = argv[i];
         } else if (arg == "--beta-start") {
             if (++i >= argc) {
                 invalid_arg = true;
@@ -506,6 +619,31 @@ void parse_args(int argc, const char** argv, CommandLineInput& params) {
                 break;
             }
             params.sd_random_intensity = std::stof(argv[i]);
+        } else if (arg == "--img2img-strength") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_img2img_strength = std::stof(argv[i]);
+        } else if (arg == "--guidance-start") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_guidance_start = std::stof(argv[i]);
+        } else if (arg == "--guidance-end") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_guidance_end = std::stof(argv[i]);
+        } else if (arg == "--guidance-schedule") {
+            int guidance_found = GET_TYPE_FROM_STR(guidance_schedule_str, AVAILABLE_GUIDANCE_COUNT);
+            if (guidance_found == -1) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_guidance_schedule = (AvailableGuidanceScheduleType) guidance_found;
         } else if (arg == "--steps") {
             if (++i >= argc) {
                 invalid_arg = true;
@@ -554,6 +692,79 @@ void parse_args(int argc, const char** argv, CommandLineInput& params) {
                 break;
             }
             params.sd_tokenizer_type = (AvailableTokenizerType) tokenizer_found;
+        } else if (arg == "--clip-precision") {
+            int precision_found = GET_TYPE_FROM_STR(precision_type_str, AVAILABLE_PRECISION_COUNT);
+            if (precision_found == -1) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_clip_precision = (AvailablePrecisionType) precision_found;
+        } else if (arg == "--unet-precision") {
+            int precision_found = GET_TYPE_FROM_STR(precision_type_str, AVAILABLE_PRECISION_COUNT);
+            if (precision_found == -1) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_unet_precision = (AvailablePrecisionType) precision_found;
+        } else if (arg == "--vae-precision") {
+            int precision_found = GET_TYPE_FROM_STR(precision_type_str, AVAILABLE_PRECISION_COUNT);
+            if (precision_found == -1) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_vae_precision = (AvailablePrecisionType) precision_found;
+        } else if (arg == "--calibration-dump") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.sd_calibration_dump_at = argv[i];
+        } else if (arg == "--snapshot") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.snapshot_path = argv[i];
+        } else if (arg == "--snapshot-at") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.snapshot_step = std::stoull(argv[i]);
+        } else if (arg == "--snapshot-stop") {
+            params.snapshot_stop = true;
+        } else if (arg == "--resume") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.resume_path = argv[i];
+        } else if (arg == "--resume-seed") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.resume_seed = std::stoll(argv[i]);
+        } else if (arg == "--resume-guidance") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.resume_guidance = std::stof(argv[i]);
+        } else if (arg == "--resume-steps") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.resume_steps = std::stoull(argv[i]);
+        } else if (arg == "--resume-prompt") {
+            params.resume_prompt = true;
+        } else if (arg == "--tolerance") {
+            if (++i >= argc) {
+                invalid_arg = true;
+                break;
+            }
+            params.scheduler_tolerance = std::stof(argv[i]);
         } else if (arg == "--cache") {
             if (++i >= argc) {
                 invalid_arg = true;
@@ -617,6 +828,24 @@ void parse_args(int argc, const char** argv, CommandLineInput& params) {
         exit(1);
     }
 
+    // compiling a tokenizer asset needs no models or image settings
+    if (!params.tokenizer_compile_at.empty()) {
+        if (params.tokenizer_dictionary_at.empty()) {
+            fprintf(stderr, "error: --compile-tokenizer needs a --dict file\n");
+            exit(1);
+        }
+        return;
+    }
+
+    // compiling an embedding bank needs only the text encoders and their tokenizer
+    if (!params.bank_compile_at.empty()) {
+        if (params.bank_prompts_at.empty() || params.onnx_clip_path.empty() || params.tokenizer_dictionary_at.empty()) {
+            fprintf(stderr, "error: --compile-bank needs --bank-prompts, --clip and --dict\n");
+            exit(1);
+        }
+        return;
+    }
+
     if ((params.mode == IMG2IMG || params.mode == IMG2VID) && params.input_path.length() == 0) {
         fprintf(stderr, "error: when using the img2img mode, the following arguments are required: init-img\n");
         print_usage(argc, argv);
@@ -649,6 +878,32 @@ void parse_args(int argc, const char** argv, CommandLineInput& params) {
         exit(1);
     }
 
+    if (params.sd_img2img_strength <= 0.f || params.sd_img2img_strength > 1.f) {
+        fprintf(stderr, "error: the img2img strength must be in (0.0, 1.0]\n");
+        exit(1);
+    }
+
+    if (params.scheduler_tolerance <= 0.f) {
+        fprintf(stderr, "error: the scheduler tolerance must be greater than 0\n");
+        exit(1);
+    }
+
+    if (params.sd_guidance_start < 0.f || params.sd_guidance_end > 1.f ||
+        params.sd_guidance_start >= params.sd_guidance_end) {
+        fprintf(stderr, "error: the guidance window must satisfy 0.0 <= start < end <= 1.0\n");
+        exit(1);
+    }
+
+    if (params.snapshot_stop && params.snapshot_path.empty()) {
+        fprintf(stderr, "error: --snapshot-stop needs a --snapshot file\n");
+        exit(1);
+    }
+
+    if (params.resume_seed < -1 || params.resume_guidance < 0.f) {
+        fprintf(stderr, "error: the resume seed must be >= -1 and the resume guidance >= 0.0\n");
+        exit(1);
+    }
+
     // seed random check
     if (params.scheduler_seed < 0) {
         std::random_device rd;
@@ -669,10 +924,18 @@ static std::string get_image_params(const CommandLineInput &params) {
         parameter_string += "Negative prompt: " + wrap_text(params.negative_prompt, 0, 17) + "\n";
     }
     parameter_string += "Guidance : " + std::to_string(params.sd_scale_guidance) + ", ";
+    if (params.sd_guidance_start > 0.f || params.sd_guidance_end < 1.f || params.sd_guidance_schedule != AVAILABLE_GUIDANCE_CONSTANT) {
+        parameter_string += "Guidance Window: [" + std::to_string(params.sd_guidance_start) + ", " +
+                            std::to_string(params.sd_guidance_end) + ") " +
+                            std::string(guidance_schedule_str[params.sd_guidance_schedule]) + ", ";
+    }
     parameter_string += "Steps: " + std::to_string(params.sd_inference_steps) +
                         "[ Training with " + std::to_string(params.scheduler_training_steps) +
                         "], ";
     parameter_string += "Seed: " + std::to_string(params.scheduler_seed) + ", ";
+    if (params.mode == IMG2IMG) {
+        parameter_string += "Strength: " + std::to_string(params.sd_img2img_strength) + ", ";
+    }
     parameter_string += "Size: " +
                         std::to_string(params.sd_input_width) + "x" +
                         std::to_string(params.sd_input_height) + ", " + "\n";
@@ -775,6 +1038,17 @@ int main(int argc, const char *argv[]) {
         print_params(params);
     }
 
+    if (!params.tokenizer_compile_at.empty()) {
+        bool compiled_ = ortsd::compile_tokenizer(
+            params.sd_tokenizer_type,
+            params.tokenizer_dictionary_at.c_str(),
+            params.tokenizer_aggregates_at.c_str(),
+            params.tokenizer_compile_at.c_str()
+        );
+        printf("%s tokenizer asset '%s'\n", compiled_ ? "compiled" : "failed to compile", params.tokenizer_compile_at.c_str());
+        return compiled_ ? 0 : 1;
+    }
+
     ortsd::IOrtSDContext_ptr ort_sd_context_ = nullptr;
     ortsd::generate_context(
         &ort_sd_context_,
@@ -818,7 +1092,21 @@ int main(int argc, const char *argv[]) {
             params.sd_input_channel,
             params.sd_scale_guidance,
             params.sd_random_intensity,
-            params.sd_decode_scale_strength
+            params.sd_decode_scale_strength,
+            {
+                params.sd_clip_precision,
+                params.sd_unet_precision,
+                params.sd_vae_precision
+            },
+            params.sd_calibration_dump_at.c_str(),
+            params.sd_img2img_strength,
+            {
+                params.sd_guidance_start,
+                params.sd_guidance_end,
+                params.sd_guidance_schedule
+            },
+            params.scheduler_tolerance,
+            params.sd_embedding_bank_at.c_str()
         }
     );
     if (!ort_sd_context_) {
@@ -826,6 +1114,24 @@ int main(int argc, const char *argv[]) {
         return 1;
     }
 
+    if (!params.bank_compile_at.empty()) {
+        std::vector<std::string> bank_prompts_;
+        std::ifstream prompts_file_(params.bank_prompts_at);
+        for (std::string line_; std::getline(prompts_file_, line_);) {
+            if (!line_.empty() && line_.back() == '\r') line_.pop_back();
+            if (!line_.empty()) bank_prompts_.push_back(line_);
+        }
+        std::vector<const char *> bank_prompt_list_;
+        for (const std::string &prompt_ : bank_prompts_) bank_prompt_list_.push_back(prompt_.c_str());
+        bool compiled_ = prompts_file_.eof() && ortsd::compile_embedding_bank(
+            ort_sd_context_, bank_prompt_list_.data(), bank_prompt_list_.size(), params.bank_compile_at.c_str()
+        );
+        printf("%s embedding bank '%s' (%zu prompts)\n", compiled_ ? "compiled" : "failed to compile",
+               params.bank_compile_at.c_str(), bank_prompts_.size());
+        ortsd::released_context(&ort_sd_context_);
+        return compiled_ ? 0 : 1;
+    }
+
     // Operation begin
     uint64_t input_image_size =  params.sd_input_width * params.sd_input_height * params.sd_input_channel;
     uint8_t *input_image_data = nullptr;
@@ -833,11 +1139,36 @@ int main(int argc, const char *argv[]) {
     {
         ortsd::init(ort_sd_context_);
 
-        ortsd::prepare(ort_sd_context_, params.positive_prompt.c_str(), params.negative_prompt.c_str());
+        if (!params.snapshot_path.empty()) {
+            ortsd::snapshot(ort_sd_context_, params.snapshot_path.c_str(), params.snapshot_step, params.snapshot_stop);
+        }
 
-        IO_IMAGE result_output_ = ortsd::inference(ort_sd_context_, {input_image_data, input_image_size});
+        IO_IMAGE result_output_ = {nullptr, 0};
+        if (params.resume_path.empty()) {
+            ortsd::prepare(ort_sd_context_, params.positive_prompt.c_str(), params.negative_prompt.c_str());
+            result_output_ = ortsd::inference(ort_sd_context_, {input_image_data, input_image_size});
+        } else {
+            // the snapshot carries its own conditioning, CLIP only runs for a prompt change
+            if (params.resume_prompt) {
+                ortsd::prepare(ort_sd_context_, params.positive_prompt.c_str(), params.negative_prompt.c_str());
+            }
+            result_output_ = ortsd::resume(
+                ort_sd_context_, params.resume_path.c_str(),
+                {
+                    params.resume_seed,
+                    params.resume_guidance,
+                    params.resume_steps,
+                    params.resume_prompt
+                }
+            );
+        }
 
-        save_image(params, result_output_.data_);
+        printf("\nUNet runs: %llu\n", (unsigned long long) ortsd::unet_runs(ort_sd_context_));
+        if (params.snapshot_stop && !result_output_.data_) {
+            printf("\nsnapshot written to '%s', run stopped at step %llu\n", params.snapshot_path.c_str(), (unsigned long long) params.snapshot_step);
+        } else {
+            save_image(params, result_output_.data_);
+        }
     }
     free(input_image_data);
     // Operation end
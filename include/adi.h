@@ -60,6 +60,8 @@ enum AvailablePredictionType {
 enum AvailableSigmaType {
     SIGMA_TYPE_DEFAULT          = 0x00,
     SIGMA_TYPE_KARRAS           = 0x01,
+    SIGMA_TYPE_AYS_SD15         = 0x02,
+    SIGMA_TYPE_AYS_SDXL         = 0x03,
     AVAILABLE_SIGMA_COUNT,
 };
 
@@ -79,16 +81,34 @@ enum AvailableSchedulerType {
     AVAILABLE_SCHEDULER_PNDM        = 0x0b,
     AVAILABLE_SCHEDULER_IPNDM       = 0x0c,
     AVAILABLE_SCHEDULER_DEIS_M      = 0x0d,
+    AVAILABLE_SCHEDULER_ADAPTIVE    = 0x0e,
     AVAILABLE_SCHEDULER_COUNT,
 };
 
 /* Tokenizer Type Provide */
 enum AvailableTokenizerType {
     AVAILABLE_TOKENIZER_BPE         = 0x00,
-    /*AVAILABLE_TOKENIZER_WORD_PIECE  = 0x02,*/
+    AVAILABLE_TOKENIZER_WORD_PIECE  = 0x01,
     AVAILABLE_TOKENIZER_COUNT,
 };
 
+/* Model Precision Provide (per unit) */
+enum AvailablePrecisionType {
+    AVAILABLE_PRECISION_AUTO        = 0x00,
+    AVAILABLE_PRECISION_FP32        = 0x01,
+    AVAILABLE_PRECISION_FP16        = 0x02,
+    AVAILABLE_PRECISION_INT8        = 0x03,
+    AVAILABLE_PRECISION_COUNT,
+};
+
+/* Guidance Scale Schedule Provide (inside the guidance window) */
+enum AvailableGuidanceScheduleType {
+    AVAILABLE_GUIDANCE_CONSTANT     = 0x00,
+    AVAILABLE_GUIDANCE_LINEAR       = 0x01,
+    AVAILABLE_GUIDANCE_COSINE       = 0x02,
+    AVAILABLE_GUIDANCE_COUNT,
+};
+
 /* Diffusion Main Configuration ===========================================*/
 /* OrtSD Context IO data struct*/
 typedef struct IO_IMAGE {
@@ -123,7 +143,7 @@ typedef struct IOrtSDConfig {
         enum AvailableBetaType scheduler_beta_type;     // Scheduler: Beta Style (Linear. ScaleLinear, CAP_V2)
         enum AvailableAlphaType scheduler_alpha_type;   // Scheduler: Alpha(Beta) Method (Cos, Exp)
         enum AvailablePredictionType scheduler_predict_type;   // Scheduler: Prediction Style (Epsilon, V_Pred, Sample)
-        enum AvailableSigmaType scheduler_sigma_type;          // Scheduler: Sigma Schedule Style (Default, Karras)
+        enum AvailableSigmaType scheduler_sigma_type;          // Scheduler: Sigma Schedule Style (Default, Karras, AYS SD1.5 / SDXL)
     } sd_scheduler_config;
 
     struct {
@@ -145,8 +165,34 @@ typedef struct IOrtSDConfig {
     float sd_scale_guidance;                // Infer_Major: immersion rate for [value * (Positive - Negative)] residual
     float sd_random_intensity;              // Infer_Major: random intensity for in stepping noise Add (only avail when method supported)
     float sd_decode_scale_strength;         // Infer_Major: for VAE Decoding result merged (Recommend 0.18215f)
+
+    struct {
+        enum AvailablePrecisionType sd_clip_precision;  // Precision: CLIP model precision (auto, fp32, fp16, int8)
+        enum AvailablePrecisionType sd_unet_precision;  // Precision: UNet model precision (auto, fp32, fp16, int8)
+        enum AvailablePrecisionType sd_vae_precision;   // Precision: VAE model precision (auto, fp32, fp16, int8)
+    } sd_precision_config;
+    const char* sd_calibration_dump_at;     // Calibration: dir to dump CLIP/UNet inputs as .npy for offline quantization (NULL or empty: off)
+    float sd_img2img_strength;              // Infer_Major: img2img denoise strength in (0, 1), runs only that fraction of the steps (0 or 1: full schedule)
+
+    struct {
+        float sd_guidance_start;                        // Guidance: fraction of steps where CFG starts, negative pass skipped before it (default 0)
+        float sd_guidance_end;                          // Guidance: fraction of steps where CFG ends, negative pass skipped after it (0 or 1: until the last step)
+        enum AvailableGuidanceScheduleType sd_guidance_schedule;   // Guidance: scale inside the window (constant, linear / cosine decay to 1)
+    } sd_guidance_config;
+    float sd_adaptive_tolerance;            // Scheduler: relative error tolerance of the adaptive scheduler, lower runs more steps (0: default 0.05)
+    const char* sd_embedding_bank_at;       // Conditioning: precompiled prompt-embedding bank, its prompts skip CLIP, which loads on the first miss (NULL or empty: off)
 } IOrtSDConfig;
 
+/**
+ * @details Resume overrides for a trajectory snapshot (see ortsd::snapshot / ortsd::resume)
+ */
+typedef struct IOrtSDResume {
+    int64_t sd_seed;                        // Resume: seed for the noise of the remaining steps (-1: snapshot's)
+    float sd_scale_guidance;                // Resume: guidance scale of the remaining steps (0: snapshot's)
+    uint64_t sd_inference_steps;            // Resume: base step count, the rest is re-gridded from the snapshot's σ (0: snapshot's schedule)
+    bool sd_use_prepared;                   // Resume: condition on the prompts of the last prepare() instead of the snapshot's
+} IOrtSDResume;
+
 namespace ortsd{
     typedef void* IOrtSDContext_ptr;
 
@@ -156,6 +202,11 @@ namespace ortsd{
     ORT_ENTRY void prepare(IOrtSDContext_ptr ctx_p_, const char* positive_prompts_, const char*negative_prompts_);
     ORT_ENTRY IO_IMAGE inference(IOrtSDContext_ptr ctx_p_, IO_IMAGE image_data_);
     ORT_ENTRY void release(IOrtSDContext_ptr ctx_p_);
+    ORT_ENTRY void snapshot(IOrtSDContext_ptr ctx_p_, const char* snapshot_path_, uint64_t snapshot_step_, bool snapshot_stop_);
+    ORT_ENTRY IO_IMAGE resume(IOrtSDContext_ptr ctx_p_, const char* snapshot_path_, struct IOrtSDResume resume_);
+    ORT_ENTRY bool compile_tokenizer(enum AvailableTokenizerType tokenizer_type_, const char* dictionary_at_, const char* aggregates_at_, const char* asset_at_);
+    ORT_ENTRY bool compile_embedding_bank(IOrtSDContext_ptr ctx_p_, const char* const* prompts_, uint64_t prompt_count_, const char* bank_at_);
+    ORT_ENTRY uint64_t unet_runs(IOrtSDContext_ptr ctx_p_);
 }
 
 #ifdef __cplusplus
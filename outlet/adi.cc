@@ -39,7 +39,8 @@ namespace ortsd {
                     onnx::sd::base::BetaType(ctx_config_.sd_scheduler_config.scheduler_beta_type),
                     onnx::sd::base::AlphaType(ctx_config_.sd_scheduler_config.scheduler_alpha_type),
                     onnx::sd::base::PredictionType(ctx_config_.sd_scheduler_config.scheduler_predict_type),
-                    onnx::sd::base::SigmaType(ctx_config_.sd_scheduler_config.scheduler_sigma_type)
+                    onnx::sd::base::SigmaType(ctx_config_.sd_scheduler_config.scheduler_sigma_type),
+                    ctx_config_.sd_adaptive_tolerance
                 },
                 {
                     onnx::sd::base::TokenizerType(ctx_config_.sd_tokenizer_config.sd_tokenizer_type),
@@ -58,7 +59,20 @@ namespace ortsd {
                 ctx_config_.sd_input_channel,
                 ctx_config_.sd_scale_guidance,
                 ctx_config_.sd_random_intensity,
-                ctx_config_.sd_decode_scale_strength
+                ctx_config_.sd_decode_scale_strength,
+                {
+                    onnx::sd::base::PrecisionType(ctx_config_.sd_precision_config.sd_clip_precision),
+                    onnx::sd::base::PrecisionType(ctx_config_.sd_precision_config.sd_unet_precision),
+                    onnx::sd::base::PrecisionType(ctx_config_.sd_precision_config.sd_vae_precision)
+                },
+                std::string(ctx_config_.sd_calibration_dump_at ? ctx_config_.sd_calibration_dump_at : ""),
+                ctx_config_.sd_img2img_strength,
+                {
+                    ctx_config_.sd_guidance_config.sd_guidance_start,
+                    ctx_config_.sd_guidance_config.sd_guidance_end,
+                    onnx::sd::base::GuidanceScheduleType(ctx_config_.sd_guidance_config.sd_guidance_schedule)
+                },
+                std::string(ctx_config_.sd_embedding_bank_at ? ctx_config_.sd_embedding_bank_at : "")
             }
         );
     }
@@ -104,6 +118,84 @@ namespace ortsd {
             ((onnx::sd::context::OrtSD_Context *) ctx_p_)->release();
         }
     }
+
+    ORT_ENTRY void snapshot(IOrtSDContext_ptr ctx_p_, const char *snapshot_path_, uint64_t snapshot_step_, bool snapshot_stop_) {
+        if (ctx_p_) {
+            ((onnx::sd::context::OrtSD_Context *) ctx_p_)->snapshot(
+                std::string(snapshot_path_ ? snapshot_path_ : ""),
+                snapshot_step_,
+                snapshot_stop_
+            );
+        }
+    }
+
+    ORT_ENTRY IO_IMAGE resume(IOrtSDContext_ptr ctx_p_, const char *snapshot_path_, struct IOrtSDResume resume_) {
+        if (ctx_p_ && snapshot_path_) {
+            // a missing, truncated or foreign snapshot throws, which must not cross the C boundary
+            try {
+                auto result_ = ((onnx::sd::context::OrtSD_Context *) ctx_p_)->resume(
+                    std::string(snapshot_path_),
+                    {
+                        resume_.sd_seed,
+                        resume_.sd_scale_guidance,
+                        resume_.sd_inference_steps,
+                        resume_.sd_use_prepared
+                    }
+                );
+                return {result_.data_, result_.size_};
+            } catch (const onnx::sd::amon::exception_base &) {
+                // already reported where it was raised
+            } catch (...) {
+                amon_report(onnx::sd::amon::basic_exception(onnx::sd::amon::EXC_LOG_ERR, "ERROR:: resume failed"));
+            }
+        }
+        return {nullptr, 0};
+    }
+
+    ORT_ENTRY bool compile_tokenizer(enum AvailableTokenizerType tokenizer_type_, const char *dictionary_at_,
+                                     const char *aggregates_at_, const char *asset_at_) {
+        if (!dictionary_at_ || !asset_at_) return false;
+        // loading a broken dictionary can throw, which must not cross the C boundary
+        try {
+            return onnx::sd::tokenizer::TokenizerRegister::compile_tokenizer(
+                onnx::sd::base::TokenizerType(tokenizer_type_),
+                std::string(dictionary_at_),
+                std::string(aggregates_at_ ? aggregates_at_ : ""),
+                std::string(asset_at_)
+            );
+        } catch (const onnx::sd::amon::exception_base &) {
+            // already reported where it was raised
+        } catch (...) {
+            amon_report(onnx::sd::amon::basic_exception(onnx::sd::amon::EXC_LOG_ERR, "ERROR:: tokenizer compile failed"));
+        }
+        return false;
+    }
+
+    ORT_ENTRY bool compile_embedding_bank(IOrtSDContext_ptr ctx_p_, const char *const *prompts_, uint64_t prompt_count_,
+                                          const char *bank_at_) {
+        if (!ctx_p_ || !bank_at_ || (!prompts_ && prompt_count_ > 0)) return false;
+        // encoding the catalog can throw (encoder load, tokenizer, allocation), which must not cross the C boundary
+        try {
+            std::vector<std::string> prompt_list_;
+            prompt_list_.reserve(prompt_count_);
+            for (uint64_t i = 0; i < prompt_count_; ++i) {
+                prompt_list_.emplace_back(prompts_[i] ? prompts_[i] : "");
+            }
+            return ((onnx::sd::context::OrtSD_Context *) ctx_p_)->compile_bank(prompt_list_, std::string(bank_at_));
+        } catch (const onnx::sd::amon::exception_base &) {
+            // already reported where it was raised
+        } catch (...) {
+            amon_report(onnx::sd::amon::basic_exception(onnx::sd::amon::EXC_LOG_ERR, "ERROR:: embedding bank compile failed"));
+        }
+        return false;
+    }
+
+    ORT_ENTRY uint64_t unet_runs(IOrtSDContext_ptr ctx_p_) {
+        if (ctx_p_) {
+            return ((onnx::sd::context::OrtSD_Context *) ctx_p_)->unet_runs();
+        }
+        return 0;
+    }
 }
 
 #endif  // ORT_SD_CONTEXT_IMPLEMENT_
\ No newline at end of file
@@ -0,0 +1,237 @@
+#!/bin/bash
+# ADI prompt parser differential check: PromptScanner against the std::regex implementation it replaced
+#
+# Usage:
+#   bash sd/io-test/run_prompt_parser_diff.sh [ort-root] [prompts] [seed]
+#     ort-root   onnxruntime package with include/ (and lib/), defaults to engine/onnxruntime/<first>
+#     prompts    number of generated prompts, defaults to 200000
+#     seed       generator seed, defaults to 1
+#
+# Compiles a small driver against the tokenizer sources (unity build, -O2) holding the old
+# regexes and loops verbatim, generates prompts that mix weights, nesting, escapes, BREAK
+# variants, specials, contractions, digits, '_' and non-ASCII bytes, and compares per prompt:
+#   parse - TokenizerBase::parse_prompt_attention against the regex_search / BREAK-split loop
+#   split - PromptScanner::split_words against the CLIP word regex (lowercased input)
+# Expected differences are counted, not failed:
+#   escape - \( \) \[ \] \\ now drop the backslash (the regex loop kept it as text)
+#   throw  - the regex loop threw in std::stof on weights like ":.)" or out-of-range values
+# Any other difference is printed (first 10) and the script exits 1.
+
+set -u
+
+ROOT="$(cd "$(dirname "$0")/../.." && pwd)"
+ORT_ROOT="${1:-$(ls -d "$ROOT"/engine/onnxruntime/*/ 2>/dev/null | head -1)}"
+COUNT="${2:-200000}"
+SEED="${3:-1}"
+OUT_DIR="$ROOT/sd/io-test/tokenizer-bench"
+mkdir -p "$OUT_DIR"
+
+[ -d "$ORT_ROOT/include" ] || { echo "onnxruntime headers not found, pass [ort-root]"; exit 1; }
+
+DRIVER="$OUT_DIR/prompt_parser_diff.cc"
+cat > "$DRIVER" <<'CPP'
+#include "tokenizer_register.cc"
+using namespace onnx::sd::tokenizer;
+typedef TokenizerBase::PromptWeight_map PromptWeight_map;
+
+struct Parser : BPETokenizer {
+    using BPETokenizer::BPETokenizer;
+    using BPETokenizer::parse_prompt_attention;
+};
+
+// ---- the regex implementation, as it was before PromptScanner ----------------------------
+static const std::regex old_split_reg(
+    R"(<\|startoftext\|>|<\|endoftext\|>|'s|'t|'re|'ve|'m|'ll|'d|[a-zA-Z]+|\d|[^ \t\n\r\f\v\w]+)",
+    std::regex::icase
+);
+static const std::regex old_focusing(
+    R"(\\\(|\\\)|\\\[|\\\]|\\\\|\\|\(|\[|:([+-]?[.\d]+)\)|\)|\]|[^\\()\[\]:]+|:)"
+);
+static const std::regex old_breaking(
+    R"(\s*\bBREAK\b\s*)"
+);
+
+static std::vector<std::string> old_split(const std::string &str, const std::regex &regex, bool match_break) {
+    if (match_break) {
+        std::sregex_token_iterator first(str.begin(), str.end(), regex, -1);
+        std::sregex_token_iterator last;
+        return {first, last};
+    }
+    std::vector<std::string> result;
+    for (std::sregex_iterator i(str.begin(), str.end(), regex), e; i != e; ++i) result.push_back(i->str());
+    return result;
+}
+
+static std::string old_whitespace(const std::string &text) {
+    return std::regex_replace(text, std::regex("\\s+"), " ");
+}
+
+// drop_escape_: the one intended change, escapes keep only the escaped character
+static PromptWeight_map old_parse(const std::string &prompts_, const TokenizerConfig &config_, bool drop_escape_) {
+    PromptWeight_map prompt_weight_;
+    std::vector<int> increase_list_;
+    std::vector<int> decrease_list_;
+    auto multiply_range = [&](int start_position, float multiplier) {
+        for (int p = start_position; p < prompt_weight_.size(); ++p) prompt_weight_[p].second *= multiplier;
+    };
+
+    std::smatch regex_matcher_;
+    std::string remaining_text = prompts_;
+    while (std::regex_search(remaining_text, regex_matcher_, old_focusing)) {
+        std::string text   = regex_matcher_[0];
+        std::string weight = regex_matcher_[1];
+        if (text == "(") {
+            increase_list_.push_back((int)prompt_weight_.size());
+        } else if (text == "[") {
+            decrease_list_.push_back((int)prompt_weight_.size());
+        } else if (!weight.empty() && !increase_list_.empty()) {
+            multiply_range(increase_list_.back(), std::stof(weight));
+            increase_list_.pop_back();
+        } else if (text == ")" && !increase_list_.empty()) {
+            multiply_range(increase_list_.back(), config_.txt_attn_increase_factor);
+            increase_list_.pop_back();
+        } else if (text == "]" && !decrease_list_.empty()) {
+            multiply_range(decrease_list_.back(), config_.txt_attn_decrease_factor);
+            decrease_list_.pop_back();
+        } else {
+            if (drop_escape_ && text.size() == 2 && text[0] == '\\') text = text.substr(1);   // EXPECTED DIFFERENCE
+            std::vector<std::string> parts = old_split(text, old_breaking, true);
+            for (int i = 0; i < parts.size(); ++i) {
+                if (i > 0) { prompt_weight_.emplace_back("BREAK", -1.0f); }
+                prompt_weight_.emplace_back(parts[i], 1.0f);
+            }
+        }
+        remaining_text = regex_matcher_.suffix();
+    }
+    for (int pos : increase_list_) multiply_range(pos, config_.txt_attn_increase_factor);
+    for (int pos : decrease_list_) multiply_range(pos, config_.txt_attn_decrease_factor);
+
+    if (prompt_weight_.empty()) prompt_weight_.emplace_back("", 1.0f);
+    size_t i = 0;
+    while (i + 1 < prompt_weight_.size()) {
+        if (prompt_weight_[i].second == prompt_weight_[i + 1].second) {
+            prompt_weight_[i].first += prompt_weight_[i + 1].first;
+            prompt_weight_.erase(prompt_weight_.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+    return prompt_weight_;
+}
+
+static std::vector<std::string> old_words(const std::string &lowered_) {
+    return old_split(old_whitespace(lowered_), old_split_reg, false);
+}
+
+// ---- prompt generator ----------------------------------------------------------------------
+static std::string generate(std::mt19937_64 &rng_) {
+    static const char *pieces_[] = {
+        "a", "cat", "Water", "SUNSET", "masterpiece", "best quality", "portrait of", "x", "BREAKfast", "unBREAK",
+        " ", "  ", "\t", "\n", ", ", ",", ".", "!", "?", "-", "/", "&", "@#", "...", "<", ">", "|",
+        "(", "(", "(", ")", ")", ")", "[", "[", "]", "]", ":", ": ", "::",
+        ":1.3)", ":0.5)", ":+1.2)", ":-0.7)", ":2)", ":.5)", ":1.)", ":12.25)", ":1.2.3)", ":+)", ":a)", ":1.3", "1.3)",
+        "\\(", "\\)", "\\[", "\\]", "\\\\", "\\", "\\n", "\\:",
+        "BREAK", " BREAK ", "BREAK ", " BREAK", "\tBREAK\n", "break", "Break", "xBREAK", "BREAKx", "_BREAK", "BREAK_",
+        "BREAK BREAK", "(BREAK)", "BREAK,",
+        "<|startoftext|>", "<|endoftext|>", "<|STARTOFTEXT|>", "<|endoftext", "'s", "'T", "'re", "'ve", "'m", "'ll", "'d",
+        "don't", "it's", "we'LL", "'", "''",
+        "0", "7", "42", "1024", "3.14", "8k", "f/1.8", "35mm",
+        "_", "snake_case", "__init__", "a_1",
+        "caf\xc3\xa9", "\xe6\x97\xa5\xe6\x9c\xac", "\xf0\x9f\x90\xb1", "na\xc3\xafve", "\xc2\xa0"
+    };
+    const size_t piece_count_ = sizeof(pieces_) / sizeof(pieces_[0]);
+    std::string prompt_;
+    const size_t length_ = rng_() % 40;
+    for (size_t i = 0; i < length_; ++i) prompt_ += pieces_[rng_() % piece_count_];
+    return prompt_;
+}
+
+static std::string printable(const std::string &text_) {
+    std::string out_ = "\"";
+    for (unsigned char c_ : text_) {
+        if (c_ == '\n') out_ += "\\n";
+        else if (c_ == '\t') out_ += "\\t";
+        else if (c_ == '"' || c_ == '\\') { out_ += '\\'; out_ += char(c_); }
+        else if (c_ < 0x20 || c_ >= 0x7f) { char hex_[8]; snprintf(hex_, sizeof(hex_), "\\x%02x", c_); out_ += hex_; }
+        else out_ += char(c_);
+    }
+    return out_ + "\"";
+}
+
+static std::string dump(const PromptWeight_map &parsed_) {
+    std::string out_ = "[";
+    for (const auto &pair_ : parsed_) {
+        char weight_[32];
+        snprintf(weight_, sizeof(weight_), "%.9g", pair_.second);
+        out_ += "(" + printable(pair_.first) + ", " + weight_ + ")";
+    }
+    return out_ + "]";
+}
+
+int main(int argc, char **argv) {
+    const size_t count_ = argc > 1 ? std::stoull(argv[1]) : 200000;
+    std::mt19937_64 rng_(argc > 2 ? std::stoull(argv[2]) : 1);
+
+    TokenizerConfig config_{};
+    config_.avail_token_size = 77;
+    config_.major_boundary_factor = 1.0f;
+    config_.txt_attn_increase_factor = 1.1f;
+    config_.txt_attn_decrease_factor = 1 / 1.1f;
+    Parser parser_(config_);
+
+    size_t parse_same_ = 0, parse_escape_ = 0, parse_throw_ = 0, parse_diff_ = 0;
+    size_t split_same_ = 0, split_diff_ = 0;
+    size_t reported_ = 0;
+    std::vector<std::string> words_;
+    for (size_t n = 0; n < count_; ++n) {
+        const std::string prompt_ = generate(rng_);
+        const PromptWeight_map scanned_ = parser_.parse_prompt_attention(prompt_);
+        try {
+            const PromptWeight_map expected_ = old_parse(prompt_, config_, true);
+            if (scanned_ != expected_) {
+                parse_diff_++;
+                if (reported_++ < 10) {
+                    printf("parse mismatch %s\n  regex   %s\n  scanner %s\n",
+                           printable(prompt_).c_str(), dump(expected_).c_str(), dump(scanned_).c_str());
+                }
+            } else if (old_parse(prompt_, config_, false) != expected_) {
+                parse_escape_++;
+            } else {
+                parse_same_++;
+            }
+        } catch (const std::exception &) {
+            parse_throw_++;
+        }
+
+        std::string lowered_ = prompt_;
+        std::transform(lowered_.begin(), lowered_.end(), lowered_.begin(), [](unsigned char c) {
+            return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : char(c);
+        });
+        words_.clear();
+        PromptScanner::split_words(lowered_, words_);
+        if (words_ == old_words(lowered_)) {
+            split_same_++;
+        } else {
+            split_diff_++;
+            if (reported_++ < 10) printf("split mismatch %s\n", printable(lowered_).c_str());
+        }
+    }
+
+    printf("%-6s %10s %10s %10s %10s\n", "check", "identical", "escape", "throw", "mismatch");
+    printf("%-6s %10zu %10zu %10zu %10zu\n", "parse", parse_same_, parse_escape_, parse_throw_, parse_diff_);
+    printf("%-6s %10zu %10s %10s %10zu\n", "split", split_same_, "-", "-", split_diff_);
+    return (parse_diff_ || split_diff_) ? 1 : 0;
+}
+CPP
+
+INCLUDES="-I$ORT_ROOT/include"
+for dir in $(find "$ROOT/source" -type d); do INCLUDES="$INCLUDES -I$dir"; done
+LIBS="-lpthread"
+[ -d "$ORT_ROOT/lib" ] && LIBS="-L$ORT_ROOT/lib -Wl,-rpath,$ORT_ROOT/lib -lonnxruntime $LIBS"
+
+BIN="$OUT_DIR/prompt_parser_diff"
+echo "== building driver"
+c++ -std=c++17 -O2 $INCLUDES "$DRIVER" -o "$BIN" $LIBS || { echo "driver build failed"; exit 1; }
+
+echo "== comparing $COUNT prompts (seed $SEED)"
+"$BIN" "$COUNT" "$SEED"
@@ -0,0 +1,85 @@
+#!/bin/bash
+# ADI sigma-schedule benchmark: quality vs steps for default / karras / ays
+#
+# Usage:
+#   bash sd/io-test/run_sigma_benchmark.sh [adi-binary] [model-dir] [scheduler] [ays_sd15|ays_sdxl]
+#     model-dir defaults to sd/sd-base-model/onnx-sd-v15, scheduler to dpm_m
+#
+# Every schedule is rendered at each step count with the same prompt / seed and scored
+# against a 50-step default-schedule reference of the same scheduler:
+#   psnr  - peak signal-to-noise ratio (dB, higher is closer)
+#   ssim  - mean SSIM over 8x8 luma windows (1.0 is identical)
+#   time  - wall clock of the whole run (s), runs - UNet runs reported by the binary
+# Needs python3 + numpy + PIL for scoring.
+
+set -u
+
+ADI_BIN="${1:-cmake-build-debug-macos-arm64/bin/adi}"
+ROOT="$(cd "$(dirname "$0")/../.." && pwd)"
+MODEL="${2:-$ROOT/sd/sd-base-model/onnx-sd-v15}"
+SCHED="${3:-dpm_m}"
+AYS="${4:-ays_sd15}"
+OUT_DIR="$ROOT/sd/io-test/sigma-bench"
+mkdir -p "$OUT_DIR"
+
+STEPS="6 8 10 15 20 30"
+ARGS="-p \"A cat in the water at sunset\" -m txt2img -w 512 -h 512 -c 3 --seed 15 --dims 768
+  --clip $MODEL/text_encoder/model.onnx --unet $MODEL/unet/model.onnx
+  --vae-encoder $MODEL/vae_encoder/model.onnx --vae-decoder $MODEL/vae_decoder/model.onnx
+  --merges $MODEL/tokenizer/merges.txt --dict $MODEL/tokenizer/vocab.json
+  --beta-start 0.00085 --beta-end 0.012 --beta scaled_linear --alpha cos --tokenizer bpe --train-steps 1000
+  --predictor epsilon --guidance 7.5 --strength 0.0 --scheduler $SCHED"
+
+now() { python3 -c 'import time; print(time.time())'; }
+
+render() {
+  local out="$1"; shift
+  local log="${out%.png}.log"
+  local t0 t1
+  t0=$(now)
+  eval "\"$ADI_BIN\" $ARGS -o \"$out\" $*" > "$log" 2>&1
+  t1=$(now)
+  python3 -c "print('%.2f' % ($t1 - $t0))"
+}
+
+score() {
+  python3 - "$1" "$2" <<'EOF'
+import sys
+import numpy as np
+from PIL import Image
+ref = np.asarray(Image.open(sys.argv[1]).convert('L'), dtype=np.float64)
+img = np.asarray(Image.open(sys.argv[2]).convert('L'), dtype=np.float64)
+mse = np.mean((ref - img) ** 2)
+psnr = 99.0 if mse == 0 else 10 * np.log10(255.0 ** 2 / mse)
+h, w = (ref.shape[0] // 8) * 8, (ref.shape[1] // 8) * 8
+a = ref[:h, :w].reshape(h // 8, 8, w // 8, 8).transpose(0, 2, 1, 3).reshape(-1, 64)
+b = img[:h, :w].reshape(h // 8, 8, w // 8, 8).transpose(0, 2, 1, 3).reshape(-1, 64)
+c1, c2 = (0.01 * 255) ** 2, (0.03 * 255) ** 2
+ma, mb = a.mean(1), b.mean(1)
+va, vb = a.var(1), b.var(1)
+cov = ((a - ma[:, None]) * (b - mb[:, None])).mean(1)
+ssim = ((2 * ma * mb + c1) * (2 * cov + c2)) / ((ma ** 2 + mb ** 2 + c1) * (va + vb + c2))
+print("%.2f %.4f" % (psnr, ssim.mean()))
+EOF
+}
+
+REF="$OUT_DIR/reference-$SCHED-default-s50.png"
+if [ ! -f "$REF" ]; then
+  echo "== reference: $SCHED default 50 steps"
+  render "$REF" --sigma default --steps 50 > /dev/null
+fi
+[ -f "$REF" ] || { echo "reference render failed, see ${REF%.png}.log"; exit 1; }
+
+printf "%-10s %6s %6s %8s %8s %8s\n" "sigma" "steps" "runs" "psnr" "ssim" "time"
+for sigma in default karras "$AYS"; do
+  for steps in $STEPS; do
+    out="$OUT_DIR/$SCHED-$sigma-s$steps.png"
+    secs=$(render "$out" --sigma "$sigma" --steps "$steps")
+    if [ ! -f "$out" ]; then
+      printf "%-10s %6s %6s %8s\n" "$sigma" "$steps" "-" "FAILED"; continue
+    fi
+    runs=$(grep -o "UNet runs: [0-9]*" "${out%.png}.log" | tail -1 | awk '{print $3}')
+    read -r psnr ssim <<< "$(score "$REF" "$out")"
+    printf "%-10s %6s %6s %8s %8s %8s\n" "$sigma" "$steps" "${runs:--}" "$psnr" "$ssim" "$secs"
+  done
+done
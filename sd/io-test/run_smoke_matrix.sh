@@ -89,6 +89,12 @@ for s in euler_a unipc dpm_m pndm ipndm deis_m; do
     --scheduler $s --predictor epsilon --guidance 7.5 --steps 20
 done
 
+for s in euler_a dpm_m; do
+  run_case "v15-$s-ays-s10" $(model_args onnx-sd-v15) \
+    -w 512 -h 512 -c 3 --seed 15.0 --dims 768 $BASE \
+    --scheduler $s --sigma ays_sd15 --predictor epsilon --guidance 7.5 --steps 10
+done
+
 if [ "$MODE" == "full" ]; then
   # ---------- sd v2.1 768px (dims 1024, v_prediction) ----------
   for s in euler_a dpm_m; do
@@ -0,0 +1,126 @@
+#!/bin/bash
+# ADI tokenizer throughput benchmark: BPE (CLIP) next to WordPiece (BERT)
+#
+# Usage:
+#   bash sd/io-test/run_tokenizer_benchmark.sh [ort-root] [bpe-dict] [bpe-merges] [wp-vocab] [prompts]
+#     ort-root   onnxruntime package with include/ (and lib/), defaults to engine/onnxruntime/<first>
+#     bpe-dict   vocab.json or a compiled .adtk, defaults to the sd-v15 model tokenizer
+#     bpe-merges merges.txt, ignored for a .adtk dictionary
+#     wp-vocab   BERT vocab.txt (or its .adtk), word_piece is skipped without it
+#     prompts    one prompt per line, a built-in mix when omitted
+#
+# Compiles a small driver against the tokenizer sources (unity build, -O2) and reports per
+# tokenizer:
+#   init     - vocabulary (and merges / trie) load time (ms)
+#   prompt/s - prompts encoded per second, attention parsing included
+#   token/s  - non-padding tokens produced per second
+# Every prompt is encoded once before timing so both word caches start warm.
+
+set -u
+
+ROOT="$(cd "$(dirname "$0")/../.." && pwd)"
+ORT_ROOT="${1:-$(ls -d "$ROOT"/engine/onnxruntime/*/ 2>/dev/null | head -1)}"
+MODEL="$ROOT/sd/sd-base-model/onnx-sd-v15"
+BPE_DICT="${2:-$MODEL/tokenizer/vocab.json}"
+BPE_MERGES="${3:-$MODEL/tokenizer/merges.txt}"
+WP_VOCAB="${4:-}"
+PROMPTS="${5:-}"
+OUT_DIR="$ROOT/sd/io-test/tokenizer-bench"
+mkdir -p "$OUT_DIR"
+
+[ -d "$ORT_ROOT/include" ] || { echo "onnxruntime headers not found, pass [ort-root]"; exit 1; }
+
+if [ -z "$PROMPTS" ]; then
+  PROMPTS="$OUT_DIR/prompts.txt"
+  cat > "$PROMPTS" <<'TXT'
+A cat in the water at sunset
+masterpiece, best quality, (ultra detailed:1.2), portrait of a young woman, soft lighting, bokeh
+Beautiful LANDSCAPE, highly detailed painting of an astronaut riding a horse on mars, trending on artstation
+[blurry], (low quality:1.4), watermark, text, signature, jpeg artifacts, deformed hands, extra fingers
+a photo of an old wooden house in a snowy forest BREAK northern lights, long exposure, 35mm, f/1.8
+cyberpunk street market at night, neon signs, rain reflections, crowded, cinematic composition, 8k
+TXT
+fi
+
+DRIVER="$OUT_DIR/tokenizer_bench.cc"
+cat > "$DRIVER" <<'CPP'
+#include "tokenizer_register.cc"
+using namespace onnx::sd::tokenizer;
+
+template<class Base>
+struct Bench : Base {
+    using Base::Base;
+    using Base::encode;
+    using Base::parse_prompt_attention;
+    using Base::get_pad_token_index;
+};
+
+template<class Tokenizer>
+static void run(const char *name_, TokenizerConfig config_, const std::vector<std::string> &prompts_) {
+    typedef std::chrono::steady_clock Clock;
+    Bench<Tokenizer> tokenizer_(config_);
+    auto t0_ = Clock::now();
+    tokenizer_.init();
+    auto t1_ = Clock::now();
+
+    size_t tokens_ = 0;
+    int32_t pad_ = tokenizer_.get_pad_token_index();
+    for (const auto &prompt_ : prompts_) tokenizer_.encode(tokenizer_.parse_prompt_attention(prompt_));
+
+    const int rounds_ = int(std::max<size_t>(1, 20000 / prompts_.size()));
+    auto t2_ = Clock::now();
+    for (int r = 0; r < rounds_; ++r) {
+        for (const auto &prompt_ : prompts_) {
+            auto encoded_ = tokenizer_.encode(tokenizer_.parse_prompt_attention(prompt_));
+            for (int32_t token_ : std::get<0>(encoded_)) tokens_ += (token_ != pad_);
+        }
+    }
+    auto t3_ = Clock::now();
+    double secs_ = std::chrono::duration<double>(t3_ - t2_).count();
+    printf("%-10s %10.2f %12.0f %12.0f\n", name_,
+           std::chrono::duration<double, std::milli>(t1_ - t0_).count(),
+           double(rounds_ * prompts_.size()) / secs_, double(tokens_) / secs_);
+    tokenizer_.uninit();
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> prompts_;
+    std::ifstream file_(argv[1]);
+    for (std::string line_; std::getline(file_, line_);) if (!line_.empty()) prompts_.push_back(line_);
+    if (prompts_.empty()) return 1;
+
+    TokenizerConfig config_{};
+    config_.avail_token_size = 77;
+    config_.major_boundary_factor = 1.0f;
+    printf("%-10s %10s %12s %12s\n", "tokenizer", "init(ms)", "prompt/s", "token/s");
+
+    config_.tokenizer_dictionary_at = argv[2];
+    config_.tokenizer_aggregates_at = argv[3];
+    config_.avail_token_count = 49408;
+    run<BPETokenizer>("bpe", config_, prompts_);
+
+    if (argc > 4) {
+        config_.tokenizer_dictionary_at = argv[4];
+        config_.tokenizer_aggregates_at = "";
+        config_.avail_token_count = 30522;
+        run<WPTokenizer>("word_piece", config_, prompts_);
+    }
+    return 0;
+}
+CPP
+
+INCLUDES="-I$ORT_ROOT/include"
+for dir in $(find "$ROOT/source" -type d); do INCLUDES="$INCLUDES -I$dir"; done
+LIBS="-lpthread"
+[ -d "$ORT_ROOT/lib" ] && LIBS="-L$ORT_ROOT/lib -Wl,-rpath,$ORT_ROOT/lib -lonnxruntime $LIBS"
+
+BIN="$OUT_DIR/tokenizer_bench"
+echo "== building driver"
+c++ -std=c++17 -O2 $INCLUDES "$DRIVER" -o "$BIN" $LIBS || { echo "driver build failed"; exit 1; }
+
+if [ -n "$WP_VOCAB" ] && [ -f "$WP_VOCAB" ]; then
+  "$BIN" "$PROMPTS" "$BPE_DICT" "$BPE_MERGES" "$WP_VOCAB"
+else
+  echo "(word_piece skipped: no [wp-vocab] given)"
+  "$BIN" "$PROMPTS" "$BPE_DICT" "$BPE_MERGES"
+fi
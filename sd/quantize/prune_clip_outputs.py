@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# ADI offline output pruner for CLIP text encoders
+#
+# SDXL-style exports list every hidden_states.N layer as a graph output; ADI reads only
+# the conditioning layer and the pooled embedding. Pruning the rest from the graph outputs
+# (and the nodes only they needed) keeps the runtime from ever producing them.
+#
+# Usage:
+#   python3 sd/quantize/prune_clip_outputs.py --model <sd>/text_encoder_2/model.onnx \
+#           --output <sd>/text_encoder_2-pruned/model.onnx --layer penultimate
+#   adi ... --clip2 <sd>/text_encoder_2-pruned/model.onnx
+#
+# --layer must match the unit's use_penultimate setting: a pruned export keeps only the
+# layer it was pruned for, and the CLIP unit reads that one whatever it is configured to.
+
+import argparse
+import os
+
+import onnx
+
+
+def pick_outputs(graph, layer):
+    names = [o.name for o in graph.output]
+    layers = [n for n in names if n.startswith("hidden_states.")]
+    if layer == "penultimate" and len(layers) >= 2:
+        hidden = "hidden_states.%d" % (len(layers) - 2)
+    elif "last_hidden_state" in names:
+        hidden = "last_hidden_state"
+    else:
+        raise RuntimeError("no hidden state output to keep in %s" % names)
+    kept = [hidden] + [n for n in ("pooler_output", "text_embeds") if n in names]
+    return kept
+
+
+def prune_dead_nodes(graph):
+    # walk back from the kept outputs, every node nothing kept depends on is dropped
+    live = {o.name for o in graph.output}
+    kept_nodes = []
+    for node in reversed(graph.node):
+        if any(name in live for name in node.output):
+            kept_nodes.append(node)
+            live.update(name for name in node.input if name)
+    del graph.node[:]
+    graph.node.extend(reversed(kept_nodes))
+
+    # older IR versions also list initializers as graph inputs, those go with them
+    dropped = {init.name for init in graph.initializer if init.name not in live}
+    initializers = [init for init in graph.initializer if init.name not in dropped]
+    inputs = [i for i in graph.input if i.name not in dropped]
+    del graph.initializer[:]
+    graph.initializer.extend(initializers)
+    del graph.input[:]
+    graph.input.extend(inputs)
+    return len(kept_nodes)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Prune an ADI CLIP onnx unit to the outputs it reads")
+    parser.add_argument("--model", required=True, help="text encoder onnx model")
+    parser.add_argument("--output", required=True, help="pruned onnx model")
+    parser.add_argument("--layer", choices=["last", "penultimate"], default="penultimate",
+                        help="hidden state kept as conditioning (SDXL: penultimate)")
+    args = parser.parse_args()
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+
+    model = onnx.load(args.model)
+    large_model = model.ByteSize() > (1 << 30)
+
+    kept = pick_outputs(model.graph, args.layer)
+    outputs = [o for o in model.graph.output if o.name in kept]
+    dropped = len(model.graph.output) - len(outputs)
+    del model.graph.output[:]
+    model.graph.output.extend(outputs)
+    node_count = prune_dead_nodes(model.graph)
+
+    # bigG text encoders exceed the 2GB protobuf limit, keep weights as external data
+    onnx.save_model(
+        model, args.output,
+        save_as_external_data=large_model, all_tensors_to_one_file=True,
+        location=os.path.basename(args.output) + ".data",
+    )
+    print("pruned %s -> %s (kept %s, dropped %d outputs, %d nodes left)" % (
+        args.model, args.output, ", ".join(kept), dropped, node_count))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+# ADI offline quantizer for CLIP / UNet units
+#
+# Usage:
+#   1. capture calibration inputs from real runs (repeat with varied prompts/seeds):
+#        adi ... --calibration-dump sd/quantize/calib
+#      -> sd/quantize/calib/<unit>/<sample>/<input_name>.npy   (unit: clip / clip_2 / unet)
+#   2. quantize:
+#        python3 sd/quantize/quantize_sd_unit.py static  --model unet/model.onnx \
+#                --output unet-int8/model.onnx --calibration sd/quantize/calib/unet
+#        python3 sd/quantize/quantize_sd_unit.py dynamic --model text_encoder/model.onnx \
+#                --output text_encoder-int8/model.onnx
+#   3. run:
+#        adi ... --unet unet-int8/model.onnx --unet-precision int8
+#
+# static  -> QDQ format with int8 weights & activations, ranges from the dumped inputs
+# dynamic -> int8 weights, activation ranges computed at runtime (no calibration needed,
+#            usually the better fit for CLIP)
+
+import argparse
+import os
+import random
+import tempfile
+
+import numpy as np
+from onnxruntime.quantization import (
+    CalibrationDataReader, CalibrationMethod, QuantFormat, QuantType,
+    quantize_dynamic, quantize_static,
+)
+from onnxruntime.quantization.shape_inference import quant_pre_process
+import onnx
+
+
+class DumpedInputsReader(CalibrationDataReader):
+    """Feeds <calibration>/<sample>/<input_name>.npy dirs written by --calibration-dump."""
+
+    def __init__(self, model_path, calibration_dir, max_samples):
+        model = onnx.load(model_path, load_external_data=False)
+        initializers = {init.name for init in model.graph.initializer}
+        self.input_names = [i.name for i in model.graph.input if i.name not in initializers]
+
+        samples = sorted(
+            os.path.join(calibration_dir, d) for d in os.listdir(calibration_dir)
+            if os.path.isdir(os.path.join(calibration_dir, d))
+        )
+        if max_samples and len(samples) > max_samples:
+            # spread the budget over every captured run / step instead of the first few
+            samples = sorted(random.Random(0).sample(samples, max_samples))
+        if not samples:
+            raise RuntimeError("no calibration samples found under %s" % calibration_dir)
+        self.samples = iter(samples)
+
+    def get_next(self):
+        sample = next(self.samples, None)
+        if sample is None:
+            return None
+        feeds = {}
+        for name in self.input_names:
+            feeds[name] = np.load(os.path.join(sample, name.replace('/', '_') + '.npy'))
+        return feeds
+
+
+def quantize(args, source_model, large_model):
+    if args.mode == "dynamic":
+        quantize_dynamic(
+            source_model, args.output,
+            weight_type=QuantType.QInt8,
+            per_channel=args.per_channel,
+            use_external_data_format=large_model,
+        )
+    else:
+        quantize_static(
+            source_model, args.output,
+            DumpedInputsReader(source_model, args.calibration, args.max_samples),
+            quant_format=QuantFormat.QDQ,
+            activation_type=QuantType.QInt8,
+            weight_type=QuantType.QInt8,
+            per_channel=args.per_channel,
+            calibrate_method={
+                "minmax": CalibrationMethod.MinMax,
+                "entropy": CalibrationMethod.Entropy,
+                "percentile": CalibrationMethod.Percentile,
+            }[args.method],
+            use_external_data_format=large_model,
+            # symmetric int8 activations map onto the S8S8 QDQ kernels on CPU
+            extra_options={"ActivationSymmetric": True, "CalibMovingAverage": True},
+        )
+
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Quantize an ADI CLIP / UNet onnx unit to int8")
+    parser.add_argument("mode", choices=["static", "dynamic"])
+    parser.add_argument("--model", required=True, help="float32 onnx model")
+    parser.add_argument("--output", required=True, help="quantized onnx model")
+    parser.add_argument("--calibration", help="dumped inputs of this unit (static only)")
+    parser.add_argument("--max-samples", type=int, default=128, help="calibration samples used (0: all)")
+    parser.add_argument("--method", choices=["minmax", "entropy", "percentile"], default="minmax")
+    parser.add_argument("--per-channel", action="store_true", help="per-channel weight scales")
+    parser.add_argument("--skip-preprocess", action="store_true", help="skip shape inference / graph cleanup")
+    args = parser.parse_args()
+
+    if args.mode == "static" and not args.calibration:
+        parser.error("static mode needs --calibration <dump>/<unit>")
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+
+    # SD UNets exceed the 2GB protobuf limit, keep weights as external data throughout
+    header = onnx.load(args.model, load_external_data=False)
+    large_model = os.path.getsize(args.model) > (1 << 30) or any(
+        t.data_location == onnx.TensorProto.EXTERNAL for t in header.graph.initializer
+    )
+
+    with tempfile.TemporaryDirectory() as work_dir:
+        source_model = args.model
+        if not args.skip_preprocess:
+            source_model = os.path.join(work_dir, "model.preprocessed.onnx")
+            quant_pre_process(args.model, source_model, save_as_external_data=large_model)
+        quantize(args, source_model, large_model)
+
+    print("quantized %s -> %s (%s)" % (args.model, args.output, args.mode))
+
+
+if __name__ == "__main__":
+    main()
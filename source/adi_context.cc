@@ -37,6 +37,11 @@ typedef struct OrtSD_Config {
     float sd_scale_guidance            ; //= 0.9f;
     float sd_random_intensity          ; //= 1.0f;
     float sd_decode_scale_strength     ; //= 0.18215f;
+    PrecisionConfig sd_precision_config; //= DEFAULT_PRECISION_CONFIG;
+    std::string sd_calibration_dump_at ; //= "" (no dump);
+    float sd_img2img_strength          ; //= 1.0f (full schedule);
+    GuidanceConfig sd_guidance_config  ; //= DEFAULT_GUIDANCE_CONFIG;
+    std::string sd_embedding_bank_at   ; //= "" (no bank);
 } OrtSD_Config;
 
 class OrtSD_Context {
@@ -55,7 +60,8 @@ private:
     OrtSD_Config ort_config;
     OrtSD_Remain ort_remain;
 
-    Clip *ort_sd_clip = nullptr;
+    ClipEmbeddingBank ort_bank;                 // precompiled catalog conditioning, checked before CLIP
+    Clip *ort_sd_clip = nullptr;                // with a bank: loaded by the first prompt it misses
     Clip *ort_sd_clip_2 = nullptr;              // SDXL text_encoder_2 (nullptr when unused)
     UNet *ort_sd_unet = nullptr;
     VAE *ort_sd_vae_encoder = nullptr;
@@ -64,6 +70,9 @@ private:
 private:
     Tensor convert_images(const IMAGE_DATA &image_data_) const;
     IMAGE_DATA convert_result(const Tensor &infer_output_) const;
+    uint64_t encoder_hash() const;
+    void init_clip();
+    std::vector<ClipEmbedResult> condition(const std::vector<std::string> &prompts_);
 
 public:
     explicit OrtSD_Context(const OrtSD_Config& ort_config_);
@@ -72,7 +81,11 @@ public:
     void init();
     void prepare(const std::string &positive_prompts_, const std::string &negative_prompts_);
     IMAGE_DATA inference(IMAGE_DATA image_data_);
+    void snapshot(const std::string &snapshot_path_, uint64_t snapshot_step_, bool snapshot_stop_);
+    IMAGE_DATA resume(const std::string &snapshot_path_, const UNetResume &resume_);
     void release();
+    uint64_t unet_runs();
+    bool compile_bank(const std::vector<std::string> &prompts_, const std::string &bank_path_);
 };
 
 OrtSD_Context::OrtSD_Context(const OrtSD_Config& ort_config_){
@@ -93,24 +106,21 @@ OrtSD_Context::~OrtSD_Context(){
 
 Tensor OrtSD_Context::convert_images(const IMAGE_DATA &image_data_) const {
     if (!image_data_.data_) return TensorHelper::empty<float>();
-    IMAGE_BYTE* input_data_ = image_data_.data_;
-    vector<float> convert_value_(image_data_.size_);
-
-    for (int w = 0; w < ort_config.sd_input_width; ++w) {
-        for (int h = 0; h < ort_config.sd_input_height; ++h) {
-            for (int c = 0; c < ort_config.sd_input_channel; ++c) {
-                if (c >= 3) { continue; }
-                int cur_pixel_ = int(h * ort_config.sd_input_width + w) * int(ort_config.sd_input_channel) + c;
-                int tensor_at_ = int(c * ort_config.sd_input_height + h) * int(ort_config.sd_input_width) + w;
-                convert_value_[tensor_at_] = (float(input_data_[cur_pixel_]) / 255.0f);
-            }
-        }
+    long w_ = long(ort_config.sd_input_width);
+    long h_ = long(ort_config.sd_input_height);
+    long c_ = long(ort_config.sd_input_channel);
+    if (c_ < 3 || image_data_.size_ < uint64_t(w_ * h_ * c_)) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: input image smaller than width * height * channel"));
     }
 
-    int w_ = int(ort_config.sd_input_width);
-    int h_ = int(ort_config.sd_input_height);
+    // RGB(A) bytes -> VAE-ready [1, 3, H, W] in [-1, 1], written straight into the tensor
     TensorShape convert_shape_{1, 3, h_, w_};
-    return TensorHelper::create(convert_shape_, convert_value_);
+    Tensor convert_tensor_ = TensorHelper::allocate<float>(convert_shape_);
+    ImageHelper::deinterleave(
+        image_data_.data_, h_, w_, c_,
+        convert_tensor_.GetTensorMutableData<float>(), 3, 2.0f / 255.0f, -1.0f
+    );
+    return convert_tensor_;
 }
 
 IMAGE_DATA OrtSD_Context::convert_result(const onnx::sd::base::Tensor &tensor_) const {
@@ -130,26 +140,26 @@ IMAGE_DATA OrtSD_Context::convert_result(const onnx::sd::base::Tensor &tensor_)
         throw std::runtime_error("Batch size > 1 is not supported");
     }
 
-    uint64_t image_size_ = uint64_t(height * width * channels);
+    // VAE decoder output [-1, 1] -> RGB bytes, /2 + 0.5 fused into the interleave
+    uint64_t image_size_ = uint64_t(height) * uint64_t(width) * uint64_t(channels);
     auto tensor_data_ = tensor_.GetTensorData<float>();
     auto image_data_ = new IMAGE_BYTE[image_size_];
-
-    for (int c = 0; c < channels; ++c) {
-        for (int h = 0; h < height; ++h) {
-            for (int w = 0; w < width; ++w) {
-                int tensor_at_ = (c * height + h) * width + w;
-                int cur_pixel_ = (h * width + w) * channels + c;
-                image_data_[cur_pixel_] = static_cast<IMAGE_BYTE>(std::round(
-                    min(max(tensor_data_[tensor_at_], 0.0f), 1.0f) * 255
-                ));
-            }
-        }
-    }
+    ImageHelper::interleave(tensor_data_, height, width, channels, image_data_, 0.5f, 0.5f);
 
     return IMAGE_DATA{image_data_, image_size_};
 }
 
-void OrtSD_Context::init() {
+uint64_t OrtSD_Context::encoder_hash() const {
+    std::vector<std::string> encoder_paths_ = {ort_config.sd_modelpath_config.onnx_clip_path};
+    if (!ort_config.sd_modelpath_config.onnx_clip_2_path.empty()) {
+        encoder_paths_.push_back(ort_config.sd_modelpath_config.onnx_clip_2_path);
+    }
+    return ClipEmbeddingBank::encoder_hash(
+        encoder_paths_, ort_config.sd_tokenizer_config, ort_config.sd_precision_config.sd_clip_precision
+    );
+}
+
+void OrtSD_Context::init_clip() {
     const bool with_clip_2_ = !ort_config.sd_modelpath_config.onnx_clip_2_path.empty();
 
     // SDXL: both encoders condition on the penultimate hidden state
@@ -170,6 +180,26 @@ void OrtSD_Context::init() {
         );
     }
 
+    ort_sd_clip->set_precision(ort_config.sd_precision_config.sd_clip_precision);
+    if (ort_sd_clip_2) ort_sd_clip_2->set_precision(ort_config.sd_precision_config.sd_clip_precision);
+
+    // calibration mode: capture real CLIP inputs for offline static quantization
+    if (!ort_config.sd_calibration_dump_at.empty()) {
+        ort_sd_clip->set_calibration_dump(ort_config.sd_calibration_dump_at, "clip");
+        if (ort_sd_clip_2) ort_sd_clip_2->set_calibration_dump(ort_config.sd_calibration_dump_at, "clip_2");
+    }
+
+    ort_sd_clip->init(*ort_executor);
+    if (ort_sd_clip_2) ort_sd_clip_2->init(*ort_executor);
+}
+
+void OrtSD_Context::init() {
+    // a bank that covers the served prompts leaves the text encoders unloaded
+    if (!ort_config.sd_embedding_bank_at.empty()) {
+        ort_bank.attach(ort_config.sd_embedding_bank_at, encoder_hash());
+    }
+    if (ort_bank.empty()) init_clip();
+
     ort_sd_unet = new UNet(
         ort_config.sd_modelpath_config.onnx_unet_path,
         {
@@ -179,7 +209,9 @@ void OrtSD_Context::init() {
             ort_config.sd_input_height / 8,
             4,
             ort_config.sd_scale_guidance,
-            ort_config.sd_random_intensity
+            ort_config.sd_random_intensity,
+            ort_config.sd_img2img_strength,
+            ort_config.sd_guidance_config
         }
     );
 
@@ -203,45 +235,93 @@ void OrtSD_Context::init() {
         }
     );
 
-    ort_sd_clip->init(*ort_executor);
-    if (ort_sd_clip_2) ort_sd_clip_2->init(*ort_executor);
+    // per-unit precision, e.g. INT8 CLIP/UNet with a float VAE
+    const PrecisionConfig &precision_ = ort_config.sd_precision_config;
+    ort_sd_unet->set_precision(precision_.sd_unet_precision);
+    ort_sd_vae_encoder->set_precision(precision_.sd_vae_precision);
+    ort_sd_vae_decoder->set_precision(precision_.sd_vae_precision);
+
+    // calibration mode: capture real UNet inputs for offline static quantization
+    if (!ort_config.sd_calibration_dump_at.empty()) {
+        ort_sd_unet->set_calibration_dump(ort_config.sd_calibration_dump_at, "unet");
+    }
+
     ort_sd_unet->init(*ort_executor);
     ort_sd_vae_encoder->init(*ort_executor);
     ort_sd_vae_decoder->init(*ort_executor);
 }
 
+std::vector<ClipEmbedResult> OrtSD_Context::condition(const std::vector<std::string> &prompts_) {
+    if (!ort_sd_clip) init_clip();
+
+    // every chunk of every prompt goes through each text encoder in one batched run;
+    // SDXL's two encoders are independent sessions and run concurrently
+    std::future<ClipEncodedBatch> encoded_2_;
+    if (ort_sd_clip_2) {
+        encoded_2_ = std::async(std::launch::async, [this, &prompts_] { return ort_sd_clip_2->encode(prompts_); });
+    }
+    ClipEncodedBatch encoded_ = ort_sd_clip->encode(prompts_);
+    ClipEncodedBatch encoded_2_result_;
+    if (ort_sd_clip_2) encoded_2_result_ = encoded_2_.get();
+
+    // each prompt's conditioning is allocated once and every encoder writes its weighted chunks
+    // into its own columns: [1, 77 * N, 768] txt_encoder_1, SDXL [1, 77 * N, 768 + 1280] with the
+    // pooled conditioning from the 2nd encoder
+    std::vector<ClipEmbedResult> results_(prompts_.size());
+    for (size_t p = 0; p < prompts_.size(); ++p) {
+        TensorShape shape_ = ort_sd_clip->hidden_shape(encoded_, p);
+        const long column_2_ = long(shape_[2]);
+        if (ort_sd_clip_2) {
+            TensorShape shape_2_ = ort_sd_clip_2->hidden_shape(encoded_2_result_, p);
+            if (shape_2_[1] != shape_[1]) {
+                amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: clip encoders chunked a prompt differently"));
+            }
+            shape_[2] += shape_2_[2];
+        }
+        results_[p].hidden = TensorHelper::allocate<float>(shape_);
+        ort_sd_clip->write_hidden(encoded_, p, results_[p].hidden, 0);
+        if (ort_sd_clip_2) {
+            ort_sd_clip_2->write_hidden(encoded_2_result_, p, results_[p].hidden, column_2_);
+            results_[p].pooled = ort_sd_clip_2->pooled(encoded_2_result_, p);
+        }
+    }
+    return results_;
+}
+
 void OrtSD_Context::prepare(const std::string &positive_prompts_, const std::string &negative_prompts_){
     // make sure thread security, prevent prepare & inference conflict
     std::lock_guard<std::mutex> lock(ort_thread_lock);
 
-    // embeded_positive_ [1, 77 * pos_N, 768], txt_encoder_1
-    ClipEmbedResult embed_pos_ = ort_sd_clip->embedding(positive_prompts_);
-    ClipEmbedResult embed_neg_ = ort_sd_clip->embedding(negative_prompts_);
-
-    if (ort_sd_clip_2) {
-        // SDXL: concat dual-encoder hiddens on the feature dim ([1,77,768]+[1,77,1280] -> [1,77,2048]),
-        // pooled conditioning comes from the 2nd encoder's pooled output
-        ClipEmbedResult embed_pos_2_ = ort_sd_clip_2->embedding(positive_prompts_);
-        ClipEmbedResult embed_neg_2_ = ort_sd_clip_2->embedding(negative_prompts_);
-        ort_remain.embeded_positive = TensorHelper::concat_last_dim<float>(embed_pos_.hidden, embed_pos_2_.hidden);
-        ort_remain.embeded_negative = TensorHelper::concat_last_dim<float>(embed_neg_.hidden, embed_neg_2_.hidden);
-        ort_remain.pooled_positive  = std::move(embed_pos_2_.pooled);
-        ort_remain.pooled_negative  = std::move(embed_neg_2_.pooled);
-    } else {
-        ort_remain.embeded_positive = std::move(embed_pos_.hidden);
-        ort_remain.embeded_negative = std::move(embed_neg_.hidden);
+    // catalog prompts come from the bank, only the rest are tokenized and encoded
+    const std::vector<std::string> prompts_ = {positive_prompts_, negative_prompts_};
+    std::vector<ClipEmbedResult> results_(prompts_.size());
+    std::vector<std::string> missed_;
+    std::vector<size_t> missed_at_;
+    for (size_t p = 0; p < prompts_.size(); ++p) {
+        if (ort_bank.find(prompts_[p], results_[p])) continue;
+        missed_.push_back(prompts_[p]);
+        missed_at_.push_back(p);
     }
+    if (!missed_.empty()) {
+        std::vector<ClipEmbedResult> encoded_ = condition(missed_);
+        for (size_t i = 0; i < missed_at_.size(); ++i) results_[missed_at_[i]] = std::move(encoded_[i]);
+    }
+
+    ort_remain.embeded_positive = std::move(results_[0].hidden);
+    ort_remain.embeded_negative = std::move(results_[1].hidden);
+    if (TensorHelper::have_data(results_[0].pooled)) ort_remain.pooled_positive = std::move(results_[0].pooled);
+    if (TensorHelper::have_data(results_[1].pooled)) ort_remain.pooled_negative = std::move(results_[1].pooled);
 }
 
 IMAGE_DATA OrtSD_Context::inference(IMAGE_DATA image_data_) {
     // make sure thread security, prevent prepare & inference conflict
     std::lock_guard<std::mutex> lock(ort_thread_lock);
 
-    // input_image [1, 3, 512, 512]
+    // input_image [1, 3, 512, 512], already mapped to [-1, 1]
     Tensor sample_image_ = convert_images(image_data_);
 
     // encoded_image [1, 4, 64, 64]
-    Tensor encoded_sample_ = ort_sd_vae_encoder->encode(sample_image_);
+    Tensor encoded_sample_ = ort_sd_vae_encoder->encode(std::move(sample_image_));
 
     // infered_latent_ [1, 4, 64, 64]
     Tensor infered_latent_ = ort_sd_unet->inference(
@@ -249,18 +329,46 @@ IMAGE_DATA OrtSD_Context::inference(IMAGE_DATA image_data_) {
         ort_remain.pooled_positive, ort_remain.pooled_negative,
         encoded_sample_
     );
+    if (ort_sd_unet->preempted()) return IMAGE_DATA{nullptr, 0};
 
-    // infered_latent_ [1, 3, 512, 512]
+    // decoded_tensor_ [1, 3, 512, 512], raw decoder range [-1, 1]
     Tensor decoded_tensor_ = ort_sd_vae_decoder->decode(infered_latent_);
 
     return convert_result(decoded_tensor_);
 }
 
+// arms the next inference / resume: write its trajectory state before evaluation snapshot_step_
+void OrtSD_Context::snapshot(const std::string &snapshot_path_, uint64_t snapshot_step_, bool snapshot_stop_) {
+    std::lock_guard<std::mutex> lock(ort_thread_lock);
+    ort_sd_unet->set_snapshot(snapshot_path_, snapshot_step_, snapshot_stop_);
+}
+
+// continues a snapshot; conditioning comes from the last prepare() when resume_ asks for it
+IMAGE_DATA OrtSD_Context::resume(const std::string &snapshot_path_, const UNetResume &resume_) {
+    std::lock_guard<std::mutex> lock(ort_thread_lock);
+
+    Tensor infered_latent_ = ort_sd_unet->resume(
+        snapshot_path_, resume_,
+        ort_remain.embeded_positive, ort_remain.embeded_negative,
+        ort_remain.pooled_positive, ort_remain.pooled_negative
+    );
+    if (ort_sd_unet->preempted()) return IMAGE_DATA{nullptr, 0};
+
+    Tensor decoded_tensor_ = ort_sd_vae_decoder->decode(infered_latent_);
+    return convert_result(decoded_tensor_);
+}
+
+// UNet evaluations of the last inference / resume, the cost of a run for adaptive schedulers
+uint64_t OrtSD_Context::unet_runs() {
+    std::lock_guard<std::mutex> lock(ort_thread_lock);
+    return ort_sd_unet ? ort_sd_unet->last_unet_runs() : 0;
+}
+
 void OrtSD_Context::release(){
     ort_sd_vae_decoder->release(*ort_executor);
     ort_sd_vae_encoder->release(*ort_executor);
     ort_sd_unet->release(*ort_executor);
-    ort_sd_clip->release(*ort_executor);
+    if (ort_sd_clip) ort_sd_clip->release(*ort_executor);
     if (ort_sd_clip_2) ort_sd_clip_2->release(*ort_executor);
 
     delete ort_sd_vae_decoder;
@@ -268,6 +376,36 @@ void OrtSD_Context::release(){
     delete ort_sd_unet;
     delete ort_sd_clip;
     delete ort_sd_clip_2;
+    ort_sd_vae_decoder = nullptr;
+    ort_sd_vae_encoder = nullptr;
+    ort_sd_unet = nullptr;
+    ort_sd_clip = nullptr;
+    ort_sd_clip_2 = nullptr;
+    ort_bank.clear();
+}
+
+// encodes a prompt catalog with the configured text encoders into a bank for sd_embedding_bank_at;
+// the empty prompt (the usual negative) is always included
+bool OrtSD_Context::compile_bank(const std::vector<std::string> &prompts_, const std::string &bank_path_) {
+    std::lock_guard<std::mutex> lock(ort_thread_lock);
+
+    std::vector<std::string> catalog_ = {""};
+    std::unordered_set<std::string> listed_ = {""};
+    for (const std::string &prompt_ : prompts_) {
+        if (listed_.insert(prompt_).second) catalog_.push_back(prompt_);
+    }
+
+    // bounded encoder batches, a catalog may hold thousands of prompts
+    const size_t group_size_ = 16;
+    std::vector<ClipEmbedResult> embeds_;
+    embeds_.reserve(catalog_.size());
+    for (size_t at_ = 0; at_ < catalog_.size(); at_ += group_size_) {
+        std::vector<std::string> group_(
+            catalog_.begin() + long(at_), catalog_.begin() + long(std::min(at_ + group_size_, catalog_.size()))
+        );
+        for (ClipEmbedResult &embed_ : condition(group_)) embeds_.push_back(std::move(embed_));
+    }
+    return ClipEmbeddingBank::compile(encoder_hash(), catalog_, embeds_, bank_path_);
 }
 
 } // namespace context
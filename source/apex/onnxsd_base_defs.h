@@ -11,27 +11,55 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstdint>
+#include <cstring>
 
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <functional>
 #include <map>
 #include <cmath>
+#include <numeric>
 #include <mutex>
+#include <thread>
+#include <future>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <queue>
 #include <vector>
+#include <array>
 #include <random>
 #include <atomic>
 #include <sstream>
 #include <fstream>
+#include <filesystem>
 #include <iostream>
 #include <memory>
 #include <regex>
 #include <tuple>
 #include <unordered_map>
+#include <unordered_set>
+
+#if defined(__F16C__) || ((defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)) || \
+    (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+    #define SD_X86_F16C     // F16C half <-> float conversion, picked at runtime unless the compiler targets it
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+    #include <arm_neon.h>   // NEON half <-> float conversion
+#endif
 
 #ifdef _WIN32
     #define WIN32_LEAN_AND_MEAN
     #include <Windows.h>    // Only Windows should include windows.h
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
 #endif
 
 #include "onnxruntime_cxx_api.h"
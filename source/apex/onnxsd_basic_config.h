@@ -59,6 +59,47 @@ typedef struct ORTBasicsConfig {
     GraphOptimizationLevel onnx_graph_optimize;
 } ORTBasicsConfig;
 
+/* Model Precision (per unit) */
+typedef enum PrecisionType {
+    PRECISION_AUTO              = 0,    // run the model as exported, IO adapted by declared types
+    PRECISION_FP32              = 1,
+    PRECISION_FP16              = 2,    // fp16 export, checked against the declared IO types
+    PRECISION_INT8              = 3,    // QDQ / dynamically quantized export
+} PrecisionType;
+
+#define DEFAULT_PRECISION_CONFIG                            \
+    {                                                       \
+        /*sd_clip_precision*/          PRECISION_AUTO,      \
+        /*sd_unet_precision*/          PRECISION_AUTO,      \
+        /*sd_vae_precision*/           PRECISION_AUTO,      \
+    }
+
+typedef struct PrecisionConfig {
+    PrecisionType sd_clip_precision;
+    PrecisionType sd_unet_precision;
+    PrecisionType sd_vae_precision;
+} PrecisionConfig;
+
+/* Classifier-Free Guidance Window */
+typedef enum GuidanceScheduleType {
+    GUIDANCE_SCHEDULE_CONSTANT  = 0,    // full guidance scale over the whole window
+    GUIDANCE_SCHEDULE_LINEAR    = 1,    // scale decays linearly to 1 at the window end
+    GUIDANCE_SCHEDULE_COSINE    = 2,    // scale decays along a half cosine to 1 at the window end
+} GuidanceScheduleType;
+
+#define DEFAULT_GUIDANCE_CONFIG                                     \
+    {                                                               \
+        /*sd_guidance_start*/          0.0f,                        \
+        /*sd_guidance_end*/            1.0f,                        \
+        /*sd_guidance_schedule*/       GUIDANCE_SCHEDULE_CONSTANT,  \
+    }
+
+typedef struct GuidanceConfig {
+    float sd_guidance_start;                    // fraction of the trajectory where CFG starts, [0, 1)
+    float sd_guidance_end;                      // fraction of the trajectory where CFG ends, (0, 1]
+    GuidanceScheduleType sd_guidance_schedule;
+} GuidanceConfig;
+
 /* Diffusion Scheduler Settings ===========================================*/
 /* Scheduler Type Provide */
 typedef enum SchedulerType {
@@ -76,6 +117,7 @@ typedef enum SchedulerType {
     SCHEDULER_PNDM              = 11,
     SCHEDULER_IPNDM             = 12,
     SCHEDULER_DEIS_M            = 13,
+    SCHEDULER_ADAPTIVE          = 14,
 } SchedulerType;
 
 typedef enum BetaScheduleType {
@@ -98,6 +140,8 @@ typedef enum PredictionType {
 typedef enum SigmaScheduleType {
     SIGMA_TYPE_DEFAULT          = 0,
     SIGMA_TYPE_KARRAS           = 1,
+    SIGMA_TYPE_AYS_SD15         = 2,    // Align Your Steps, tuned for SD1.x (scaled_linear betas)
+    SIGMA_TYPE_AYS_SDXL         = 3,    // Align Your Steps, tuned for SDXL
 } SigmaType;
 
 #define DEFAULT_SCHEDULER_CONFIG                             \
@@ -111,7 +155,8 @@ typedef enum SigmaScheduleType {
         /*scheduler_beta_type*/         BETA_TYPE_LINEAR,    \
         /*scheduler_alpha_type*/        ALPHA_TYPE_COSINE,   \
         /*scheduler_predict_type*/      PREDICT_TYPE_EPSILON,\
-        /*scheduler_sigma_type*/        SIGMA_TYPE_DEFAULT   \
+        /*scheduler_sigma_type*/        SIGMA_TYPE_DEFAULT,  \
+        /*scheduler_tolerance*/         0.0f                 \
     }
 
 typedef struct SchedulerConfig {
@@ -125,6 +170,7 @@ typedef struct SchedulerConfig {
     AlphaType scheduler_alpha_type;
     PredictionType scheduler_predict_type;
     SigmaType scheduler_sigma_type;
+    float scheduler_tolerance;              // adaptive only: relative error tolerance (0: default)
 } SchedulerConfig;
 
 /* Diffusion Tokenizer Settings ===========================================*/
@@ -0,0 +1,164 @@
+/*
+ * BasicPool
+ * Definition: shared CPU work pool for host-side tensor math
+ * Created by Arikan.Li on 2026/10/19.
+ */
+#ifndef ONNX_SD_CORE_POOL_ONCE
+#define ONNX_SD_CORE_POOL_ONCE
+
+#include "onnxsd_basic_refs.h"
+
+namespace onnx {
+namespace sd {
+namespace base {
+
+/**
+ * Process-wide worker pool, lazily created on first use and shared by every
+ * context. Workers sleep on a condition variable between jobs, so the pool
+ * costs nothing while ORT sessions are running.
+ */
+class WorkPool {
+private:
+    typedef std::function<void()> WorkTask;
+
+    std::vector<std::thread> pool_workers;
+    std::deque<WorkTask> pool_tasks;
+    std::mutex pool_lock;
+    std::condition_variable pool_cond;
+    bool pool_stop = false;
+
+    static bool &inside_worker() {
+        static thread_local bool inside_worker_ = false;
+        return inside_worker_;
+    }
+
+    void worker_loop() {
+        inside_worker() = true;
+        while (true) {
+            WorkTask task_;
+            {
+                std::unique_lock<std::mutex> lock_(pool_lock);
+                pool_cond.wait(lock_, [this] { return pool_stop || !pool_tasks.empty(); });
+                if (pool_stop && pool_tasks.empty()) return;
+                task_ = std::move(pool_tasks.front());
+                pool_tasks.pop_front();
+            }
+            task_();
+        }
+    }
+
+    explicit WorkPool(uint32_t worker_count_) {
+        for (uint32_t i = 0; i < worker_count_; ++i) {
+            pool_workers.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+public:
+    ~WorkPool() {
+        {
+            std::lock_guard<std::mutex> lock_(pool_lock);
+            pool_stop = true;
+        }
+        pool_cond.notify_all();
+        for (auto &worker_ : pool_workers) {
+            if (worker_.joinable()) worker_.join();
+        }
+    }
+
+    WorkPool(const WorkPool &) = delete;
+    WorkPool &operator=(const WorkPool &) = delete;
+
+    static WorkPool &shared() {
+        // caller thread always takes a share too, so one less worker than cores
+        static WorkPool shared_pool_(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return shared_pool_;
+    }
+
+    uint32_t concurrency() const {
+        return uint32_t(pool_workers.size()) + 1;
+    }
+
+    bool nested() const {
+        return inside_worker();
+    }
+
+    void submit(WorkTask task_) {
+        {
+            std::lock_guard<std::mutex> lock_(pool_lock);
+            pool_tasks.emplace_back(std::move(task_));
+        }
+        pool_cond.notify_one();
+    }
+};
+
+class ParallelHelper {
+public:
+    typedef std::function<void(long, long)> RangeBody;
+
+    // below this many elements a loop is cheaper on the calling thread
+    static constexpr long SD_PARALLEL_GRAIN = 16384;
+
+    /**
+     * Run body_(begin_, end_) over [0, size_) split in contiguous blocks. Blocks
+     * are claimed through an atomic cursor, so the caller works alongside the pool
+     * and never waits on a block it could have taken itself. Each index is owned
+     * by exactly one block, bodies write only to their own range.
+     */
+    static void parallel_for(long size_, const RangeBody &body_, long grain_ = SD_PARALLEL_GRAIN) {
+        if (size_ <= 0) return;
+        WorkPool &pool_ = WorkPool::shared();
+        long block_count_ = std::min<long>(long(pool_.concurrency()), (size_ + grain_ - 1) / std::max(grain_, 1L));
+        if (block_count_ <= 1 || pool_.nested()) {
+            body_(0, size_);
+            return;
+        }
+
+        struct RangeState {
+            RangeBody body;
+            long size;
+            long block_count;
+            std::atomic<long> next_block{0};
+            std::atomic<long> done_block{0};
+            std::exception_ptr failure;
+            std::mutex state_lock;
+            std::condition_variable state_cond;
+        };
+        auto state_ = std::make_shared<RangeState>();
+        state_->body = body_;
+        state_->size = size_;
+        state_->block_count = block_count_;
+
+        auto drain_ = [](const std::shared_ptr<RangeState> &state_) {
+            long block_;
+            while ((block_ = state_->next_block.fetch_add(1)) < state_->block_count) {
+                long begin_ = state_->size * block_ / state_->block_count;
+                long end_ = state_->size * (block_ + 1) / state_->block_count;
+                try {
+                    state_->body(begin_, end_);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock_(state_->state_lock);
+                    if (!state_->failure) state_->failure = std::current_exception();
+                }
+                if (state_->done_block.fetch_add(1) + 1 == state_->block_count) {
+                    std::lock_guard<std::mutex> lock_(state_->state_lock);
+                    state_->state_cond.notify_all();
+                }
+            }
+        };
+
+        for (long i = 1; i < block_count_; ++i) {
+            pool_.submit([state_, drain_] { drain_(state_); });
+        }
+        drain_(state_);
+
+        std::unique_lock<std::mutex> lock_(state_->state_lock);
+        state_->state_cond.wait(lock_, [&] { return state_->done_block.load() == state_->block_count; });
+        if (state_->failure) std::rethrow_exception(state_->failure);
+    }
+};
+
+} // namespace base
+} // namespace sd
+} // namespace onnx
+
+#endif  // ONNX_SD_CORE_POOL_ONCE
@@ -7,47 +7,118 @@
 #define ONNX_SD_CORE_TOOLS_ONCE
 
 #include "onnxsd_basic_refs.h"
+#include "onnxsd_basic_pool.cc"
 
 namespace onnx {
 namespace sd {
 namespace base {
 using namespace amon;
 
+/**
+ * Counter-based Gaussian noise (Philox4x32-10 + Box-Muller, both outputs kept).
+ * Every value is a pure function of (seed, request, step, element), so results do
+ * not depend on call order, thread count or whether a batch is split. One Philox
+ * block yields four normals for elements [4k, 4k + 4).
+ */
 class RandomGenerator {
-protected:
-    std::default_random_engine random_generator;
-//    std::normal_distribution<float> random_style;
-    std::uniform_real_distribution<float> random_style;
-
 public:
-    explicit RandomGenerator(float mean_ = 0.0f, float stddev_ = 1.0f) {
-        random_style = std::uniform_real_distribution<float>();
-//        random_style = std::normal_distribution<float>(mean_, stddev_);
+    static constexpr uint32_t SD_NOISE_STEP_INITIAL = 0xFFFFFFFFu;   // step slot reserved for initial latents
+
+private:
+    typedef std::array<uint32_t, 4> PhiloxBlock;
+
+    static constexpr uint32_t PHILOX_M0 = 0xD2511F53u;
+    static constexpr uint32_t PHILOX_M1 = 0xCD9E8D57u;
+    static constexpr uint32_t PHILOX_W0 = 0x9E3779B9u;
+    static constexpr uint32_t PHILOX_W1 = 0xBB67AE85u;
+
+    uint32_t random_key[2] = {0, 0};
+    uint64_t random_request = 0;
+
+    static PhiloxBlock philox(PhiloxBlock counter_, uint32_t key_0_, uint32_t key_1_) {
+        for (int r = 0; r < 10; ++r) {
+            uint64_t p0_ = uint64_t(PHILOX_M0) * counter_[0];
+            uint64_t p1_ = uint64_t(PHILOX_M1) * counter_[2];
+            counter_ = {
+                uint32_t(p1_ >> 32) ^ counter_[1] ^ key_0_, uint32_t(p1_),
+                uint32_t(p0_ >> 32) ^ counter_[3] ^ key_1_, uint32_t(p0_)
+            };
+            key_0_ += PHILOX_W0;
+            key_1_ += PHILOX_W1;
+        }
+        return counter_;
+    }
+
+    static float uniform_open(uint32_t bits_) {      // (0, 1), never 0 so log is safe
+        return (float(bits_ >> 8) + 0.5f) * (1.0f / 16777216.0f);
+    }
+
+    void normal_block(uint64_t block_, uint32_t step_, float out_[4]) const {
+        PhiloxBlock bits_ = philox(
+            {uint32_t(block_), uint32_t(block_ >> 32), step_, uint32_t(random_request)},
+            random_key[0], random_key[1]
+        );
+        for (int p = 0; p < 2; ++p) {
+            float radius_ = std::sqrt(-2.0f * std::log(uniform_open(bits_[2 * p])));
+            float theta_ = float(2.0f * M_PI) * uniform_open(bits_[2 * p + 1]);
+            out_[2 * p]     = radius_ * std::cos(theta_);
+            out_[2 * p + 1] = radius_ * std::sin(theta_);
+        }
     }
 
-    ~RandomGenerator() {
-        random_style.reset();
+public:
+    explicit RandomGenerator(int64_t seed_ = 0) {
+        seed(seed_);
     }
 
+    ~RandomGenerator() = default;
+
     void seed(int64_t seed_) {
-        if (seed_ == 0) return;
         if (seed_ == -1) {
             std::random_device rd;
             std::mt19937 gen(rd());
             std::uniform_int_distribution<> dis(0, (std::numeric_limits<int>::max)());
             seed_ = dis(gen);
         }
-        this->random_generator.seed(int(seed_));
+        random_key[0] = uint32_t(uint64_t(seed_));
+        random_key[1] = uint32_t(uint64_t(seed_) >> 32);
     }
 
-    float next() {
-        float u1 = random_style(random_generator);
-        float u2 = random_style(random_generator);
-        float radius = std::sqrt(-2.0f * std::log(u1));
-        float theta = float(2.0f * M_PI) * u2;
-        float standard = radius * std::cos(theta);
-        return standard;
-//        return random_style(random_generator);
+    // one request = one full denoise trajectory, chosen by the caller (0 for a plain run)
+    void request(uint64_t request_) {
+        random_request = request_;
+    }
+
+    uint64_t request() const {
+        return random_request;
+    }
+
+    // seed in effect (the drawn one when seeded with -1)
+    int64_t seed() const {
+        return int64_t(uint64_t(random_key[0]) | (uint64_t(random_key[1]) << 32));
+    }
+
+    /**
+     * out_[i] = N(0, 1)(seed, request, step_, i) * factor_, filled in parallel
+     */
+    void normal(float *out_, long size_, uint32_t step_, float factor_ = 1.0f) const {
+        ParallelHelper::parallel_for((size_ + 3) / 4, [&](long begin_, long end_) {
+            float block_out_[4];
+            for (long b = begin_; b < end_; ++b) {
+                normal_block(uint64_t(b), step_, block_out_);
+                long base_ = b * 4;
+                long count_ = std::min(4L, size_ - base_);
+                for (long k = 0; k < count_; ++k) {
+                    out_[base_ + k] = block_out_[k] * factor_;
+                }
+            }
+        }, ParallelHelper::SD_PARALLEL_GRAIN / 4);
+    }
+
+    std::vector<float> normal(long size_, uint32_t step_, float factor_ = 1.0f) const {
+        std::vector<float> result_(size_);
+        normal(result_.data(), size_, step_, factor_);
+        return result_;
     }
 };
 
@@ -75,6 +146,176 @@ public:
         }
         return sum * h;
     }
+
+    // points_-point Gauss-Legendre, exact for polynomials up to degree 2 * points_ - 1;
+    // nodes are the Legendre roots refined by Newton from the Chebyshev guess (double precision)
+    template<class T, class F>
+    static T gauss_legendre_integral(const F &f, T a, T b, int points_) {
+        points_ = std::max(points_, 1);
+        const double mid_ = 0.5 * (double(b) + double(a));
+        const double half_ = 0.5 * (double(b) - double(a));
+        double sum_ = 0;
+        for (int i = 0; i < (points_ + 1) / 2; ++i) {
+            double x_ = std::cos(M_PI * (i + 0.75) / (points_ + 0.5));
+            double derivative_ = 1;
+            for (int iteration_ = 0; iteration_ < 100; ++iteration_) {
+                double p0_ = 1, p1_ = 0;
+                for (int k = 1; k <= points_; ++k) {        // P_k by the three-term recurrence
+                    double p2_ = p1_;
+                    p1_ = p0_;
+                    p0_ = ((2 * k - 1) * x_ * p1_ - (k - 1) * p2_) / k;
+                }
+                derivative_ = points_ * (x_ * p0_ - p1_) / (x_ * x_ - 1);
+                double next_ = x_ - p0_ / derivative_;
+                bool converged_ = std::abs(next_ - x_) < 1e-15;
+                x_ = next_;
+                if (converged_) break;
+            }
+            double weight_ = 2 / ((1 - x_ * x_) * derivative_ * derivative_);
+            sum_ += weight_ * double(f(T(mid_ + half_ * x_)));
+            if (2 * i + 1 != points_) sum_ += weight_ * double(f(T(mid_ - half_ * x_)));    // symmetric node
+        }
+        return T(sum_ * half_);
+    }
+};
+
+#if defined(SD_X86_F16C) && !defined(__F16C__) && defined(__GNUC__)
+    #define SD_F16C_TARGET __attribute__((target("avx,f16c")))
+#else
+    #define SD_F16C_TARGET
+#endif
+
+/**
+ * Host-boundary precision conversion for FP16/BF16 model IO. Scalar paths are
+ * bit-exact round-to-nearest-even (inf/nan/subnormal kept); F16C (x86, chosen at
+ * runtime when the build does not target it) or NEON (aarch64) handles the bulk
+ * of half conversion.
+ */
+class PrecisionHelper {
+private:
+    static uint32_t bits_of(float value_) { uint32_t bits_; std::memcpy(&bits_, &value_, 4); return bits_; }
+    static float float_of(uint32_t bits_) { float value_; std::memcpy(&value_, &bits_, 4); return value_; }
+
+#if defined(SD_X86_F16C)
+    static bool f16c_supported() {
+#if defined(__F16C__)
+        return true;
+#elif defined(_MSC_VER)
+        static const bool supported_ = [] {
+            int info_[4];
+            __cpuid(info_, 1);
+            const bool f16c_ = (info_[2] & (1 << 29)) != 0;
+            const bool avx_ = (info_[2] & (1 << 28)) != 0 && (info_[2] & (1 << 27)) != 0;   // AVX + OSXSAVE
+            return f16c_ && avx_ && (_xgetbv(0) & 0x6) == 0x6;                             // YMM state enabled
+        }();
+        return supported_;
+#else
+        static const bool supported_ = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+        return supported_;
+#endif
+    }
+
+    // bulk of [begin_, end_) in blocks of 8, returns where the scalar tail starts
+    SD_F16C_TARGET static long to_half_f16c(const float *src_, uint16_t *dst_, long begin_, long end_) {
+        long i = begin_;
+        for (; i + 8 <= end_; i += 8) {
+            __m128i half_ = _mm256_cvtps_ph(_mm256_loadu_ps(src_ + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst_ + i), half_);
+        }
+        return i;
+    }
+
+    SD_F16C_TARGET static long from_half_f16c(const uint16_t *src_, float *dst_, long begin_, long end_) {
+        long i = begin_;
+        for (; i + 8 <= end_; i += 8) {
+            __m128i half_ = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src_ + i));
+            _mm256_storeu_ps(dst_ + i, _mm256_cvtph_ps(half_));
+        }
+        return i;
+    }
+#endif
+
+public:
+    static uint16_t half_from_float(float value_) {
+        uint32_t bits_ = bits_of(value_);
+        uint32_t sign_ = (bits_ >> 16) & 0x8000u;
+        bits_ &= 0x7FFFFFFFu;
+        uint16_t half_;
+        if (bits_ >= 0x47800000u) {                     // overflow, inf, nan
+            half_ = (bits_ > 0x7F800000u) ? 0x7E00u : 0x7C00u;
+        } else if (bits_ < 0x38800000u) {               // half subnormal or zero
+            uint32_t rounded_ = bits_of(float_of(bits_) + 0.5f);
+            half_ = uint16_t(rounded_ - 0x3F000000u);
+        } else {
+            uint32_t mant_odd_ = (bits_ >> 13) & 1u;
+            bits_ += 0xC8000FFFu + mant_odd_;           // rebias exponent, round to nearest even
+            half_ = uint16_t(bits_ >> 13);
+        }
+        return uint16_t(half_ | sign_);
+    }
+
+    static float float_from_half(uint16_t half_) {
+        uint32_t bits_ = uint32_t(half_ & 0x7FFFu) << 13;
+        uint32_t exp_ = bits_ & 0x0F800000u;
+        bits_ += 0x38000000u;
+        if (exp_ == 0x0F800000u) {                      // inf, nan
+            bits_ += 0x38000000u;
+        } else if (exp_ == 0) {                         // subnormal
+            bits_ += 0x00800000u;
+            bits_ = bits_of(float_of(bits_) - float_of(0x38800000u));
+        }
+        return float_of(bits_ | (uint32_t(half_ & 0x8000u) << 16));
+    }
+
+    static uint16_t bfloat_from_float(float value_) {
+        uint32_t bits_ = bits_of(value_);
+        if ((bits_ & 0x7FFFFFFFu) > 0x7F800000u) return uint16_t((bits_ >> 16) | 0x40u);   // quiet nan
+        return uint16_t((bits_ + 0x7FFFu + ((bits_ >> 16) & 1u)) >> 16);
+    }
+
+    static float float_from_bfloat(uint16_t bfloat_) {
+        return float_of(uint32_t(bfloat_) << 16);
+    }
+
+    static void to_half(const float *src_, uint16_t *dst_, long size_) {
+        ParallelHelper::parallel_for(size_, [&](long begin_, long end_) {
+            long i = begin_;
+#if defined(SD_X86_F16C)
+            if (f16c_supported()) i = to_half_f16c(src_, dst_, i, end_);
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+            for (; i + 4 <= end_; i += 4) {
+                vst1_u16(dst_ + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src_ + i))));
+            }
+#endif
+            for (; i < end_; ++i) dst_[i] = half_from_float(src_[i]);
+        });
+    }
+
+    static void from_half(const uint16_t *src_, float *dst_, long size_) {
+        ParallelHelper::parallel_for(size_, [&](long begin_, long end_) {
+            long i = begin_;
+#if defined(SD_X86_F16C)
+            if (f16c_supported()) i = from_half_f16c(src_, dst_, i, end_);
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+            for (; i + 4 <= end_; i += 4) {
+                vst1q_f32(dst_ + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src_ + i))));
+            }
+#endif
+            for (; i < end_; ++i) dst_[i] = float_from_half(src_[i]);
+        });
+    }
+
+    static void to_bfloat(const float *src_, uint16_t *dst_, long size_) {
+        ParallelHelper::parallel_for(size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; ++i) dst_[i] = bfloat_from_float(src_[i]);
+        });
+    }
+
+    static void from_bfloat(const uint16_t *src_, float *dst_, long size_) {
+        ParallelHelper::parallel_for(size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; ++i) dst_[i] = float_from_bfloat(src_[i]);
+        });
+    }
 };
 
 class TensorHelper {
@@ -219,6 +460,141 @@ public:
         }
     }
 
+    static size_t get_element_size(ONNXTensorElementDataType type) {
+        switch (type) {
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+                return 1;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16:
+                return 2;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32:
+                return 4;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_COMPLEX64:
+                return 8;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_COMPLEX128:
+                return 16;
+            default:
+                throw logic_error("Unsupported tensor type.");
+        }
+    }
+
+    // float32 / float16 / bfloat16: the element types the host math converts between
+    static bool is_float_type(ONNXTensorElementDataType type) {
+        return type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT ||
+               type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16 ||
+               type == ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16;
+    }
+
+    // non-owning alias of input_ (same buffer, type and shape), for binding without copies
+    static Tensor view(const Tensor &input_) {
+        auto input_info_ = input_.GetTensorTypeAndShapeInfo();
+        TensorShape input_shape_ = input_info_.GetShape();
+        ONNXTensorElementDataType input_type_ = input_info_.GetElementType();
+        size_t input_bytes_ = input_info_.GetElementCount() * get_element_size(input_type_);
+        return Tensor::CreateTensor(
+            input_.GetTensorMemoryInfo(), const_cast<void *>(input_.GetTensorRawData()), input_bytes_,
+            input_shape_.data(), input_shape_.size(), input_type_
+        );
+    }
+
+    // non-owning alias of the index_-th [shape_] block of input_ (e.g. one chunk of a batched output)
+    template<class T>
+    static Tensor view(const Tensor &input_, long index_, const TensorShape &shape_) {
+        long block_size_ = GET_TENSOR_DATA_SIZE(shape_, 1);
+        if (long(input_.GetTensorTypeAndShapeInfo().GetElementCount()) < (index_ + 1) * block_size_) {
+            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: tensor view out of range"));
+        }
+        auto *block_data_ = const_cast<T *>(input_.GetTensorData<T>()) + index_ * block_size_;
+        return Tensor::CreateTensor<T>(
+            input_.GetTensorMemoryInfo(), block_data_, size_t(block_size_),
+            shape_.data(), shape_.size()
+        );
+    }
+
+    /**
+     * Convert between float32 / float16 / bfloat16 into a new tensor of the same shape.
+     * Same-type requests return a view, other types are rejected.
+     */
+    static Tensor convert(const Tensor &input_, ONNXTensorElementDataType target_) {
+        auto input_info_ = input_.GetTensorTypeAndShapeInfo();
+        ONNXTensorElementDataType source_ = input_info_.GetElementType();
+        if (source_ == target_) return view(input_);
+        if (!is_float_type(source_) || !is_float_type(target_)) {
+            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: precision convert supports float32/float16/bfloat16 only"));
+        }
+
+        TensorShape input_shape_ = input_info_.GetShape();
+        long input_size_ = long(input_info_.GetElementCount());
+        std::vector<float> staging_;
+        const float *source_data_ = nullptr;
+        if (source_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+            source_data_ = input_.GetTensorData<float>();
+        } else {
+            staging_.resize(input_size_);
+            const auto *half_data_ = static_cast<const uint16_t *>(input_.GetTensorRawData());
+            if (source_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16) {
+                PrecisionHelper::from_half(half_data_, staging_.data(), input_size_);
+            } else {
+                PrecisionHelper::from_bfloat(half_data_, staging_.data(), input_size_);
+            }
+            source_data_ = staging_.data();
+        }
+
+        void *result_data_ = nullptr;
+        if (target_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+            auto *float_data_ = new float[input_size_];
+            std::copy(source_data_, source_data_ + input_size_, float_data_);
+            result_data_ = float_data_;
+        } else {
+            auto *half_data_ = new uint16_t[input_size_];
+            if (target_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16) {
+                PrecisionHelper::to_half(source_data_, half_data_, input_size_);
+            } else {
+                PrecisionHelper::to_bfloat(source_data_, half_data_, input_size_);
+            }
+            result_data_ = half_data_;
+        }
+
+        return Tensor::CreateTensor(
+            Ort::MemoryInfo::CreateCpu(
+                OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault
+            ), result_data_, size_t(input_size_) * get_element_size(target_),
+            input_shape_.data(), input_shape_.size(), target_
+        );
+    }
+
+    // write a float32/float16/bfloat16 tensor into a preallocated float buffer of the same size
+    static void convert_into(const Tensor &input_, float *output_data_) {
+        auto input_info_ = input_.GetTensorTypeAndShapeInfo();
+        ONNXTensorElementDataType source_ = input_info_.GetElementType();
+        long input_size_ = long(input_info_.GetElementCount());
+        const auto *half_data_ = static_cast<const uint16_t *>(input_.GetTensorRawData());
+        switch (source_) {
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT: {
+                const float *float_data_ = input_.GetTensorData<float>();
+                std::copy(float_data_, float_data_ + input_size_, output_data_);
+                break;
+            }
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+                PrecisionHelper::from_half(half_data_, output_data_, input_size_);
+                break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16:
+                PrecisionHelper::from_bfloat(half_data_, output_data_, input_size_);
+                break;
+            default:
+                amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: precision convert supports float32/float16/bfloat16 only"));
+        }
+    }
+
     template<class T>
     static Tensor empty() {
         return TensorHelper::create<T>(TensorShape{0}, std::vector<T>{});
@@ -233,9 +609,11 @@ public:
         long input_size_ = GET_TENSOR_DATA_SIZE(shape_, 1);
         auto result_data_ = new T[input_size_];
 
-        for (int i = 0; i < input_size_; i++) {
-            result_data_[i] = value_[i];
-        }
+        ParallelHelper::parallel_for(input_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = value_[i];
+            }
+        });
 
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
             Ort::MemoryInfo::CreateCpu(
@@ -247,14 +625,34 @@ public:
         return result_tensor_;
     }
 
+    // uninitialized tensor, for producers that fill every element themselves
     template<class T>
-    static Tensor random(TensorShape shape_, RandomGenerator random_, float factor_ = 1.0f) {
+    static Tensor allocate(TensorShape shape_) {
         long input_size_ = GET_TENSOR_DATA_SIZE(shape_, 1);
         auto result_data_ = new T[input_size_];
 
-        for (int i = 0; i < input_size_; i++) {
-            result_data_[i] = random_.next() * factor_;
-        }
+        Tensor result_tensor_ = Tensor::CreateTensor<T>(
+            Ort::MemoryInfo::CreateCpu(
+                OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault
+            ), result_data_, input_size_,
+            shape_.data(), shape_.size()
+        );
+
+        return result_tensor_;
+    }
+
+    template<class T>
+    static Tensor random(TensorShape shape_, const RandomGenerator &random_, float factor_ = 1.0f,
+                         uint32_t step_ = RandomGenerator::SD_NOISE_STEP_INITIAL) {
+        long input_size_ = GET_TENSOR_DATA_SIZE(shape_, 1);
+        auto result_data_ = new T[input_size_];
+
+        std::vector<float> noise_ = random_.normal(input_size_, step_, factor_);
+        ParallelHelper::parallel_for(input_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = T(noise_[i]);
+            }
+        });
 
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
             Ort::MemoryInfo::CreateCpu(
@@ -267,35 +665,37 @@ public:
     }
 
     template<class T>
-    static Tensor blur(const Tensor &input_, RandomGenerator random_, float factor_ = 1.0f) {
+    static Tensor blur(const Tensor &input_, const RandomGenerator &random_, float factor_ = 1.0f,
+                       uint32_t step_ = RandomGenerator::SD_NOISE_STEP_INITIAL) {
         GET_TENSOR_DATA_INFO(input_, input_data_, input_shape_, input_size_, T);
-        auto result_data_ = new T[input_size_];
 
         int64_t max_w_ = input_shape_[3];
         int64_t max_h_ = input_shape_[2];
         int64_t max_c_ = input_shape_[1];
         int64_t max_s_ = input_shape_[0];
         int64_t out_c_ = max_c_ / 2;
+        int64_t plane_ = max_h_ * max_w_;
+        long result_size_ = long(max_s_ * out_c_ * plane_);
+        auto result_data_ = new T[result_size_];
 
-        for (int i = 0; i < max_s_; i++) {
-            for (int c = 0; c < out_c_; c++) {
-                for (int h = 0; h < max_h_; h++) {
-                    for (int w = 0; w < max_w_; w++) {
-                        int64_t cur_at_ = (((i * max_c_ + c) * max_h_ + h) * max_w_ + w) ;
-                        int64_t var_at_ = (((i * max_c_ + (c + out_c_)) * max_h_ + h) * max_w_ + w) ;
-                        float mean_ = input_data_[cur_at_];
-                        float logvar_ = input_data_[var_at_];
-                        logvar_ = max(-30.0f, min(logvar_, 20.0f));
-                        result_data_[i] = mean_ + std::exp(0.5f * logvar_) * random_.next();
-                        result_data_[i] *= factor_;
-                    }
-                }
+        std::vector<float> noise_ = random_.normal(result_size_, step_);
+        ParallelHelper::parallel_for(result_size_, [&](long begin_, long end_) {
+            for (long o_ = begin_; o_ < end_; o_++) {
+                int64_t i = o_ / (out_c_ * plane_);
+                int64_t c = (o_ / plane_) % out_c_;
+                int64_t p = o_ % plane_;
+                int64_t cur_at_ = (i * max_c_ + c) * plane_ + p;
+                int64_t var_at_ = (i * max_c_ + (c + out_c_)) * plane_ + p;
+                float mean_ = input_data_[cur_at_];
+                float logvar_ = input_data_[var_at_];
+                logvar_ = max(-30.0f, min(logvar_, 20.0f));
+                result_data_[o_] = (mean_ + std::exp(0.5f * logvar_) * noise_[o_]) * factor_;
             }
-        }
+        });
 
         TensorShape result_shape_{max_s_, out_c_, max_h_, max_w_};
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
-            input_.GetTensorMemoryInfo(), result_data_, input_size_,
+            input_.GetTensorMemoryInfo(), result_data_, result_size_,
             result_shape_.data(), result_shape_.size()
         );
 
@@ -307,13 +707,15 @@ public:
         GET_TENSOR_DATA_INFO(input_, input_data_, input_shape_, input_size_, T);
         auto result_data_ = new T[input_size_];
 
-        for (int i = 0; i < input_size_; i++) {
-            result_data_[i] = (
-                normalize_ ?
-                min(max((input_data_[i] / denominator_ + offset_), 0.0f), 1.0f) :
-                (input_data_[i] / denominator_ + offset_)
-            );
-        }
+        ParallelHelper::parallel_for(long(input_size_), [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = (
+                    normalize_ ?
+                    min(max((input_data_[i] / denominator_ + offset_), 0.0f), 1.0f) :
+                    (input_data_[i] / denominator_ + offset_)
+                );
+            }
+        });
 
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
             input_.GetTensorMemoryInfo(), result_data_, input_size_,
@@ -328,9 +730,11 @@ public:
         GET_TENSOR_DATA_INFO(input_, input_data_, input_shape_, input_size_, T);
         auto result_data_ = new T[input_size_];
 
-        for (int i = 0; i < input_size_; i++) {
-            result_data_[i] = input_data_[i] * multiplier_ + offset_;
-        }
+        ParallelHelper::parallel_for(long(input_size_), [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = input_data_[i] * multiplier_ + offset_;
+            }
+        });
 
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
             input_.GetTensorMemoryInfo(), result_data_, input_size_,
@@ -345,10 +749,12 @@ public:
         GET_TENSOR_DATA_INFO(input_, input_data_, input_shape_, input_size_, T);
         T* result_data_ = new T[input_size_ * 2];
 
-        for (int i = 0; i < input_size_; i++) {
-            result_data_[i] = input_data_[i];
-            result_data_[input_size_ + i] = input_data_[i];
-        }
+        ParallelHelper::parallel_for(long(input_size_), [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = input_data_[i];
+                result_data_[input_size_ + i] = input_data_[i];
+            }
+        });
 
         TensorShape result_shape_ = input_shape_;
         result_shape_[0] *= 2;
@@ -367,9 +773,11 @@ public:
         size_t input_size_ = input_.GetTensorTypeAndShapeInfo().GetElementCount();
         T* result_data_ = new T[input_size_];
 
-        for (size_t i = 0; i < input_size_; i++) {
-            result_data_[i] = static_cast<T>(input_data_[i]);
-        }
+        ParallelHelper::parallel_for(long(input_size_), [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = static_cast<T>(input_data_[i]);
+            }
+        });
 
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
             Ort::MemoryInfo::CreateCpu(
@@ -386,9 +794,9 @@ public:
         GET_TENSOR_DATA_INFO(input_, input_data_, input_shape_, input_size_, T);
         T* result_data_ = new T[input_size_];
 
-        for (int i = 0; i < input_size_; i++) {
-            result_data_[i] = input_data_[i];
-        }
+        ParallelHelper::parallel_for(long(input_size_), [&](long begin_, long end_) {
+            std::copy(input_data_ + begin_, input_data_ + end_, result_data_ + begin_);
+        });
 
         TensorShape result_shape_ = shape_.empty() ? input_shape_ : shape_;
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
@@ -413,17 +821,12 @@ public:
         int64_t max_s_ = input_shape_[0];
         int64_t out_s_ = max_s_ / 2;
 
-        for (int i = 0; i < out_s_; i++) {
-            for (int c = 0; c < max_c_; c++) {
-                for (int h = 0; h < max_h_; h++) {
-                    for (int w = 0; w < max_w_; w++) {
-                        int64_t data_at_ = (((i * max_c_ + c) * max_h_ + h) * max_w_ + w) ;
-                        split_data_l_[data_at_] = input_data_[data_at_];
-                        split_data_r_[data_at_] = input_data_[data_at_ + split_size_];
-                    }
-                }
-            }
-        }
+        // both halves are contiguous [out_s_, c, h, w] blocks, copied as flat ranges
+        long half_size_ = long(out_s_ * max_c_ * max_h_ * max_w_);
+        ParallelHelper::parallel_for(half_size_, [&](long begin_, long end_) {
+            std::copy(input_data_ + begin_, input_data_ + end_, split_data_l_ + begin_);
+            std::copy(input_data_ + split_size_ + begin_, input_data_ + split_size_ + end_, split_data_r_ + begin_);
+        });
 
         std::vector<Tensor> result_;
         result_.push_back(Tensor::CreateTensor<T>(
@@ -456,25 +859,27 @@ public:
         long concat_dim = long(input_shape_[offset_]);    //  77
         long newest_dim = concat_dim * tensor_num_; // 154
 
-        for (int l = 0; l < outer_dim; ++l) {           // 1
-            for (int m = 0; m < concat_dim; ++m) {      // 77
-                for (int i = 0; i < inner_dim; ++i) {   // 768
-                    for (long index_ = 0; index_ < tensor_num_; ++index_) {  // 2
-                        auto *input_data_ = input_tensors_[index_].GetTensorData<T>();
-                        long n = m + index_ * concat_dim;
-                        long old_index = l * concat_dim * inner_dim + m * inner_dim + i;
-                        long new_index = l * newest_dim * inner_dim + n * inner_dim + i;
-                        //  C6386: make sure in range
-                        if (new_index >= result_size_ || old_index >= input_size_) {
-                            delete[] result_data_;
-                            throw std::out_of_range("Index out of range");
-                        }
-                        result_data_[new_index] = input_data_[old_index];
-                    }
-                }
-            }
+        //  C6386: make sure in range
+        if (outer_dim * newest_dim * inner_dim > result_size_ || outer_dim * concat_dim * inner_dim > long(input_size_)) {
+            delete[] result_data_;
+            throw std::out_of_range("Index out of range");
         }
 
+        // every (outer, tensor, row) moves one contiguous inner_dim run
+        long row_count_ = outer_dim * tensor_num_ * concat_dim;
+        ParallelHelper::parallel_for(row_count_, [&](long begin_, long end_) {
+            for (long r = begin_; r < end_; ++r) {
+                long l = r / (tensor_num_ * concat_dim);
+                long index_ = (r / concat_dim) % tensor_num_;
+                long m = r % concat_dim;
+                auto *input_data_ = input_tensors_[index_].GetTensorData<T>();
+                long n = m + index_ * concat_dim;
+                long old_index = l * concat_dim * inner_dim + m * inner_dim;
+                long new_index = l * newest_dim * inner_dim + n * inner_dim;
+                std::copy(input_data_ + old_index, input_data_ + old_index + inner_dim, result_data_ + new_index);
+            }
+        }, std::max(1L, ParallelHelper::SD_PARALLEL_GRAIN / std::max(inner_dim, 1L)));
+
         TensorShape shape_ = input_shape_;
         shape_[offset_] *= tensor_num_;
 
@@ -506,14 +911,16 @@ public:
 
         long result_size_ = long(input_size_l_) + long(input_size_r_);
         T* result_data_ = new T[result_size_];
-        for (long o_ = 0; o_ < outer_l_; ++o_) {
-            for (long i_ = 0; i_ < inner_l_; ++i_) {
-                result_data_[o_ * (inner_l_ + inner_r_) + i_] = input_data_l_[o_ * inner_l_ + i_];
-            }
-            for (long i_ = 0; i_ < inner_r_; ++i_) {
-                result_data_[o_ * (inner_l_ + inner_r_) + inner_l_ + i_] = input_data_r_[o_ * inner_r_ + i_];
+        ParallelHelper::parallel_for(outer_l_, [&](long begin_, long end_) {
+            for (long o_ = begin_; o_ < end_; ++o_) {
+                for (long i_ = 0; i_ < inner_l_; ++i_) {
+                    result_data_[o_ * (inner_l_ + inner_r_) + i_] = input_data_l_[o_ * inner_l_ + i_];
+                }
+                for (long i_ = 0; i_ < inner_r_; ++i_) {
+                    result_data_[o_ * (inner_l_ + inner_r_) + inner_l_ + i_] = input_data_r_[o_ * inner_r_ + i_];
+                }
             }
-        }
+        }, std::max(1L, ParallelHelper::SD_PARALLEL_GRAIN / (inner_l_ + inner_r_)));
 
         TensorShape result_shape_ = input_shape_l_;
         result_shape_.back() = inner_l_ + inner_r_;
@@ -537,9 +944,11 @@ public:
         long result_size_ = long(input_size_l_);
         auto result_data_ = new T[result_size_];
 
-        for (int i = 0; i < result_size_; i++) {
-            result_data_[i] = input_data_l_[i] + guidance_scale_ * (input_data_r_[i] - input_data_l_[i]);
-        }
+        ParallelHelper::parallel_for(result_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = input_data_l_[i] + guidance_scale_ * (input_data_r_[i] - input_data_l_[i]);
+            }
+        });
 
         TensorShape result_shape_ = input_shape_l_;
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
@@ -552,24 +961,15 @@ public:
 
     template<class T>
     static Tensor weight(const Tensor &input_l_, const Tensor &input_r_, int offset_, bool re_normalize_ = false) {
-        GET_TENSOR_DATA_INFO(input_l_, input_data_l_, input_shape_l_, input_size_l_, T);
-        GET_TENSOR_DATA_INFO(input_r_, input_data_r_, input_shape_r_, input_size_r_, T);
+        TensorShape input_shape_l_ = input_l_.GetTensorTypeAndShapeInfo().GetShape();
+        size_t input_size_l_ = input_l_.GetTensorTypeAndShapeInfo().GetElementCount();
 
         long result_size_ = long(input_size_l_);
         auto result_data_ = new T[result_size_];
-
-        float original_mean_ = 0.0f;
-        float weighted_mean_ = 0.0f;
-        size_t elements_per_r = std::accumulate(
+        long elements_per_r = long(std::accumulate(
             input_shape_l_.begin() + offset_ + 1, input_shape_l_.end(), 1LL, std::multiplies<>()
-        );
-        for (size_t i = 0; i < size_t(input_shape_r_[offset_]); ++i) {
-            for (size_t j = 0; j < elements_per_r; ++j) {
-                result_data_[i * elements_per_r + j] = input_data_l_[i * elements_per_r + j] * input_data_r_[i];
-                original_mean_ += input_data_l_[i * elements_per_r + j] / float(input_size_l_) ;
-                weighted_mean_ += result_data_[i * elements_per_r + j] / float(input_size_l_) ;
-            }
-        }
+        ));
+        weight_into<T>(input_l_, input_r_, offset_, re_normalize_, result_data_, elements_per_r);
 
         TensorShape shape_ = input_shape_l_;
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
@@ -577,12 +977,66 @@ public:
             shape_.data(), shape_.size()
         );
 
-        if (re_normalize_){
-            float normalize_factor_ = original_mean_ / weighted_mean_;
-            result_tensor_ = multiple<T>(result_tensor_, normalize_factor_);
+        return result_tensor_;
+    }
+
+    // weight() written straight into a larger buffer: weighted row i (the elements under
+    // input_r_[i]) lands at result_data_ + i * result_stride_, e.g. one encoder's columns
+    // of a chunk inside the merged [1, 77 * N, hidden_dim] conditioning; re-normalization
+    // is applied in the same write
+    template<class T>
+    static void weight_into(const Tensor &input_l_, const Tensor &input_r_, int offset_, bool re_normalize_,
+                            T *result_data_, long result_stride_) {
+        GET_TENSOR_DATA_INFO(input_l_, input_data_l_, input_shape_l_, input_size_l_, T);
+        GET_TENSOR_DATA_INFO(input_r_, input_data_r_, input_shape_r_, input_size_r_, T);
+
+        size_t elements_per_r = std::accumulate(
+            input_shape_l_.begin() + offset_ + 1, input_shape_l_.end(), 1LL, std::multiplies<>()
+        );
+        long row_count_ = long(input_shape_r_[offset_]);
+        long grain_ = std::max(1L, ParallelHelper::SD_PARALLEL_GRAIN / std::max(long(elements_per_r), 1L));
+
+        // per-row partial means keep the reduction order fixed regardless of threading
+        float normalize_factor_ = 1.0f;
+        if (re_normalize_) {
+            std::vector<double> original_rows_(row_count_, 0.0);
+            std::vector<double> weighted_rows_(row_count_, 0.0);
+            ParallelHelper::parallel_for(row_count_, [&](long begin_, long end_) {
+                for (long i = begin_; i < end_; ++i) {
+                    for (size_t j = 0; j < elements_per_r; ++j) {
+                        T weighted_ = input_data_l_[i * elements_per_r + j] * input_data_r_[i];
+                        original_rows_[i] += input_data_l_[i * elements_per_r + j] / float(input_size_l_) ;
+                        weighted_rows_[i] += weighted_ / float(input_size_l_) ;
+                    }
+                }
+            }, grain_);
+            float original_mean_ = 0.0f;
+            float weighted_mean_ = 0.0f;
+            for (long i = 0; i < row_count_; ++i) {
+                original_mean_ += float(original_rows_[i]);
+                weighted_mean_ += float(weighted_rows_[i]);
+            }
+            normalize_factor_ = original_mean_ / weighted_mean_;
         }
 
-        return result_tensor_;
+        ParallelHelper::parallel_for(row_count_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; ++i) {
+                const T *row_l_ = input_data_l_ + i * elements_per_r;
+                T *row_result_ = result_data_ + i * result_stride_;
+                if (re_normalize_) {
+                    for (size_t j = 0; j < elements_per_r; ++j) {
+                        T weighted_ = row_l_[j] * input_data_r_[i];
+                        // + 0.0f is multiple()'s default offset: it turns -0.0 into +0.0, so the rows
+                        // stay bit-identical to the old weight-then-multiple() path
+                        row_result_[j] = weighted_ * normalize_factor_ + 0.0f;
+                    }
+                } else {
+                    for (size_t j = 0; j < elements_per_r; ++j) {
+                        row_result_[j] = row_l_[j] * input_data_r_[i];
+                    }
+                }
+            }
+        }, grain_);
     }
 
     template<class T>
@@ -597,9 +1051,11 @@ public:
         long result_size_ = long(input_size_l_);
         auto result_data_ = new T[result_size_];
 
-        for (int i = 0; i < result_size_; i++) {
-            result_data_[i] = input_data_l_[i] + input_data_r_[i];
-        }
+        ParallelHelper::parallel_for(result_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = input_data_l_[i] + input_data_r_[i];
+            }
+        });
 
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
             input_l_.GetTensorMemoryInfo(), result_data_, result_size_,
@@ -621,9 +1077,11 @@ public:
         long result_size_ = long(input_size_l_);
         auto result_data_ = new T[result_size_];
 
-        for (int i = 0; i < result_size_; i++) {
-            result_data_[i] = input_data_l_[i] - input_data_r_[i];
-        }
+        ParallelHelper::parallel_for(result_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                result_data_[i] = input_data_l_[i] - input_data_r_[i];
+            }
+        });
 
         Tensor result_tensor_ = Tensor::CreateTensor<T>(
             input_l_.GetTensorMemoryInfo(), result_data_, result_size_,
@@ -642,14 +1100,140 @@ public:
         return result_;
     }
 
+    /**
+     * Write input_ as a NumPy .npy (format 1.0, little-endian, C order) to file_path_,
+     * readable by np.load for offline calibration. Returns false on unsupported types
+     * or IO failure.
+     */
+    static bool save_npy(const Tensor &input_, const std::string &file_path_) {
+        auto input_info_ = input_.GetTensorTypeAndShapeInfo();
+        ONNXTensorElementDataType input_type_ = input_info_.GetElementType();
+        TensorShape input_shape_ = input_info_.GetShape();
+
+        std::string descr_;
+        switch (input_type_) {
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:   descr_ = "<f4"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16: descr_ = "<f2"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:  descr_ = "<f8"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:    descr_ = "|i1"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:   descr_ = "|u1"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:    descr_ = "|b1"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:   descr_ = "<i2"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:  descr_ = "<u2"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:   descr_ = "<i4"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32:  descr_ = "<u4"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:   descr_ = "<i8"; break;
+            case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64:  descr_ = "<u8"; break;
+            default: return false;  // bfloat16 / string / complex have no portable npy form
+        }
+
+        std::string header_ = "{'descr': '" + descr_ + "', 'fortran_order': False, 'shape': (";
+        for (size_t i = 0; i < input_shape_.size(); ++i) {
+            header_ += std::to_string(input_shape_[i]);
+            if (input_shape_.size() == 1 || i + 1 < input_shape_.size()) header_ += ",";
+            if (i + 1 < input_shape_.size()) header_ += " ";
+        }
+        header_ += "), }";
+        // magic(6) + version(2) + header_len(2) + header, padded to 64 bytes and '\n' terminated
+        size_t header_total_ = 10 + header_.size() + 1;
+        header_.append((64 - header_total_ % 64) % 64, ' ');
+        header_ += '\n';
+
+        std::ofstream npy_file_(file_path_, std::ios::binary);
+        if (!npy_file_) return false;
+        const char magic_[8] = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0};
+        const auto header_size_ = uint16_t(header_.size());
+        const char header_size_le_[2] = {char(header_size_ & 0xFF), char(header_size_ >> 8)};
+        npy_file_.write(magic_, sizeof(magic_));
+        npy_file_.write(header_size_le_, sizeof(header_size_le_));
+        npy_file_.write(header_.data(), std::streamsize(header_.size()));
+        npy_file_.write(
+            static_cast<const char *>(input_.GetTensorRawData()),
+            std::streamsize(input_info_.GetElementCount() * get_element_size(input_type_))
+        );
+        return bool(npy_file_);
+    }
+
 #undef GET_TENSOR_DATA_INFO
 #undef GET_TENSOR_DATA_SIZE
 };
 
+/**
+ * Interleaved 8-bit pixels <-> planar float tensors. Both directions walk the image
+ * row-major and treat each channel as its own pass over the row, so the planar side
+ * is always a unit-stride stream and the inner loops stay branch-free for the
+ * auto-vectorizer. Value mapping is fused: planar = pixel * scale + offset.
+ */
+class ImageHelper {
+public:
+    /**
+     * [H, W, src_channels] uint8 -> [out_channels, H, W] float
+     * extra source channels (e.g. alpha) are skipped by stride, never read
+     */
+    static void deinterleave(
+        const uint8_t *src_, long height_, long width_, long src_channels_,
+        float *dst_, long out_channels_, float scale_, float offset_
+    ) {
+        long plane_size_ = height_ * width_;
+        long row_size_ = width_ * src_channels_;
+        ParallelHelper::parallel_for(height_, [&](long begin_, long end_) {
+            for (long h = begin_; h < end_; ++h) {
+                const uint8_t *src_row_ = src_ + h * row_size_;
+                for (long c = 0; c < out_channels_; ++c) {
+                    float *dst_row_ = dst_ + c * plane_size_ + h * width_;
+                    const uint8_t *src_at_ = src_row_ + c;
+                    for (long w = 0; w < width_; ++w) {
+                        dst_row_[w] = float(src_at_[w * src_channels_]) * scale_ + offset_;
+                    }
+                }
+            }
+        }, std::max(1L, ParallelHelper::SD_PARALLEL_GRAIN / std::max(row_size_, 1L)));
+    }
+
+    /**
+     * [channels, H, W] float -> [H, W, channels] uint8
+     * pixel = round(clamp(planar * scale + offset, 0, 1) * 255)
+     */
+    static void interleave(
+        const float *src_, long height_, long width_, long channels_,
+        uint8_t *dst_, float scale_, float offset_
+    ) {
+        long plane_size_ = height_ * width_;
+        long row_size_ = width_ * channels_;
+        ParallelHelper::parallel_for(height_, [&](long begin_, long end_) {
+            for (long h = begin_; h < end_; ++h) {
+                uint8_t *dst_row_ = dst_ + h * row_size_;
+                for (long c = 0; c < channels_; ++c) {
+                    const float *src_row_ = src_ + c * plane_size_ + h * width_;
+                    uint8_t *dst_at_ = dst_row_ + c;
+                    for (long w = 0; w < width_; ++w) {
+                        float value_ = src_row_[w] * scale_ + offset_;
+                        value_ = std::min(std::max(value_, 0.0f), 1.0f);
+                        dst_at_[w * channels_] = uint8_t(value_ * 255.0f + 0.5f);   // >= 0, so +0.5 truncation rounds
+                    }
+                }
+            }
+        }, std::max(1L, ParallelHelper::SD_PARALLEL_GRAIN / std::max(row_size_, 1L)));
+    }
+};
+
 class PromptsHelper {
 public:
-    static std::string whitespace(std::string &text) {
-        return std::regex_replace(text, std::regex("\\s+"), " ");
+    // collapses every whitespace run (\s+) into one space
+    static std::string whitespace(const std::string &text) {
+        std::string result;
+        result.reserve(text.size());
+        bool in_space = false;
+        for (char c : text) {
+            bool is_space = (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v');
+            if (!is_space) {
+                result += c;
+            } else if (!in_space) {
+                result += ' ';
+            }
+            in_space = is_space;
+        }
+        return result;
     }
 
     static std::vector<std::string> split(const std::string &str, const std::regex &regex, bool match_break = true){
@@ -745,6 +1329,201 @@ public:
     }
 };
 
+/**
+ * Flat binary archive for trajectory snapshots: trivially copyable values, arrays and
+ * float tensors in host byte order, read back in the order they were written. Snapshots
+ * are meant to be resumed on the same build, so there is no endian / ABI translation.
+ */
+class StateWriter {
+private:
+    std::vector<uint8_t> state_bytes;
+
+    void append(const void *data_, size_t size_) {
+        auto bytes_ = static_cast<const uint8_t *>(data_);
+        state_bytes.insert(state_bytes.end(), bytes_, bytes_ + size_);
+    }
+
+public:
+    template<typename T>
+    void put(const T &value_) {
+        static_assert(std::is_trivially_copyable<T>::value, "state values must be trivially copyable");
+        append(&value_, sizeof(T));
+    }
+
+    template<typename T>
+    void put(const std::vector<T> &values_) {
+        static_assert(std::is_trivially_copyable<T>::value, "state values must be trivially copyable");
+        put<uint64_t>(values_.size());
+        append(values_.data(), values_.size() * sizeof(T));
+    }
+
+    void put(const float *values_, long size_) {
+        put<uint64_t>(uint64_t(size_));
+        append(values_, size_t(size_) * sizeof(float));
+    }
+
+    // float tensor as rank + shape + data, an empty tensor keeps its rank 0 marker
+    void put(const Tensor &tensor_) {
+        if (!TensorHelper::have_data(tensor_)) {
+            put<uint64_t>(0);
+            return;
+        }
+        TensorShape shape_ = tensor_.GetTensorTypeAndShapeInfo().GetShape();
+        put<uint64_t>(shape_.size());
+        for (int64_t dim_ : shape_) put<int64_t>(dim_);
+        put(tensor_.GetTensorData<float>(), TensorHelper::get_data_size(tensor_));
+    }
+
+    const std::vector<uint8_t> &bytes() const { return state_bytes; }
+
+    bool save(const std::string &file_path_) const {
+        std::ofstream file_(file_path_, std::ios::binary);
+        if (!file_) return false;
+        file_.write(reinterpret_cast<const char *>(state_bytes.data()), std::streamsize(state_bytes.size()));
+        return bool(file_);
+    }
+};
+
+class StateReader {
+private:
+    std::vector<uint8_t> state_bytes;
+    size_t state_at = 0;
+
+    void extract(void *data_, size_t size_) {
+        if (size_ > state_bytes.size() - state_at) {
+            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: state archive truncated"));
+        }
+        std::memcpy(data_, state_bytes.data() + state_at, size_);
+        state_at += size_;
+    }
+
+public:
+    explicit StateReader(std::vector<uint8_t> bytes_ = {}) : state_bytes(std::move(bytes_)) {}
+
+    template<typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable<T>::value, "state values must be trivially copyable");
+        T value_;
+        extract(&value_, sizeof(T));
+        return value_;
+    }
+
+    template<typename T>
+    void get(std::vector<T> &values_) {
+        auto size_ = get<uint64_t>();
+        if (size_ > (state_bytes.size() - state_at) / sizeof(T)) {
+            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: state archive truncated"));
+        }
+        values_.resize(size_);
+        extract(values_.data(), size_ * sizeof(T));
+    }
+
+    Tensor get_tensor() {
+        auto rank_ = get<uint64_t>();
+        if (rank_ == 0) return TensorHelper::empty<float>();
+        TensorShape shape_(rank_);
+        for (auto &dim_ : shape_) dim_ = get<int64_t>();
+        std::vector<float> values_;
+        get(values_);
+        int64_t expected_size_ = 1;
+        for (int64_t dim_ : shape_) expected_size_ *= dim_;
+        if (int64_t(values_.size()) != expected_size_) {
+            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: state archive tensor shape mismatch"));
+        }
+        return TensorHelper::create(shape_, values_);
+    }
+
+    bool finished() const { return state_at == state_bytes.size(); }
+
+    static StateReader load(const std::string &file_path_) {
+        std::ifstream file_(file_path_, std::ios::binary);
+        if (!file_) {
+            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: state archive not readable"));
+        }
+        std::vector<uint8_t> bytes_((std::istreambuf_iterator<char>(file_)), std::istreambuf_iterator<char>());
+        return StateReader(std::move(bytes_));
+    }
+};
+
+/**
+ * Read-only memory map of a whole file. Pages come from the OS page cache, so every
+ * process mapping the same file shares them; share() also hands one mapping to every
+ * caller in this process while any of them still holds it.
+ */
+class MappedFile {
+private:
+    const uint8_t *mapped_data = nullptr;
+    size_t mapped_size = 0;
+#ifdef _WIN32
+    HANDLE file_handle = INVALID_HANDLE_VALUE;
+    HANDLE mapping_handle = nullptr;
+#endif
+
+public:
+    explicit MappedFile(const std::string &file_path_) {
+#ifdef _WIN32
+        file_handle = CreateFileA(
+            file_path_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+        );
+        if (file_handle == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER file_size_;
+        if (!GetFileSizeEx(file_handle, &file_size_) || file_size_.QuadPart == 0) return;
+        mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_handle) return;
+        auto view_ = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+        if (!view_) return;
+        mapped_data = static_cast<const uint8_t *>(view_);
+        mapped_size = size_t(file_size_.QuadPart);
+#else
+        int file_fd_ = ::open(file_path_.c_str(), O_RDONLY);
+        if (file_fd_ < 0) return;
+        struct stat file_stat_{};
+        if (::fstat(file_fd_, &file_stat_) == 0 && file_stat_.st_size > 0) {
+            void *view_ = ::mmap(nullptr, size_t(file_stat_.st_size), PROT_READ, MAP_SHARED, file_fd_, 0);
+            if (view_ != MAP_FAILED) {
+                mapped_data = static_cast<const uint8_t *>(view_);
+                mapped_size = size_t(file_stat_.st_size);
+            }
+        }
+        ::close(file_fd_);      // the mapping keeps the file referenced
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (mapped_data) UnmapViewOfFile(mapped_data);
+        if (mapping_handle) CloseHandle(mapping_handle);
+        if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+#else
+        if (mapped_data) ::munmap(const_cast<uint8_t *>(mapped_data), mapped_size);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const { return mapped_data; }
+    size_t size() const { return mapped_size; }
+    bool valid() const { return mapped_data != nullptr; }
+
+    // nullptr when the file cannot be mapped
+    static std::shared_ptr<const MappedFile> share(const std::string &file_path_) {
+        static std::mutex shared_lock_;
+        static std::unordered_map<std::string, std::weak_ptr<const MappedFile>> shared_files_;
+
+        std::lock_guard<std::mutex> lock_(shared_lock_);
+        auto &slot_ = shared_files_[file_path_];
+        std::shared_ptr<const MappedFile> mapped_ = slot_.lock();
+        if (!mapped_) {
+            auto opened_ = std::make_shared<const MappedFile>(file_path_);
+            if (!opened_->valid()) return nullptr;
+            mapped_ = opened_;
+            slot_ = mapped_;
+        }
+        return mapped_;
+    }
+};
+
 class CommonHelper {
 public:
     static void print_progress_bar(float progress_) {
@@ -91,7 +91,7 @@ public:
     explicit ONNXRuntimeExecutor(const ORTBasicsConfig &ort_config_ = DEFAULT_EXECUTOR_CONFIG);
     virtual ~ONNXRuntimeExecutor();
 
-    Ort::Session* request_model(const std::string& model_path_);
+    Ort::Session* request_model(const std::string& model_path_, PrecisionType precision_ = PRECISION_AUTO);
     Ort::Session* release_model(Ort::Session* model_ptr_);
 };
 
@@ -110,12 +110,24 @@ ONNXRuntimeExecutor::~ONNXRuntimeExecutor() {
     ort_commons_config = {};
 }
 
-Ort::Session* ONNXRuntimeExecutor::request_model(const std::string& model_path_){
+Ort::Session* ONNXRuntimeExecutor::request_model(const std::string& model_path_, PrecisionType precision_){
+    // quantized units get their own options, so an INT8 UNet can sit next to a float VAE
+    OrtOptionConfig quant_session_config{nullptr};
+    if (precision_ == PRECISION_INT8) {
+        quant_session_config = ort_session_config.Clone();
+        // QDQ node-unit fusion into QLinear/MatMulInteger kernels happens at the extended level
+        if (ort_commons_config.onnx_graph_optimize < GraphOptimizationLevel::ORT_ENABLE_EXTENDED) {
+            quant_session_config.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+        }
+        quant_session_config.AddConfigEntry("session.qdqisint8allowed", "1");
+        quant_session_config.AddConfigEntry("session.enable_quant_qdq_cleanup", "1");
+    }
+    OrtOptionConfig &session_config_ = (precision_ == PRECISION_INT8) ? quant_session_config : ort_session_config;
 #ifdef _WIN32
     std::wstring w_model_path = std::wstring(model_path_.begin(), model_path_.end());
-    return new Ort::Session(ort_env, w_model_path.c_str(), ort_session_config);
+    return new Ort::Session(ort_env, w_model_path.c_str(), session_config_);
 #else
-    return new Ort::Session(ort_env, model_path_.c_str(), ort_session_config);
+    return new Ort::Session(ort_env, model_path_.c_str(), session_config_);
 #endif
 }
 
@@ -14,44 +14,224 @@ namespace scheduler {
 using namespace base;
 using namespace amon;
 
+// training-time noise levels, shared by every scheduler with the same beta config
+typedef struct TrainingTable {
+    std::vector<float> alphas_cumprod;          // ᾱ(t) at integer t
+    std::vector<double> log_sigmas;             // ln σ(t) at integer t, increasing in t
+} TrainingTable;
+
+// inference-time schedule, one entry per UNet evaluation; immutable once published
+typedef struct ScheduleTable {
+    std::vector<int64_t> timesteps;
+    std::vector<float> sigmas;                  // one longer than timesteps (trailing boundary σ, 0 for most)
+    float max_sigma = 0;
+    std::vector<float> coefficients;            // per-evaluation method weights, row-major (owned by the scheduler)
+    uint64_t coefficients_stride = 0;
+} ScheduleTable;
+
+/**
+ * Process-wide cache of training/schedule tables. Keys cover every config field
+ * that shapes a table (the seed does not), so after the first
+ * request a scheduler's create()/init() is a map lookup plus a shared_ptr copy.
+ */
+class ScheduleCache {
+private:
+    typedef std::tuple<uint64_t, float, float, int, int> TrainingKey;
+    typedef std::tuple<int, uint64_t, float, float, int, int, int, int, uint64_t, uint64_t, uint64_t> ScheduleKey;
+
+    static std::mutex &cache_lock() {
+        static std::mutex cache_lock_;
+        return cache_lock_;
+    }
+
+public:
+    typedef std::function<void(TrainingTable &)> TrainingBuilder;
+    typedef std::function<void(ScheduleTable &)> ScheduleBuilder;
+
+    static std::shared_ptr<const TrainingTable> request_training(
+        const SchedulerConfig &config_, const TrainingBuilder &builder_
+    ) {
+        static std::map<TrainingKey, std::shared_ptr<const TrainingTable>> training_tables_;
+        TrainingKey key_{
+            config_.scheduler_training_steps, config_.scheduler_beta_start, config_.scheduler_beta_end,
+            int(config_.scheduler_beta_type), int(config_.scheduler_alpha_type)
+        };
+        std::lock_guard<std::mutex> lock_(cache_lock());
+        auto found_ = training_tables_.find(key_);
+        if (found_ != training_tables_.end()) return found_->second;
+        auto table_ = std::make_shared<TrainingTable>();
+        builder_(*table_);
+        return training_tables_[key_] = table_;
+    }
+
+    static std::shared_ptr<const ScheduleTable> request_schedule(
+        const SchedulerConfig &config_, uint64_t inference_steps_, uint64_t skip_steps_, const ScheduleBuilder &builder_
+    ) {
+        static std::map<ScheduleKey, std::shared_ptr<const ScheduleTable>> schedule_tables_;
+        ScheduleKey key_{
+            int(config_.scheduler_type), config_.scheduler_training_steps,
+            config_.scheduler_beta_start, config_.scheduler_beta_end,
+            int(config_.scheduler_beta_type), int(config_.scheduler_alpha_type),
+            int(config_.scheduler_predict_type), int(config_.scheduler_sigma_type),
+            config_.scheduler_maintain_cache, inference_steps_, skip_steps_
+        };
+        std::lock_guard<std::mutex> lock_(cache_lock());
+        auto found_ = schedule_tables_.find(key_);
+        if (found_ != schedule_tables_.end()) return found_->second;
+        auto table_ = std::make_shared<ScheduleTable>();
+        builder_(*table_);
+        return schedule_tables_[key_] = table_;
+    }
+};
+
+/**
+ * Fixed-capacity history of latent-sized records for the multistep schedulers.
+ * Records live in one flat block, (re)allocated only when the record size or
+ * capacity changes; push() recycles the oldest slot once full, so a step never
+ * allocates, copies or shifts history.
+ */
+class HistoryRing {
+private:
+    std::vector<float> ring_data;
+    long ring_capacity = 1;
+    long ring_record_size = 0;
+    long ring_head = -1;                        // slot of the newest record
+    long ring_count = 0;
+
+    long slot_of(long age_) const { return (ring_head - age_ + ring_capacity) % ring_capacity; }
+
+public:
+    // drop all records, keep storage unless the capacity changes
+    void reset(long capacity_) {
+        capacity_ = std::max(capacity_, 1L);
+        if (capacity_ != ring_capacity) {
+            ring_capacity = capacity_;
+            ring_record_size = 0;
+        }
+        ring_head = -1;
+        ring_count = 0;
+    }
+
+    // slot for a new newest record, the caller fills record_size_ values
+    float* push(long record_size_) {
+        if (record_size_ != ring_record_size) {
+            ring_data.assign(size_t(ring_capacity * record_size_), 0.0f);
+            ring_record_size = record_size_;
+            ring_head = -1;
+            ring_count = 0;
+        }
+        ring_head = (ring_head + 1) % ring_capacity;
+        ring_count = std::min(ring_count + 1, ring_capacity);
+        return ring_data.data() + ring_head * ring_record_size;
+    }
+
+    // age_ 0 = newest record
+    const float* at(long age_) const { return ring_data.data() + slot_of(age_) * ring_record_size; }
+    long size() const { return ring_count; }
+    bool empty() const { return ring_count == 0; }
+
+    void save(StateWriter &writer_) const {
+        writer_.put<int64_t>(ring_capacity);
+        writer_.put<int64_t>(ring_record_size);
+        writer_.put<int64_t>(ring_head);
+        writer_.put<int64_t>(ring_count);
+        writer_.put(ring_data);
+    }
+
+    void load(StateReader &reader_) {
+        ring_capacity = long(reader_.get<int64_t>());
+        ring_record_size = long(reader_.get<int64_t>());
+        ring_head = long(reader_.get<int64_t>());
+        ring_count = long(reader_.get<int64_t>());
+        reader_.get(ring_data);
+        if (ring_capacity < 1 || ring_count > ring_capacity || ring_head >= ring_capacity ||
+            ring_data.size() != size_t(ring_capacity * ring_record_size)) {
+            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: scheduler history snapshot inconsistent"));
+        }
+    }
+};
+
 class SchedulerBase {
 private:
     RandomGenerator random_generator;
+    std::vector<float> scheduler_noise;         // step scratch, sized once per latent shape
+    std::vector<float> scheduler_predict;
 
 protected:
     typedef std::tuple<float, float, float> Predictants;
 
 protected:
     SchedulerConfig scheduler_config = DEFAULT_SCHEDULER_CONFIG;
-    std::map<long, int64_t> scheduler_timesteps;
-    vector<float> scheduler_sigmas;
-    vector<float> alphas_cumprod;
+    std::shared_ptr<const TrainingTable> scheduler_training;
+    std::shared_ptr<const ScheduleTable> scheduler_schedule;
+    const int64_t* scheduler_timesteps = nullptr;   // flat views into scheduler_schedule
+    const float* scheduler_sigmas = nullptr;
+    long scheduler_steps = 0;                       // UNet evaluations in the current schedule
+    uint64_t scheduler_inference_steps = 0;         // base step count the schedule was built for
+    uint64_t scheduler_skip_steps = 0;              // leading base steps cut by img2img strength
     float scheduler_max_sigma;
 
 protected:
     Predictants find_predict_params_at(float sigma_) ;
-    long find_closest_timestep_index(long time_);
-    int64_t find_timestep_at_sigma(float sigma_);
-    float generate_sigma_at(float timestep_);
+    int64_t find_timestep_at_sigma(float sigma_) const;
+    float generate_sigma_at(float timestep_) const;
+    const float* noise(long data_size_, long step_index_, float factor_ = 1.0f);
+
+private:
+    void build_training(TrainingTable &training_) const;
+    void build_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const;
+    static void truncate_schedule(ScheduleTable &schedule_, uint64_t skip_steps_);
+    void bind_schedule(uint64_t inference_steps_, uint64_t skip_steps_);
 
 protected:
-    virtual uint64_t correction_steps(uint64_t inference_steps_) { return inference_steps_; };
-    virtual std::vector<float> execute_method(
-        const float *predict_data_, const float* samples_data_,
+    // rewrite the base schedule (already truncated by strength) into the evaluation sequence
+    // a method needs; runs once per cached config
+    virtual void correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const {};
+    // per-run state reset, returns the UNet evaluation count
+    virtual uint64_t correction_steps(uint64_t inference_steps_) { return uint64_t(scheduler_steps); };
+    // samples_data_ holds x_t on entry and receives x_{t-1}
+    virtual void execute_method(
+        const float *predict_data_, float* samples_data_,
         long data_size_, long step_index_, float random_intensity_) = 0;
+    // per-run method state (history, pending half steps) for trajectory snapshots,
+    // load_history runs after correction_steps has reset it
+    virtual void save_history(StateWriter &writer_) const {};
+    virtual void load_history(StateReader &reader_) {};
 
 public:
     explicit SchedulerBase(const SchedulerConfig &scheduler_config_ = DEFAULT_SCHEDULER_CONFIG);
     virtual ~SchedulerBase();
 
     void create();
-    uint64_t init(uint64_t inference_steps_) ;
+    // request_ selects the noise stream of the trajectory: same (seed, request_) replays it
+    uint64_t init(uint64_t inference_steps_, float strength_ = 1.0f, uint64_t request_ = 0) ;
     Tensor mask(const TensorShape& mask_shape_);
     Tensor scale(const Tensor& masker_, int step_index_);
     Tensor time(int step_index_);
-    Tensor step(const Tensor& sample_, const Tensor& dnoise_, int step_index_, float random_intensity_ = 1.0f);
+    void step(Tensor& sample_, const Tensor& dnoise_, int step_index_, float random_intensity_ = 1.0f);
     void uninit();
     void release();
+    void reset(int64_t seed_);
+    void reseed(int64_t seed_);
+    int64_t seed() const { return random_generator.seed(); }
+    uint64_t request() const { return random_generator.request(); }
+    uint64_t inference_steps() const { return scheduler_inference_steps; }
+    const SchedulerConfig &config() const { return scheduler_config; }
+
+    // trajectory snapshots: schedule, noise stream and method history of the current run
+    void save_state(StateWriter &writer_) const;
+    uint64_t load_state(StateReader &reader_);
+    // new run of inference_steps_ entered at the base step nearest to sigma_ (fresh history),
+    // drawing its noise from stream request_
+    uint64_t rebase(uint64_t inference_steps_, float sigma_, uint64_t request_);
+    float sigma(int step_index_) const { return (step_index_ < scheduler_steps) ? scheduler_sigmas[step_index_] : 0.0f; }
+
+    // evaluation step_index_ is past the trajectory (adaptive methods decide while stepping)
+    bool finished(int step_index_) const { return step_index_ >= scheduler_steps; }
+    // fraction of the trajectory done before evaluation step_index_, in [0, 1]
+    virtual float progress(int step_index_) const {
+        return (step_index_ >= scheduler_steps) ? 1.0f : float(step_index_) / float(scheduler_steps);
+    }
 };
 
 SchedulerBase::SchedulerBase(const SchedulerConfig& scheduler_config_){
@@ -62,26 +242,12 @@ SchedulerBase::SchedulerBase(const SchedulerConfig& scheduler_config_){
 
 SchedulerBase::~SchedulerBase(){
     scheduler_max_sigma = 0;
-    alphas_cumprod.clear();
-    scheduler_sigmas.clear();
-    scheduler_timesteps.clear();
-    random_generator.~RandomGenerator();
-}
-
-long SchedulerBase::find_closest_timestep_index(long time_) {
-    auto it = scheduler_timesteps.lower_bound(time_);
-    if (it == scheduler_timesteps.end()) {
-        throw std::runtime_error("closest index found failed");
-    }
-    if ((it != scheduler_timesteps.begin()) &&
-        (it == scheduler_timesteps.end() ||
-         std::abs(it->second - time_) >= std::abs(std::prev(it)->second - time_))) {
-        --it;
-    }
-    return it->first;
+    uninit();
+    release();
 }
 
-float SchedulerBase::generate_sigma_at(float timestep_) {
+float SchedulerBase::generate_sigma_at(float timestep_) const {
+    const std::vector<float> &alphas_cumprod = scheduler_training->alphas_cumprod;
     int low_idx   = static_cast<int>(std::floor(timestep_));
     int high_idx  = static_cast<int>(std::ceil(timestep_));
     float l_sigma = alphas_cumprod[low_idx];
@@ -93,19 +259,18 @@ float SchedulerBase::generate_sigma_at(float timestep_) {
     return sigma;
 }
 
-// invert σ(t) by bisection: σ(t) is monotonically increasing over [0, training_steps-1]
-int64_t SchedulerBase::find_timestep_at_sigma(float sigma_) {
-    double lo = 0.0;
-    double hi = double(scheduler_config.scheduler_training_steps - 1);
-    for (int it_ = 0; it_ < 60; ++it_) {
-        double mid = 0.5 * (lo + hi);
-        if (double(generate_sigma_at(float(mid))) < double(sigma_)) {
-            lo = mid;
-        } else {
-            hi = mid;
-        }
-    }
-    return int64_t(std::llround(0.5 * (lo + hi)));
+// invert σ(t): ln σ(t) is increasing over [0, training_steps-1], bracket by binary
+// search on the log-sigma table and interpolate linearly in log space (diffusers _sigma_to_t)
+int64_t SchedulerBase::find_timestep_at_sigma(float sigma_) const {
+    const std::vector<double> &log_sigmas_ = scheduler_training->log_sigmas;
+    double log_sigma_ = std::log(std::max(double(sigma_), 1e-10));
+    auto high_it_ = std::upper_bound(log_sigmas_.begin(), log_sigmas_.end(), log_sigma_);
+    if (high_it_ == log_sigmas_.begin()) return 0;
+    if (high_it_ == log_sigmas_.end()) return int64_t(log_sigmas_.size() - 1);
+    long high_ = long(high_it_ - log_sigmas_.begin());
+    long low_ = high_ - 1;
+    double w_ = (log_sigma_ - log_sigmas_[low_]) / (log_sigmas_[high_] - log_sigmas_[low_]);
+    return int64_t(std::llround(double(low_) + w_));
 }
 
 SchedulerBase::Predictants SchedulerBase::find_predict_params_at(float sigma_)
@@ -141,6 +306,13 @@ SchedulerBase::Predictants SchedulerBase::find_predict_params_at(float sigma_)
 }
 
 void SchedulerBase::create() {
+    scheduler_training = ScheduleCache::request_training(
+        scheduler_config, [this](TrainingTable &training_) { build_training(training_); }
+    );
+}
+
+void SchedulerBase::build_training(TrainingTable &training_) const {
+    std::vector<float> &alphas_cumprod = training_.alphas_cumprod;
     uint64_t training_steps_  = scheduler_config.scheduler_training_steps;
     float linear_start_  = scheduler_config.scheduler_beta_start;
     float linear_end_    = scheduler_config.scheduler_beta_end;
@@ -204,14 +376,28 @@ void SchedulerBase::create() {
             break;
         }
     }
-}
 
-uint64_t SchedulerBase::init(uint64_t inference_steps_) {
-    std::vector<float> result;
-    if (inference_steps_ == 0) {
-        amon_report(class_exception(EXC_LOG_ERR, "ERROR:: inference_steps_ setting with 0!"));
-        return 0;
+    training_.log_sigmas.reserve(alphas_cumprod.size());
+    for (float alpha_prod : alphas_cumprod) {
+        training_.log_sigmas.push_back(0.5 * std::log((1.0 - double(alpha_prod)) / double(alpha_prod)));
     }
+}
+
+// Align Your Steps (Sabour et al. 2024) 10-step noise levels, σ_max .. σ_min of the SD scaled_linear betas
+static const float SD_AYS_SD15_SIGMAS[] = {
+    14.6146412293f, 6.4745760956f, 3.8636745985f, 2.6946151520f, 1.8841921177f, 1.3943805092f,
+    0.9642583904f, 0.6523686016f, 0.3977456272f, 0.1515232662f, 0.0291671582f
+};
+static const float SD_AYS_SDXL_SIGMAS[] = {
+    14.6146412293f, 6.3184485287f, 3.7681790315f, 2.1811480769f, 1.3405244945f, 0.8620721141f,
+    0.5550693289f, 0.3798540708f, 0.2332364134f, 0.1114188177f, 0.0291671582f
+};
+
+void SchedulerBase::build_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const {
+    std::vector<int64_t> &timesteps_ = schedule_.timesteps;
+    std::vector<float> &sigmas_ = schedule_.sigmas;
+    timesteps_.reserve(inference_steps_);
+    sigmas_.reserve(inference_steps_ + 1);
 
     // linearspace
     int start_at = 0;
@@ -229,9 +415,27 @@ uint64_t SchedulerBase::init(uint64_t inference_steps_) {
             for (uint32_t i = 0; i < inference_steps_; ++i) {
                 float w = (inference_steps_ > 1) ? float(i) / float(inference_steps_ - 1) : 0.0f;
                 float sigma = std::pow(ramp_low_ + w * (ramp_high_ - ramp_low_), karras_rho_);
-                scheduler_timesteps.insert(make_pair(long(i), find_timestep_at_sigma(sigma)));
-                scheduler_sigmas.push_back(sigma);
-                scheduler_max_sigma = max(scheduler_max_sigma, sigma);
+                timesteps_.push_back(find_timestep_at_sigma(sigma));
+                sigmas_.push_back(sigma);
+                schedule_.max_sigma = max(schedule_.max_sigma, sigma);
+            }
+            break;
+        }
+        case SIGMA_TYPE_AYS_SD15:
+        case SIGMA_TYPE_AYS_SDXL: {
+            // n steps take n + 1 levels interpolated linearly in log σ over the 11-level table
+            // (as the reference AYS sampler), the last level is replaced by σ = 0
+            const float *levels_ = (scheduler_config.scheduler_sigma_type == SIGMA_TYPE_AYS_SDXL) ?
+                                   SD_AYS_SDXL_SIGMAS : SD_AYS_SD15_SIGMAS;
+            const int last_level_ = 10;
+            for (uint32_t i = 0; i < inference_steps_; ++i) {
+                float at_ = float(i) * float(last_level_) / float(inference_steps_);
+                int low_ = std::min(int(at_), last_level_ - 1);
+                float w = at_ - float(low_);
+                float sigma = std::exp((1.0f - w) * std::log(levels_[low_]) + w * std::log(levels_[low_ + 1]));
+                timesteps_.push_back(find_timestep_at_sigma(sigma));
+                sigmas_.push_back(sigma);
+                schedule_.max_sigma = max(schedule_.max_sigma, sigma);
             }
             break;
         }
@@ -244,24 +448,131 @@ uint64_t SchedulerBase::init(uint64_t inference_steps_) {
             for (uint32_t i = 0; i < inference_steps_; ++i) {
                 float t = float(end_when) - step_gap * float(i);
                 float sigma = generate_sigma_at(t);
-                scheduler_timesteps.insert(make_pair(long(i), int64_t(t)));
-                scheduler_sigmas.push_back(sigma);
-                scheduler_max_sigma = max(scheduler_max_sigma, sigma);
+                timesteps_.push_back(int64_t(t));
+                sigmas_.push_back(sigma);
+                schedule_.max_sigma = max(schedule_.max_sigma, sigma);
             }
             break;
         }
     }
-    scheduler_sigmas.push_back(0);
+    sigmas_.push_back(0);
+}
+
+// img2img strength: drop the first skip_steps_ base steps, the trajectory then starts at σ[skip]
+void SchedulerBase::truncate_schedule(ScheduleTable &schedule_, uint64_t skip_steps_) {
+    if (skip_steps_ == 0) return;
+    schedule_.timesteps.erase(schedule_.timesteps.begin(), schedule_.timesteps.begin() + long(skip_steps_));
+    schedule_.sigmas.erase(schedule_.sigmas.begin(), schedule_.sigmas.begin() + long(skip_steps_));
+    schedule_.max_sigma = *std::max_element(schedule_.sigmas.begin(), schedule_.sigmas.end());
+}
+
+uint64_t SchedulerBase::init(uint64_t inference_steps_, float strength_, uint64_t request_) {
+    if (inference_steps_ == 0) {
+        amon_report(class_exception(EXC_LOG_ERR, "ERROR:: inference_steps_ setting with 0!"));
+        return 0;
+    }
+    if (!scheduler_training) create();
+
+    // same split as diffusers img2img: keep int(n * strength) steps (at least 1), out of (0, 1) runs the full schedule
+    uint64_t skip_steps_ = 0;
+    if (strength_ > 0.0f && strength_ < 1.0f) {
+        uint64_t kept_steps_ = std::max<uint64_t>(1, uint64_t(double(inference_steps_) * double(strength_)));
+        skip_steps_ = inference_steps_ - std::min(kept_steps_, inference_steps_);
+    }
+    bind_schedule(inference_steps_, skip_steps_);
+    random_generator.request(request_);
     return correction_steps(inference_steps_);
 }
 
+void SchedulerBase::bind_schedule(uint64_t inference_steps_, uint64_t skip_steps_) {
+    scheduler_inference_steps = inference_steps_;
+    scheduler_skip_steps = skip_steps_;
+    scheduler_schedule = ScheduleCache::request_schedule(
+        scheduler_config, inference_steps_, skip_steps_,
+        [this, inference_steps_, skip_steps_](ScheduleTable &schedule_) {
+            build_schedule(schedule_, inference_steps_);
+            truncate_schedule(schedule_, skip_steps_);
+            correction_schedule(schedule_, inference_steps_);
+        }
+    );
+    scheduler_timesteps = scheduler_schedule->timesteps.data();
+    scheduler_sigmas = scheduler_schedule->sigmas.data();
+    scheduler_steps = long(scheduler_schedule->timesteps.size());
+    scheduler_max_sigma = scheduler_schedule->max_sigma;
+}
+
+// layout: type, base steps, skipped steps, noise seed + request, then the method's own history
+void SchedulerBase::save_state(StateWriter &writer_) const {
+    writer_.put<int32_t>(int32_t(scheduler_config.scheduler_type));
+    writer_.put<uint64_t>(scheduler_inference_steps);
+    writer_.put<uint64_t>(scheduler_skip_steps);
+    writer_.put<int64_t>(random_generator.seed());
+    writer_.put<uint64_t>(random_generator.request());
+    save_history(writer_);
+}
+
+// continues the saved run: same schedule and noise stream, reseed() afterwards to vary the rest
+uint64_t SchedulerBase::load_state(StateReader &reader_) {
+    if (reader_.get<int32_t>() != int32_t(scheduler_config.scheduler_type)) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: snapshot was taken with another scheduler"));
+    }
+    uint64_t inference_steps_ = reader_.get<uint64_t>();
+    uint64_t skip_steps_ = reader_.get<uint64_t>();
+    int64_t seed_ = reader_.get<int64_t>();
+    uint64_t request_ = reader_.get<uint64_t>();
+    if (inference_steps_ == 0 || skip_steps_ >= inference_steps_) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: snapshot schedule inconsistent"));
+    }
+    if (!scheduler_training) create();
+
+    bind_schedule(inference_steps_, skip_steps_);
+    reseed(seed_);
+    random_generator.request(request_);
+    uint64_t working_steps_ = correction_steps(inference_steps_);
+    load_history(reader_);
+    return working_steps_;
+}
+
+uint64_t SchedulerBase::rebase(uint64_t inference_steps_, float sigma_, uint64_t request_) {
+    if (inference_steps_ == 0) {
+        amon_report(class_exception(EXC_LOG_ERR, "ERROR:: inference_steps_ setting with 0!"));
+        return 0;
+    }
+    if (!scheduler_training) create();
+
+    // entry point on the new base grid, nearest in log σ (method sequences start on base steps)
+    ScheduleTable base_;
+    build_schedule(base_, inference_steps_);
+    uint64_t skip_steps_ = 0;
+    if (sigma_ > 0) {
+        float nearest_ = std::numeric_limits<float>::max();
+        for (uint64_t k = 0; k < inference_steps_ && base_.sigmas[k] > 0; ++k) {
+            float distance_ = std::abs(std::log(base_.sigmas[k] / sigma_));
+            if (distance_ < nearest_) {
+                nearest_ = distance_;
+                skip_steps_ = k;
+            }
+        }
+    }
+
+    bind_schedule(inference_steps_, skip_steps_);
+    random_generator.request(request_);
+    return correction_steps(inference_steps_);
+}
+
+const float* SchedulerBase::noise(long data_size_, long step_index_, float factor_) {
+    scheduler_noise.resize(data_size_);
+    random_generator.normal(scheduler_noise.data(), data_size_, uint32_t(step_index_), factor_);
+    return scheduler_noise.data();
+}
+
 Tensor SchedulerBase::mask(const TensorShape& mask_shape_){
     return TensorHelper::random<float>(mask_shape_, random_generator, scheduler_max_sigma);
 }
 
 Tensor SchedulerBase::scale(const Tensor& latent_, int step_index_){
     // Get step index of timestep from TimeSteps
-    if (step_index_ >= scheduler_timesteps.size()) {
+    if (step_index_ < 0 || step_index_ >= scheduler_steps) {
         throw std::runtime_error("from time not found target TimeSteps.");
     }
     float sigma = scheduler_sigmas[step_index_];
@@ -271,7 +582,7 @@ Tensor SchedulerBase::scale(const Tensor& latent_, int step_index_){
 
 Tensor SchedulerBase::time(int step_index_){
     // Get step index of timestep from TimeSteps
-    if (step_index_ >= scheduler_timesteps.size()) {
+    if (step_index_ < 0 || step_index_ >= scheduler_steps) {
         throw std::runtime_error("from time not found target TimeSteps.");
     }
     vector<int64_t> timestep_value_{scheduler_timesteps[step_index_]};
@@ -279,46 +590,61 @@ Tensor SchedulerBase::time(int step_index_){
     return TensorHelper::create<int64_t>(timestep_shape_, timestep_value_);
 }
 
-Tensor SchedulerBase::step(
-    const Tensor& sample_,
+void SchedulerBase::step(
+    Tensor& sample_,
     const Tensor& dnoise_,
     int step_index_,
     float random_intensity_
 ) {
     // Check step index of timestep from TimeSteps
-    if (step_index_ >= scheduler_timesteps.size()) {
+    if (step_index_ < 0 || step_index_ >= scheduler_steps) {
         throw std::runtime_error("from time not found target TimeSteps.");
     }
 
-    TensorShape output_shape_ = sample_.GetTensorTypeAndShapeInfo().GetShape();
     long data_size_ = TensorHelper::get_data_size(sample_);
-    auto* sample_data_ = sample_.GetTensorData<float>();
+    auto* sample_data_ = sample_.GetTensorMutableData<float>();
     auto* dnoise_data_ = dnoise_.GetTensorData<float>();
-    std::vector<float> predict_data_(data_size_);
+    scheduler_predict.resize(data_size_);
+    float* predict_data_ = scheduler_predict.data();
 
     // do common prediction de-noise
     float sigma = scheduler_sigmas[step_index_];
     auto [c_skip, c_out, c_unused] = find_predict_params_at(sigma);
-    for (int i = 0; i < data_size_; i++) {
-        // predict_sample = sample * c_skip + c_out * dnoise
-        predict_data_[i] = sample_data_[i] * c_skip + dnoise_data_[i] * c_out;
-    }
-
-    std::vector<float> latent_value_ = execute_method(
-        predict_data_.data(), sample_data_, data_size_, step_index_, random_intensity_
-    );
-    Tensor result_latent = TensorHelper::create(output_shape_, latent_value_);
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            // predict_sample = sample * c_skip + c_out * dnoise
+            predict_data_[i] = sample_data_[i] * c_skip + dnoise_data_[i] * c_out;
+        }
+    });
 
-    return result_latent;
+    // latent is updated in place
+    execute_method(predict_data_, sample_data_, data_size_, step_index_, random_intensity_);
 }
 
 void SchedulerBase::uninit() {
-    scheduler_timesteps.clear();
-    scheduler_sigmas.clear();
+    scheduler_schedule.reset();
+    scheduler_timesteps = nullptr;
+    scheduler_sigmas = nullptr;
+    scheduler_steps = 0;
 }
 
 void SchedulerBase::release() {
-    alphas_cumprod.clear();
+    scheduler_training.reset();
+}
+
+// back to a freshly created state for reuse: the training table stays, the bound schedule is dropped
+// (uninit, the next init() rebinds it from ScheduleCache), trajectory state and noise stream restart
+void SchedulerBase::reset(int64_t seed_) {
+    uninit();
+    scheduler_config.scheduler_seed = seed_;
+    random_generator.seed(seed_);
+    random_generator.request(0);
+}
+
+// other noise for the rest of the current run, the request stream is kept
+void SchedulerBase::reseed(int64_t seed_) {
+    scheduler_config.scheduler_seed = seed_;
+    random_generator.seed(seed_);
 }
 
 } // namespace scheduler
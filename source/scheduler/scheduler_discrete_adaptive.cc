@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2018-2050 SD_Scheduler - Arikan.Li
+ * Created by Arikan.Li on 2026/10/19.
+ */
+#ifndef SCHEDULER_DISCRETE_ADAPTIVE
+#define SCHEDULER_DISCRETE_ADAPTIVE
+
+#include "scheduler_base.cc"
+
+namespace onnx {
+namespace sd {
+namespace scheduler {
+
+/**
+ * Adaptive Heun (2nd order) with an embedded Euler (1st order) error estimate on the
+ * EDM ODE. Step sizes are chosen in log-σ from the tolerance, so the evaluation count
+ * follows the prompt instead of sd_inference_steps:
+ *   - probe:   D(x, σ) -> d1, Euler proposal x_e at σ_next
+ *   - correct: D(x_e, σ_next) -> d2, Heun x_h; accept when |x_h - x_e| is within tolerance,
+ *              otherwise shrink the step and re-propose from the stored d1 (1 evaluation)
+ *   - final:   once σ reaches the schedule's last σ (or the update stalls), x = D(x, σ)
+ * sd_inference_steps only seeds the first step size and caps the evaluations at 2x.
+ */
+class AdaptiveDiscreteScheduler : public SchedulerBase {
+private:
+    typedef enum AdaptivePhase {
+        ADAPTIVE_PROBE          = 0,    // samples hold the accepted x
+        ADAPTIVE_CORRECT        = 1,    // samples hold the Euler proposal x_e
+    } AdaptivePhase;
+
+    static constexpr float SD_ADAPTIVE_RTOL         = 0.05f;    // relative tolerance when unset
+    static constexpr float SD_ADAPTIVE_ATOL         = 0.0078f;  // absolute tolerance, latent units
+    static constexpr float SD_ADAPTIVE_STOP_RATIO   = 0.02f;   // accepted update / |x| that ends the trajectory
+    static constexpr float SD_ADAPTIVE_SAFETY       = 0.9f;
+    static constexpr float SD_ADAPTIVE_SHRINK_MAX   = 0.2f;
+    static constexpr float SD_ADAPTIVE_GROW_MAX     = 5.0f;
+
+    std::vector<int64_t> trajectory_timesteps;      // evaluation sequence built while stepping
+    std::vector<float> trajectory_sigmas;
+    std::vector<float> origin_sample;               // accepted x
+    std::vector<float> origin_derivative;           // d1 at accepted x
+    std::vector<float> corrected_sample;            // Heun candidate x_h
+    AdaptivePhase trajectory_phase = ADAPTIVE_PROBE;
+    float origin_sigma = 0;
+    float sigma_start = 0;
+    float sigma_floor = 0;                          // last non-zero σ of the base schedule
+    float step_size = 0;                            // log-σ step
+    long evaluation_budget = 0;
+    bool trajectory_stalled = false;
+
+private:
+    void push_evaluation(float sigma_);
+    float error_norm(const float *proposal_, const float *corrected_, long data_size_) const;
+    static float update_ratio(const float *from_, const float *to_, long data_size_);
+
+protected:
+    uint64_t correction_steps(uint64_t inference_steps_) override;
+    void execute_method(
+        const float *predict_data_,
+        float *samples_data_,
+        long data_size_,
+        long step_index_,
+        float random_intensity_
+    ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
+
+public:
+    explicit AdaptiveDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_){
+    }
+
+    ~AdaptiveDiscreteScheduler() override = default;
+
+    float progress(int step_index_) const override;
+};
+
+// next evaluation at sigma_, the base views follow the growing sequence
+void AdaptiveDiscreteScheduler::push_evaluation(float sigma_) {
+    trajectory_sigmas.back() = sigma_;
+    trajectory_sigmas.push_back(0);
+    trajectory_timesteps.push_back(find_timestep_at_sigma(sigma_));
+    scheduler_sigmas = trajectory_sigmas.data();
+    scheduler_timesteps = trajectory_timesteps.data();
+    scheduler_steps = long(trajectory_timesteps.size());
+}
+
+// RMS of the Heun - Euler difference, scaled per element by atol + rtol * |x| at σ_next
+// (not at the origin: there |x| is mostly noise and would hide errors in the detail)
+float AdaptiveDiscreteScheduler::error_norm(const float *proposal_, const float *corrected_, long data_size_) const {
+    const float rtol_ = (scheduler_config.scheduler_tolerance > 0) ? scheduler_config.scheduler_tolerance : SD_ADAPTIVE_RTOL;
+    double error_sum_ = 0;
+    for (long i = 0; i < data_size_; i++) {
+        float scale_ = SD_ADAPTIVE_ATOL + rtol_ * std::max(std::abs(proposal_[i]), std::abs(corrected_[i]));
+        double error_ = double(corrected_[i] - proposal_[i]) / double(scale_);
+        error_sum_ += error_ * error_;
+    }
+    return float(std::sqrt(error_sum_ / double(std::max(data_size_, 1L))));
+}
+
+float AdaptiveDiscreteScheduler::update_ratio(const float *from_, const float *to_, long data_size_) {
+    double delta_sum_ = 0, value_sum_ = 0;
+    for (long i = 0; i < data_size_; i++) {
+        double delta_ = double(to_[i]) - double(from_[i]);
+        delta_sum_ += delta_ * delta_;
+        value_sum_ += double(to_[i]) * double(to_[i]);
+    }
+    return (value_sum_ > 0) ? float(std::sqrt(delta_sum_ / value_sum_)) : 0.0f;
+}
+
+uint64_t AdaptiveDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
+    // base schedule (already truncated by strength) gives the σ range and the first step size
+    long base_steps_ = scheduler_steps;
+    sigma_start = scheduler_sigmas[0];
+    sigma_floor = scheduler_sigmas[base_steps_ - 1];
+    step_size = (base_steps_ > 1) ? std::log(scheduler_sigmas[0] / scheduler_sigmas[1]) : 0.0f;
+    evaluation_budget = 2 * base_steps_;
+
+    trajectory_phase = ADAPTIVE_PROBE;
+    trajectory_stalled = false;
+    origin_sample.clear();
+    origin_derivative.clear();
+    trajectory_sigmas.clear();
+    trajectory_timesteps.clear();
+    trajectory_sigmas.reserve(evaluation_budget + 1);
+    trajectory_timesteps.reserve(evaluation_budget);
+    trajectory_sigmas.push_back(sigma_start);
+    trajectory_sigmas.push_back(0);
+    trajectory_timesteps.push_back(scheduler_timesteps[0]);
+    scheduler_sigmas = trajectory_sigmas.data();
+    scheduler_timesteps = trajectory_timesteps.data();
+    scheduler_steps = 1;
+    return uint64_t(evaluation_budget);
+}
+
+// fraction of the log-σ range covered, evaluations are not known in advance
+float AdaptiveDiscreteScheduler::progress(int step_index_) const {
+    if (step_index_ >= scheduler_steps || sigma_start <= sigma_floor) return (step_index_ >= scheduler_steps) ? 1.0f : 0.0f;
+    float covered_ = std::log(sigma_start / scheduler_sigmas[step_index_]) / std::log(sigma_start / sigma_floor);
+    return std::min(std::max(covered_, 0.0f), 1.0f);
+}
+
+void AdaptiveDiscreteScheduler::execute_method(
+    const float* predict_data_,
+    float* samples_data_,
+    long data_size_,
+    long step_index_,
+    float random_intensity_
+) {
+    SD_UNUSED(random_intensity_);
+
+    float sigma_curs = scheduler_sigmas[step_index_];
+    long remain_evaluations_ = evaluation_budget - (step_index_ + 1);
+
+    if (trajectory_phase == ADAPTIVE_PROBE) {
+        // reached the end of the range, stalled, or out of budget: final Euler step to σ = 0
+        if (trajectory_stalled || sigma_curs <= sigma_floor * 1.0001f || remain_evaluations_ < 2) {
+            ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+                for (long i = begin_; i < end_; i++) {
+                    samples_data_[i] = predict_data_[i];                                    // sample + derivative * (0 - sigma)
+                }
+            });
+            return;
+        }
+
+        origin_sample.assign(samples_data_, samples_data_ + data_size_);
+        origin_derivative.resize(data_size_);
+        origin_sigma = sigma_curs;
+        float sigma_next = std::max(origin_sigma * std::exp(-step_size), sigma_floor);
+        float sigma_dt = sigma_next - origin_sigma;
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                origin_derivative[i] = (samples_data_[i] - predict_data_[i]) / origin_sigma;   // d1 = (sample - predict_sample) / sigma
+                samples_data_[i] = origin_sample[i] + origin_derivative[i] * sigma_dt;          // Euler proposal x_e
+            }
+        });
+        trajectory_phase = ADAPTIVE_CORRECT;
+        push_evaluation(sigma_next);
+        return;
+    }
+
+    // correct: samples hold x_e at σ_next, Heun candidate from the averaged slopes
+    float sigma_dt = sigma_curs - origin_sigma;
+    std::vector<float> &corrected_ = corrected_sample;
+    corrected_.resize(data_size_);
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            float curs_derivative = (samples_data_[i] - predict_data_[i]) / sigma_curs;
+            corrected_[i] = origin_sample[i] + 0.5f * (origin_derivative[i] + curs_derivative) * sigma_dt;
+        }
+    });
+
+    float error_ = error_norm(samples_data_, corrected_.data(), data_size_);
+    float factor_ = (error_ > 0) ? SD_ADAPTIVE_SAFETY * std::pow(error_, -0.5f) : SD_ADAPTIVE_GROW_MAX;
+    bool accepted_ = (error_ <= 1.0f) || (remain_evaluations_ < 2);
+    if (accepted_) {
+        step_size *= std::min(std::max(factor_, SD_ADAPTIVE_SHRINK_MAX), SD_ADAPTIVE_GROW_MAX);
+        trajectory_stalled = (update_ratio(origin_sample.data(), corrected_.data(), data_size_) < SD_ADAPTIVE_STOP_RATIO);
+        std::copy(corrected_.begin(), corrected_.end(), samples_data_);
+        trajectory_phase = ADAPTIVE_PROBE;
+        push_evaluation(sigma_curs);
+        return;
+    }
+
+    // rejected: d1 at x is still valid, re-propose a shorter Euler step (one evaluation)
+    step_size *= std::max(factor_, SD_ADAPTIVE_SHRINK_MAX);
+    float sigma_next = std::max(origin_sigma * std::exp(-step_size), sigma_floor);
+    float sigma_retry_dt = sigma_next - origin_sigma;
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            samples_data_[i] = origin_sample[i] + origin_derivative[i] * sigma_retry_dt;
+        }
+    });
+    push_evaluation(sigma_next);
+}
+
+void AdaptiveDiscreteScheduler::save_history(StateWriter &writer_) const {
+    writer_.put(trajectory_timesteps);
+    writer_.put(trajectory_sigmas);
+    writer_.put(origin_sample);
+    writer_.put(origin_derivative);
+    writer_.put<int32_t>(int32_t(trajectory_phase));
+    writer_.put<float>(origin_sigma);
+    writer_.put<float>(step_size);
+    writer_.put<uint8_t>(trajectory_stalled ? 1 : 0);
+}
+
+// correction_steps already rebuilt the σ range and budget, the evaluation sequence is replayed
+void AdaptiveDiscreteScheduler::load_history(StateReader &reader_) {
+    reader_.get(trajectory_timesteps);
+    reader_.get(trajectory_sigmas);
+    reader_.get(origin_sample);
+    reader_.get(origin_derivative);
+    trajectory_phase = AdaptivePhase(reader_.get<int32_t>());
+    origin_sigma = reader_.get<float>();
+    step_size = reader_.get<float>();
+    trajectory_stalled = (reader_.get<uint8_t>() != 0);
+    if (trajectory_timesteps.empty() || trajectory_sigmas.size() != trajectory_timesteps.size() + 1) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: adaptive trajectory snapshot inconsistent"));
+    }
+    trajectory_sigmas.reserve(evaluation_budget + 1);
+    trajectory_timesteps.reserve(evaluation_budget);
+    scheduler_sigmas = trajectory_sigmas.data();
+    scheduler_timesteps = trajectory_timesteps.data();
+    scheduler_steps = long(trajectory_timesteps.size());
+}
+
+} // namespace scheduler
+} // namespace sd
+} // namespace onnx
+
+#endif //SCHEDULER_DISCRETE_ADAPTIVE
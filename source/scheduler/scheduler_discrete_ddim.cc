@@ -14,13 +14,10 @@ namespace sd {
 namespace scheduler {
 
 class DDIMDiscreteScheduler: public SchedulerBase {
-private:
-    RandomGenerator ddpm_random;
-
 protected:
-    std::vector<float> execute_method(
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
@@ -28,7 +25,6 @@ protected:
 
 public:
     explicit DDIMDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
-        ddpm_random.seed(0);
     }
 
     ~DDIMDiscreteScheduler() override = default;
@@ -65,15 +61,13 @@ public:
  *            \__________________/
  *            "random noise"
  */
-std::vector<float> DDIMDiscreteScheduler::execute_method(
+void DDIMDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
-    std::vector<float> scaled_sample_(data_size_);
-
     // DDIM:: sigma get
     float eta = random_intensity_;      // DDIM use η=0, and when η=1, DDIM degrade to DDPM
     float sigma_curs = scheduler_sigmas[step_index_];
@@ -95,15 +89,16 @@ std::vector<float> DDIMDiscreteScheduler::execute_method(
     }
 
     // DDIM:: current noise decrees
-    for (int i = 0; i < data_size_; i++) {
-        scaled_sample_[i] = samples_data_[i] * factor_a + predict_data_[i] * factor_b;
-        if (variance > 0) { // η=1, DDIM should degrade to DDPM
-            // so when η=1, factor_b = (sigma_next_pow - sigma_curs_pow) / (sigma_curs * std::sqrt(sigma_next_pow + 1));
-            scaled_sample_[i] = scaled_sample_[i] + ddpm_random.next() * variance;
+    const float* random_noise_ = (variance > 0) ? noise(data_size_, step_index_, variance) : nullptr;
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            samples_data_[i] = samples_data_[i] * factor_a + predict_data_[i] * factor_b;
+            if (random_noise_) { // η=1, DDIM should degrade to DDPM
+                // so when η=1, factor_b = (sigma_next_pow - sigma_curs_pow) / (sigma_curs * std::sqrt(sigma_next_pow + 1));
+                samples_data_[i] = samples_data_[i] + random_noise_[i];
+            }
         }
-    }
-
-    return scaled_sample_;
+    });
 }
 
 /*
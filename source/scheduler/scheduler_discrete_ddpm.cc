@@ -14,13 +14,10 @@ namespace sd {
 namespace scheduler {
 
 class DDPMDiscreteScheduler: public SchedulerBase {
-private:
-    RandomGenerator ddpm_random;
-
 protected:
-    std::vector<float> execute_method(
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
@@ -28,7 +25,6 @@ protected:
 
 public:
     explicit DDPMDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
-        ddpm_random.seed(0);
     }
 
     ~DDPMDiscreteScheduler() override = default;
@@ -42,17 +38,15 @@ public:
  *   for the true DDPM Markov property made it cast full inference steps
  *   to get result, as steps in inference needs to be equaled to training
  */
-std::vector<float> DDPMDiscreteScheduler::execute_method(
+void DDPMDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
     SD_UNUSED(random_intensity_);
 
-    std::vector<float> scaled_sample_(data_size_);
-
     // DDPM method:: sigma get
     float eta = random_intensity_;
     float sigma_curs = scheduler_sigmas[step_index_];
@@ -72,14 +66,15 @@ std::vector<float> DDPMDiscreteScheduler::execute_method(
     }
 
     // DDPM:: current noise decrees
-    for (int i = 0; i < data_size_; i++) {
-        scaled_sample_[i] = samples_data_[i] * factor_a + predict_data_[i] * factor_b;         // derivative_out = (sample - predict_sample) / sigma
-        if (variance > 0) {
-            scaled_sample_[i] = scaled_sample_[i] + ddpm_random.next() * variance;
+    const float* random_noise_ = (variance > 0) ? noise(data_size_, step_index_, variance) : nullptr;
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            samples_data_[i] = samples_data_[i] * factor_a + predict_data_[i] * factor_b;          // derivative_out = (sample - predict_sample) / sigma
+            if (random_noise_) {
+                samples_data_[i] = samples_data_[i] + random_noise_[i];
+            }
         }
-    }
-
-    return scaled_sample_;
+    });
 }
 
 } // namespace scheduler
@@ -33,11 +33,9 @@ namespace scheduler {
 
 class DeisMDiscreteScheduler: public SchedulerBase {
 private:
-    typedef std::vector<float> DeisData;
-
     static constexpr float SD_SIGMA_FLOOR = 1e-7f;
 
-    std::vector<DeisData> history_dnoise;        // eps history, newest first (cap 3)
+    HistoryRing history_dnoise;                  // eps history, newest first (cap 3: m0, m1, m2)
 
 private:
     static double floored_(double sigma_) { return std::max(sigma_, double(SD_SIGMA_FLOOR)); }
@@ -58,13 +56,15 @@ private:
 
 protected:
     uint64_t correction_steps(uint64_t inference_steps_) override;
-    std::vector<float> execute_method(
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
     ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
 
 public:
     explicit DeisMDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
@@ -77,13 +77,13 @@ public:
 
 // base schedule is used as-is; only reset the multistep history per run
 uint64_t DeisMDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
-    history_dnoise.clear();
-    return inference_steps_;
+    history_dnoise.reset(3);
+    return uint64_t(scheduler_steps);
 }
 
-std::vector<float> DeisMDiscreteScheduler::execute_method(
+void DeisMDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
@@ -94,56 +94,63 @@ std::vector<float> DeisMDiscreteScheduler::execute_method(
     float sigma_curs_ = scheduler_sigmas[size_t(step_index_)];
     float sigma_next_ = scheduler_sigmas[size_t(step_index_) + 1];
 
-    DeisData curs_eps_(data_size_, 0.0f);
-    for (long i = 0; i < data_size_; i++) {
-        curs_eps_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs_;
-    }
+    float* curs_eps_ = history_dnoise.push(data_size_);
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            curs_eps_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs_;
+        }
+    });
 
     // order ramp: 1 -> 2 -> 3; final step (σ_next = 0) forced order-1
     size_t order_ = std::min<size_t>(size_t(step_index_) + 1, 3);
     if (sigma_next_ <= SD_SIGMA_FLOOR) order_ = 1;
-    order_ = std::min(order_, history_dnoise.size() + 1);
+    order_ = std::min(order_, size_t(history_dnoise.size()));
 
     double s_t_  = double(sigma_next_);
     double s_s0_ = double(sigma_curs_);
 
-    std::vector<float> next_samples_(data_size_, 0.0f);
     if (order_ <= 1) {
         // x_t = x + (σ_t − σ_s0)·m0   (== DDIM; at σ_t = 0 lands on x0 exactly)
         double c1_ = s_t_ - s_s0_;
-        for (long i = 0; i < data_size_; i++) {
-            next_samples_[i] = float(double(samples_data_[i]) + c1_ * double(curs_eps_[i]));
-        }
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                samples_data_[i] = float(double(samples_data_[i]) + c1_ * double(curs_eps_[i]));
+            }
+        });
     } else if (order_ == 2) {
         double s_s1_ = double(scheduler_sigmas[size_t(step_index_ - 1)]);
         double c1_ = ind2_(s_t_, s_s0_, s_s1_) - ind2_(s_s0_, s_s0_, s_s1_);
         double c2_ = ind2_(s_t_, s_s1_, s_s0_) - ind2_(s_s0_, s_s1_, s_s0_);
-        const DeisData& m1_ = history_dnoise[0];
-        for (long i = 0; i < data_size_; i++) {
-            next_samples_[i] = float(double(samples_data_[i]) +
-                                     c1_ * double(curs_eps_[i]) + c2_ * double(m1_[i]));
-        }
+        const float* m1_ = history_dnoise.at(1);
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                samples_data_[i] = float(double(samples_data_[i]) +
+                                         c1_ * double(curs_eps_[i]) + c2_ * double(m1_[i]));
+            }
+        });
     } else {
         double s_s1_ = double(scheduler_sigmas[size_t(step_index_ - 1)]);
         double s_s2_ = double(scheduler_sigmas[size_t(step_index_ - 2)]);
         double c1_ = ind3_(s_t_, s_s0_, s_s1_, s_s2_) - ind3_(s_s0_, s_s0_, s_s1_, s_s2_);
         double c2_ = ind3_(s_t_, s_s1_, s_s2_, s_s0_) - ind3_(s_s0_, s_s1_, s_s2_, s_s0_);
         double c3_ = ind3_(s_t_, s_s2_, s_s0_, s_s1_) - ind3_(s_s0_, s_s2_, s_s0_, s_s1_);
-        const DeisData& m1_ = history_dnoise[0];
-        const DeisData& m2_ = history_dnoise[1];
-        for (long i = 0; i < data_size_; i++) {
-            next_samples_[i] = float(double(samples_data_[i]) +
-                                     c1_ * double(curs_eps_[i]) + c2_ * double(m1_[i]) + c3_ * double(m2_[i]));
-        }
+        const float* m1_ = history_dnoise.at(1);
+        const float* m2_ = history_dnoise.at(2);
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                samples_data_[i] = float(double(samples_data_[i]) +
+                                         c1_ * double(curs_eps_[i]) + c2_ * double(m1_[i]) + c3_ * double(m2_[i]));
+            }
+        });
     }
+}
 
-    // record current eps as history (newest first, cap 3)
-    history_dnoise.insert(history_dnoise.begin(), std::move(curs_eps_));
-    while (history_dnoise.size() > 3) {
-        history_dnoise.pop_back();
-    }
+void DeisMDiscreteScheduler::save_history(StateWriter &writer_) const {
+    history_dnoise.save(writer_);
+}
 
-    return next_samples_;
+void DeisMDiscreteScheduler::load_history(StateReader &reader_) {
+    history_dnoise.load(reader_);
 }
 
 } // namespace scheduler
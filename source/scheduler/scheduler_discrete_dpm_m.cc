@@ -24,11 +24,9 @@ namespace scheduler {
 
 class DpmMDiscreteScheduler: public SchedulerBase {
 private:
-    typedef std::vector<float> DpmData;
-
     static constexpr float SD_SIGMA_FLOOR = 1e-7f;
 
-    std::vector<DpmData> history_dnoise;       // model x0-predictions, newest first (cap 2)
+    HistoryRing history_dnoise;                // model x0-predictions, newest first (cap 2: m0, m1)
 
 private:
     static double lambda_at(float sigma_) {    // λ = -ln(σ_ratio), sigma floored
@@ -36,13 +34,16 @@ private:
     }
 
 protected:
-    std::vector<float> execute_method(
+    uint64_t correction_steps(uint64_t inference_steps_) override;
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
     ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
 
 public:
     explicit DpmMDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
@@ -53,41 +54,50 @@ public:
 
 /* Essential Operations ===================================================*/
 
-std::vector<float> DpmMDiscreteScheduler::execute_method(
+uint64_t DpmMDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
+    history_dnoise.reset(2);
+    return uint64_t(scheduler_steps);
+}
+
+void DpmMDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
     SD_UNUSED(random_intensity_);
 
-    // predict_data_ is already the x0-prediction (converted by base with c_skip/c_out)
-    DpmData curs_dnoised_(predict_data_, predict_data_ + data_size_);
-
     float sigma_curs = scheduler_sigmas[size_t(step_index_)];
     float sigma_next = scheduler_sigmas[size_t(step_index_ + 1)];   // appended 0 at final step
 
     // final step: order-1 degenerates to the x0-prediction (diffusers lower_order_final + zero sigma)
     if (sigma_next <= SD_SIGMA_FLOOR) {
-        return curs_dnoised_;
+        std::copy(predict_data_, predict_data_ + data_size_, samples_data_);
+        return;
     }
 
+    // predict_data_ is already the x0-prediction (converted by base with c_skip/c_out),
+    // record it as m0; the previous step's m0 becomes m1
+    float* curs_dnoised_ = history_dnoise.push(data_size_);
+    std::copy(predict_data_, predict_data_ + data_size_, curs_dnoised_);
+
     double lambda_s0 = lambda_at(sigma_curs);
     double h_        = lambda_at(sigma_next) - lambda_s0;            // > 0
     double e_neg_h_  = std::exp(-h_);
     double f_        = double(sigma_next) / double(sigma_curs);
 
     // order: 2M needs one history entry; warmup step falls back to order-1 (DDIM)
-    bool second_order_ = (step_index_ > 0) && !history_dnoise.empty() &&
+    bool second_order_ = (step_index_ > 0) && (history_dnoise.size() > 1) &&
                          (scheduler_config.scheduler_maintain_cache > 1);
 
-    std::vector<float> next_samples_(data_size_, 0.0f);
     if (!second_order_) {
         // x_t = (σ_t/σ_s) * x + (1-e^{-h}) * m0
-        for (long i = 0; i < data_size_; i++) {
-            next_samples_[i] = float(f_ * double(samples_data_[i]) + (1.0 - e_neg_h_) * double(curs_dnoised_[i]));
-        }
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                samples_data_[i] = float(f_ * double(samples_data_[i]) + (1.0 - e_neg_h_) * double(curs_dnoised_[i]));
+            }
+        });
     } else {
         // x_t = (σ_t/σ_s) * x + (1-e^{-h}) * m0 + 0.5 * (1-e^{-h}) * D1
         // D1 = (m0 - m1) / r0, r0 = h_0 / h, h_0 = λ_s0 - λ_s1
@@ -95,21 +105,24 @@ std::vector<float> DpmMDiscreteScheduler::execute_method(
         double h_0_      = lambda_s0 - lambda_s1;
         double r0_       = h_0_ / h_;
         double c_d1_     = 0.5 * (1.0 - e_neg_h_) / r0_;
-        for (long i = 0; i < data_size_; i++) {
-            double m0_ = double(curs_dnoised_[i]);
-            double d1_ = m0_ - double(history_dnoise[0][i]);
-            next_samples_[i] = float(f_ * double(samples_data_[i]) +
-                                     (1.0 - e_neg_h_) * m0_ + c_d1_ * d1_);
-        }
+        const float* prev_dnoised_ = history_dnoise.at(1);
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                double m0_ = double(curs_dnoised_[i]);
+                double d1_ = m0_ - double(prev_dnoised_[i]);
+                samples_data_[i] = float(f_ * double(samples_data_[i]) +
+                                         (1.0 - e_neg_h_) * m0_ + c_d1_ * d1_);
+            }
+        });
     }
+}
 
-    // record current model output as next step's m1 (2M only needs the latest one)
-    history_dnoise.insert(history_dnoise.begin(), std::move(curs_dnoised_));
-    while (history_dnoise.size() > 2) {
-        history_dnoise.pop_back();
-    }
+void DpmMDiscreteScheduler::save_history(StateWriter &writer_) const {
+    history_dnoise.save(writer_);
+}
 
-    return next_samples_;
+void DpmMDiscreteScheduler::load_history(StateReader &reader_) {
+    history_dnoise.load(reader_);
 }
 
 } // namespace scheduler
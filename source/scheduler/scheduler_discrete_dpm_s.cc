@@ -6,7 +6,7 @@
  * base on: https://huggingface.co/papers/2211.01095
  *          diffusers DPMSolverSinglestepScheduler (algorithm_type=dpmsolver++, solver_type=midpoint)
  *
- * Structure: two UNet evaluations per inference step (same correction_steps
+ * Structure: two UNet evaluations per inference step (same correction_schedule
  * trick as Heun / DPM-SDE here), with TRUE midpoint sigmas/timesteps at odd
  * indices keeping base scale/time/x0-conversion self-consistent:
  *   even indices = order-1 deterministic half-step to the midpoint sigma,
@@ -41,14 +41,16 @@ private:
     }
 
 protected:
-    uint64_t correction_steps(uint64_t inference_steps_) override;
-    std::vector<float> execute_method(
+    void correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const override;
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
     ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
 
 public:
     explicit DpmSDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
@@ -60,35 +62,34 @@ public:
 /* Essential Operations ===================================================*/
 
 // expand each real interval with its λ-midpoint: [σ0, σm01, σ1, σm12, ..., σn-1, 0]
-uint64_t DpmSDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
-    std::map<long, int64_t> expanded_timesteps_;
+void DpmSDiscreteScheduler::correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const {
+    std::vector<int64_t> expanded_timesteps_;
     vector<float> expanded_sigmas_;
 
-    uint64_t real_count_ = uint64_t(scheduler_sigmas.size()) - 1;   // exclude appended 0
+    uint64_t real_count_ = uint64_t(schedule_.sigmas.size()) - 1;   // exclude appended 0
     for (uint64_t i = 0; i < real_count_; ++i) {
-        double sigma_from_ = scheduler_sigmas[i];
-        double sigma_to_   = scheduler_sigmas[i + 1];               // may be 0 at final interval
+        double sigma_from_ = schedule_.sigmas[i];
+        double sigma_to_   = schedule_.sigmas[i + 1];               // may be 0 at final interval
 
-        expanded_timesteps_.insert(make_pair(long(2 * i), scheduler_timesteps[long(i)]));
+        expanded_timesteps_.push_back(schedule_.timesteps[i]);
         expanded_sigmas_.push_back(float(sigma_from_));
 
         if (sigma_to_ > double(SD_SIGMA_FLOOR)) {
             double lambda_mid_ = 0.5 * (lambda_at(sigma_from_) + lambda_at(sigma_to_));
             float  sigma_mid_  = float(std::exp(-lambda_mid_));
-            expanded_timesteps_.insert(make_pair(long(2 * i + 1), find_timestep_at_sigma(sigma_mid_)));
+            expanded_timesteps_.push_back(find_timestep_at_sigma(sigma_mid_));
             expanded_sigmas_.push_back(sigma_mid_);
         }
     }
     expanded_sigmas_.push_back(0);
 
-    scheduler_timesteps = expanded_timesteps_;
-    scheduler_sigmas    = expanded_sigmas_;
-    return inference_steps_ * 2 - 1;
+    schedule_.timesteps = expanded_timesteps_;
+    schedule_.sigmas    = expanded_sigmas_;
 }
 
-std::vector<float> DpmSDiscreteScheduler::execute_method(
+void DpmSDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
@@ -100,11 +101,11 @@ std::vector<float> DpmSDiscreteScheduler::execute_method(
 
     // final phase: order-1 degenerates to the x0-prediction itself
     if (sigma_next <= SD_SIGMA_FLOOR) {
-        return DpmData(predict_data_, predict_data_ + data_size_);
+        std::copy(predict_data_, predict_data_ + data_size_, samples_data_);
+        return;
     }
 
     bool first_order_ = (step_index_ % 2 == 0);
-    std::vector<float> next_samples_(data_size_, 0.0f);
 
     if (first_order_) {
         // phase 1: order-1 half-step σ_A -> σ_mid (deterministic);
@@ -112,12 +113,14 @@ std::vector<float> DpmSDiscreteScheduler::execute_method(
         double h_half_ = lambda_at(sigma_next) - lambda_at(sigma_curs);
         double e_neg_h_ = std::exp(-h_half_);
         double f_ = double(sigma_next) / double(sigma_curs);
-        for (long i = 0; i < data_size_; i++) {
-            next_samples_[i] = float(f_ * double(samples_data_[i]) +
-                                     (1.0 - e_neg_h_) * double(predict_data_[i]));
-        }
         original_sample.assign(samples_data_, samples_data_ + data_size_);
         first_dnoise.assign(predict_data_, predict_data_ + data_size_);
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                samples_data_[i] = float(f_ * double(samples_data_[i]) +
+                                         (1.0 - e_neg_h_) * double(predict_data_[i]));
+            }
+        });
     } else {
         // phase 2: full 2S step σ_A -> σ_B with midpoint x0 (m1, converted by base at σ_mid)
         // x_t = (σ_B/σ_A)·x_A + (1-e^{-h})·m1 + 0.5·(1-e^{-h})·(m0-m1)/r0
@@ -128,17 +131,25 @@ std::vector<float> DpmSDiscreteScheduler::execute_method(
         double e_neg_h_ = std::exp(-h_);
         double f_     = double(sigma_next) / sigma_from_;
         double c_d1_  = 0.5 * (1.0 - e_neg_h_) / r0_;
-        for (long i = 0; i < data_size_; i++) {
-            double m1_ = double(predict_data_[i]);
-            double d1_ = double(first_dnoise[i]) - m1_;
-            next_samples_[i] = float(f_ * double(original_sample[i]) +
-                                     (1.0 - e_neg_h_) * m1_ + c_d1_ * d1_);
-        }
-        original_sample.clear();
-        first_dnoise.clear();
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                double m1_ = double(predict_data_[i]);
+                double d1_ = double(first_dnoise[i]) - m1_;
+                samples_data_[i] = float(f_ * double(original_sample[i]) +
+                                         (1.0 - e_neg_h_) * m1_ + c_d1_ * d1_);
+            }
+        });
     }
+}
+
+void DpmSDiscreteScheduler::save_history(StateWriter &writer_) const {
+    writer_.put(original_sample);
+    writer_.put(first_dnoise);
+}
 
-    return next_samples_;
+void DpmSDiscreteScheduler::load_history(StateReader &reader_) {
+    reader_.get(original_sample);
+    reader_.get(first_dnoise);
 }
 
 } // namespace scheduler
@@ -13,9 +13,9 @@ namespace scheduler {
 
 class EulerDiscreteScheduler : public SchedulerBase {
 protected:
-    std::vector<float> execute_method(
+    void execute_method(
         const float *predict_data_,
-        const float *samples_data_,
+        float *samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
@@ -28,17 +28,15 @@ public:
     ~EulerDiscreteScheduler() override = default;
 };
 
-std::vector<float> EulerDiscreteScheduler::execute_method(
+void EulerDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
     SD_UNUSED(random_intensity_);
 
-    std::vector<float> scaled_sample_(data_size_);
-
     // Euler method:: sigma get
     float sigma_curs = scheduler_sigmas[step_index_];
     float sigma_next = scheduler_sigmas[step_index_ + 1];
@@ -48,12 +46,12 @@ std::vector<float> EulerDiscreteScheduler::execute_method(
     }
 
     // Euler method:: current noise decrees
-    for (int i = 0; i < data_size_; i++) {
-        scaled_sample_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs;         // derivative_out = (sample - predict_sample) / sigma
-        scaled_sample_[i] = (samples_data_[i] + scaled_sample_[i] * sigma_dt);          // previous_down = sample + derivative_out * dt
-    }
-
-    return scaled_sample_;
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            float derivative_ = (samples_data_[i] - predict_data_[i]) / sigma_curs;         // derivative_out = (sample - predict_sample) / sigma
+            samples_data_[i] = (samples_data_[i] + derivative_ * sigma_dt);                 // previous_down = sample + derivative_out * dt
+        }
+    });
 }
 
 } // namespace scheduler
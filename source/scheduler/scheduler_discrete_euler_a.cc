@@ -12,13 +12,10 @@ namespace sd {
 namespace scheduler {
 
 class EulerAncestralDiscreteScheduler : public SchedulerBase {
-private:
-    RandomGenerator euler_a_random;
-
 protected:
-    std::vector<float> execute_method(
+    void execute_method(
         const float *predict_data_,
-        const float *samples_data_,
+        float *samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
@@ -26,23 +23,20 @@ protected:
 
 public:
     explicit EulerAncestralDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_){
-        euler_a_random.seed(0);
     }
 
     ~EulerAncestralDiscreteScheduler() override = default;
 };
 
-std::vector<float> EulerAncestralDiscreteScheduler::execute_method(
+void EulerAncestralDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
     SD_UNUSED(random_intensity_);
 
-    std::vector<float> scaled_sample_(data_size_);
-
     // Euler method:: sigma get
     float sigma_curs = scheduler_sigmas[step_index_];
     float sigma_next = scheduler_sigmas[step_index_ + 1];
@@ -57,15 +51,16 @@ std::vector<float> EulerAncestralDiscreteScheduler::execute_method(
     }
 
     // Euler Ancestral method:: current noise decrees
-    for (int i = 0; i < data_size_; i++) {
-        scaled_sample_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs;         // derivative_out = (sample - predict_sample) / sigma
-        scaled_sample_[i] = (samples_data_[i] + scaled_sample_[i] * sigma_dt);          // previous_down = sample + derivative_out * dt
-        if (sigma_next > 0) {
-            scaled_sample_[i] = scaled_sample_[i] + euler_a_random.next() * sigma_up;    // producted_out = previous_down + random_noise * sigma_up
+    const float* random_noise_ = (sigma_next > 0) ? noise(data_size_, step_index_, sigma_up) : nullptr;
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            float derivative_ = (samples_data_[i] - predict_data_[i]) / sigma_curs;         // derivative_out = (sample - predict_sample) / sigma
+            samples_data_[i] = (samples_data_[i] + derivative_ * sigma_dt);                 // previous_down = sample + derivative_out * dt
+            if (random_noise_) {
+                samples_data_[i] = samples_data_[i] + random_noise_[i];                     // producted_out = previous_down + random_noise * sigma_up
+            }
         }
-    }
-
-    return scaled_sample_;
+    });
 }
 
 } // namespace scheduler
@@ -17,14 +17,17 @@ private:
     std::vector<float> original_sample;
 
 protected:
+    void correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const override;
     uint64_t correction_steps(uint64_t inference_steps_) override;
-    std::vector<float> execute_method(
+    void execute_method(
         const float *predict_data_,
-        const float *samples_data_,
+        float *samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
     ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
 
 public:
     explicit HeunDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_){
@@ -34,41 +37,42 @@ public:
 };
 
 // base on: https://github.com/huggingface/diffusers/blob/main/src/diffusers/schedulers/scheduling_heun_discrete.py
-uint64_t HeunDiscreteScheduler::correction_steps(uint64_t inference_steps_){
+void HeunDiscreteScheduler::correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const {
     int start_at = 0;
-    int end_when = int(scheduler_sigmas.size() - 1);
+    int end_when = int(schedule_.sigmas.size() - 1);
 
-    std::map<long, int64_t> temp_scheduler_timesteps;
+    std::vector<int64_t> temp_scheduler_timesteps;
     vector<float> temp_scheduler_sigmas;
 
-    temp_scheduler_timesteps.insert(make_pair(start_at, scheduler_timesteps[start_at]));
-    temp_scheduler_sigmas.push_back(scheduler_sigmas[start_at]);
-    for (uint32_t i = 1; i < scheduler_sigmas.size() - 1; ++i) {
-        uint32_t maj_i = 2 * i - 1;
-        uint32_t dup_i = 2 * i;
-        temp_scheduler_timesteps.insert(make_pair(maj_i, scheduler_timesteps[i]));
-        temp_scheduler_timesteps.insert(make_pair(dup_i, scheduler_timesteps[i]));
-        temp_scheduler_sigmas.push_back(scheduler_sigmas[i]);
-        temp_scheduler_sigmas.push_back(scheduler_sigmas[i]);
+    temp_scheduler_timesteps.push_back(schedule_.timesteps[start_at]);
+    temp_scheduler_sigmas.push_back(schedule_.sigmas[start_at]);
+    for (uint32_t i = 1; i < schedule_.sigmas.size() - 1; ++i) {
+        temp_scheduler_timesteps.push_back(schedule_.timesteps[i]);
+        temp_scheduler_timesteps.push_back(schedule_.timesteps[i]);
+        temp_scheduler_sigmas.push_back(schedule_.sigmas[i]);
+        temp_scheduler_sigmas.push_back(schedule_.sigmas[i]);
     }
-    temp_scheduler_sigmas.push_back(scheduler_sigmas[end_when]);
+    temp_scheduler_sigmas.push_back(schedule_.sigmas[end_when]);
 
-    scheduler_timesteps = temp_scheduler_timesteps;
-    scheduler_sigmas = temp_scheduler_sigmas;
+    schedule_.timesteps = temp_scheduler_timesteps;
+    schedule_.sigmas = temp_scheduler_sigmas;
+}
 
-    return inference_steps_ * 2 - 1;
+uint64_t HeunDiscreteScheduler::correction_steps(uint64_t inference_steps_){
+    prev_derivative.clear();
+    original_sample.clear();
+    return uint64_t(scheduler_steps);
 }
 
-std::vector<float> HeunDiscreteScheduler::execute_method(
+void HeunDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
     SD_UNUSED(random_intensity_);
 
-    std::vector<float> scaled_sample_(data_size_);
     bool is_first_order_ = (step_index_ % 2 == 0);
 
     // Heun method:: heun start with euler normal
@@ -84,28 +88,38 @@ std::vector<float> HeunDiscreteScheduler::execute_method(
     if(sigma_next > 0) {
         prev_derivative.resize(data_size_);
         original_sample.resize(data_size_);
-        for (int i = 0; i < data_size_; i++) {  // needs to be built in local step, order_ recalculate;
-            float curs_derivative = (samples_data_[i] - predict_data_[i]) / sigma_curs;
-            if (is_first_order_) {
-                scaled_sample_[i] = (samples_data_[i] + curs_derivative * sigma_dt);    // output = sample + derivative_mid * dt
-                prev_derivative[i] = curs_derivative;
-                original_sample[i] = samples_data_[i];
-            } else {
-                scaled_sample_[i]  = 0.5f * (prev_derivative[i] + curs_derivative);     // curs_der = (prev_sample - predict_next) / sigma_next
-                scaled_sample_[i] = (original_sample[i] + scaled_sample_[i] * sigma_dt);  // output = sample + derivative_mid * dt
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {  // needs to be built in local step, order_ recalculate;
+                float curs_derivative = (samples_data_[i] - predict_data_[i]) / sigma_curs;
+                if (is_first_order_) {
+                    prev_derivative[i] = curs_derivative;
+                    original_sample[i] = samples_data_[i];
+                    samples_data_[i] = (samples_data_[i] + curs_derivative * sigma_dt);     // output = sample + derivative_mid * dt
+                } else {
+                    float mid_derivative = 0.5f * (prev_derivative[i] + curs_derivative);   // curs_der = (prev_sample - predict_next) / sigma_next
+                    samples_data_[i] = (original_sample[i] + mid_derivative * sigma_dt);    // output = sample + derivative_mid * dt
+                }
             }
-        }
+        });
     } else {
         // Final round use euler normal to calculate
-        for (int i = 0; i < data_size_; i++) {
-            scaled_sample_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs;     // derivative_out = (sample - predict_sample) / sigma
-            scaled_sample_[i] = (samples_data_[i] + scaled_sample_[i] * sigma_dt);      // previous_down = sample + derivative_out * dt
-        }
-        original_sample.clear();
-        prev_derivative.clear();
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                float derivative_ = (samples_data_[i] - predict_data_[i]) / sigma_curs;     // derivative_out = (sample - predict_sample) / sigma
+                samples_data_[i] = (samples_data_[i] + derivative_ * sigma_dt);             // previous_down = sample + derivative_out * dt
+            }
+        });
     }
+}
+
+void HeunDiscreteScheduler::save_history(StateWriter &writer_) const {
+    writer_.put(prev_derivative);
+    writer_.put(original_sample);
+}
 
-    return scaled_sample_;
+void HeunDiscreteScheduler::load_history(StateReader &reader_) {
+    reader_.get(prev_derivative);
+    reader_.get(original_sample);
 }
 
 } // namespace scheduler
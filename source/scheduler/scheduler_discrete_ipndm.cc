@@ -20,7 +20,7 @@
  *   default sigma schedule — same spirit as PLMS in community UIs.
  * - eps is recovered from the base-converted x0 as (sample − x0)/σ_i, so ets
  *   holds genuine eps and v_prediction is handled transparently.
- * - runs entirely on the base schedule: no correction_steps override, karras
+ * - runs entirely on the base schedule: no correction_schedule override, karras
  *   sigma strategy composes for free.
  */
 #ifndef SCHEDULER_DISCRETE_IPNDM
@@ -34,19 +34,19 @@ namespace scheduler {
 
 class IPNDMDiscreteScheduler: public SchedulerBase {
 private:
-    typedef std::vector<float> IPndmData;
-
-    std::vector<IPndmData> ets_;                 // eps history, oldest-first, cap 4
+    HistoryRing ets_;                            // eps history, newest first, cap 4
 
 protected:
     uint64_t correction_steps(uint64_t inference_steps_) override;
-    std::vector<float> execute_method(
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
     ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
 
 public:
     explicit IPNDMDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
@@ -59,13 +59,13 @@ public:
 
 // base schedule is used as-is; only reset the multistep history per run
 uint64_t IPNDMDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
-    ets_.clear();
-    return inference_steps_;
+    ets_.reset(4);
+    return uint64_t(scheduler_steps);
 }
 
-std::vector<float> IPNDMDiscreteScheduler::execute_method(
+void IPNDMDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
@@ -76,41 +76,39 @@ std::vector<float> IPNDMDiscreteScheduler::execute_method(
     float sigma_curs_ = scheduler_sigmas[size_t(step_index_)];
     float sigma_next_ = scheduler_sigmas[size_t(step_index_) + 1];
 
-    IPndmData curs_eps_(data_size_, 0.0f);
-    for (long i = 0; i < data_size_; i++) {
-        curs_eps_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs_;
-    }
+    float* curs_eps_ = ets_.push(data_size_);
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            curs_eps_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs_;
+        }
+    });
 
-    ets_.push_back(std::move(curs_eps_));
-    if (ets_.size() > 4) ets_.erase(ets_.begin());
-
-    // Adams-Bashforth extrapolation over eps history (newest-first weights)
-    size_t cnt_ = ets_.size();
-    IPndmData eps_ab_(ets_.back());
-    if (cnt_ == 2) {
-        const IPndmData& e1_ = ets_[cnt_ - 1];
-        const IPndmData& e2_ = ets_[cnt_ - 2];
-        for (long i = 0; i < data_size_; i++) eps_ab_[i] = (3.0f * e1_[i] - e2_[i]) / 2.0f;
-    } else if (cnt_ == 3) {
-        const IPndmData& e1_ = ets_[cnt_ - 1];
-        const IPndmData& e2_ = ets_[cnt_ - 2];
-        const IPndmData& e3_ = ets_[cnt_ - 3];
-        for (long i = 0; i < data_size_; i++) eps_ab_[i] = (23.0f * e1_[i] - 16.0f * e2_[i] + 5.0f * e3_[i]) / 12.0f;
-    } else if (cnt_ >= 4) {
-        const IPndmData& e1_ = ets_[cnt_ - 1];
-        const IPndmData& e2_ = ets_[cnt_ - 2];
-        const IPndmData& e3_ = ets_[cnt_ - 3];
-        const IPndmData& e4_ = ets_[cnt_ - 4];
-        for (long i = 0; i < data_size_; i++) eps_ab_[i] = (55.0f * e1_[i] - 59.0f * e2_[i] + 37.0f * e3_[i] - 9.0f * e4_[i]) / 24.0f;
-    }
-
-    // deterministic DDIM-form update in EDM space
+    // Adams-Bashforth extrapolation over eps history (newest-first weights),
+    // fused with the deterministic DDIM-form update in EDM space
+    long cnt_ = ets_.size();
     float sigma_dt_ = sigma_next_ - sigma_curs_;
-    std::vector<float> prev_samples_(data_size_, 0.0f);
-    for (long i = 0; i < data_size_; i++) {
-        prev_samples_[i] = samples_data_[i] + eps_ab_[i] * sigma_dt_;
-    }
-    return prev_samples_;
+    const float* e1_ = ets_.at(0);
+    const float* e2_ = (cnt_ > 1) ? ets_.at(1) : nullptr;
+    const float* e3_ = (cnt_ > 2) ? ets_.at(2) : nullptr;
+    const float* e4_ = (cnt_ > 3) ? ets_.at(3) : nullptr;
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            float eps_ab_;
+            if (cnt_ == 1)      eps_ab_ = e1_[i];
+            else if (cnt_ == 2) eps_ab_ = (3.0f * e1_[i] - e2_[i]) / 2.0f;
+            else if (cnt_ == 3) eps_ab_ = (23.0f * e1_[i] - 16.0f * e2_[i] + 5.0f * e3_[i]) / 12.0f;
+            else                eps_ab_ = (55.0f * e1_[i] - 59.0f * e2_[i] + 37.0f * e3_[i] - 9.0f * e4_[i]) / 24.0f;
+            samples_data_[i] = samples_data_[i] + eps_ab_ * sigma_dt_;
+        }
+    });
+}
+
+void IPNDMDiscreteScheduler::save_history(StateWriter &writer_) const {
+    ets_.save(writer_);
+}
+
+void IPNDMDiscreteScheduler::load_history(StateReader &reader_) {
+    ets_.load(reader_);
 }
 
 } // namespace scheduler
@@ -12,13 +12,10 @@ namespace sd {
 namespace scheduler {
 
 class LCMDiscreteScheduler : public SchedulerBase {
-private:
-    RandomGenerator lcm_random;
-
 protected:
-    std::vector<float> execute_method(
+    void execute_method(
         const float *predict_data_,
-        const float *samples_data_,
+        float *samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
@@ -26,37 +23,35 @@ protected:
 
 public:
     explicit LCMDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_){
-        lcm_random.seed(0);
     }
 
     ~LCMDiscreteScheduler() override = default;
 };
 
 // base on: https://github.com/huggingface/diffusers/blob/main/src/diffusers/schedulers/scheduling_lcm.py
-std::vector<float> LCMDiscreteScheduler::execute_method(
+void LCMDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
     SD_UNUSED(random_intensity_);
 
-    std::vector<float> scaled_sample_(data_size_);
-
     // LCM method:: sigma get, only next sigma be needed
     float sigma_next = scheduler_sigmas[step_index_ + 1]; // sigma_next prev_timestep(caused by inference is a reversed working flow)
 
     // LCM method:: current noise decrees
-    for (int i = 0; i < data_size_; i++) {
-        if (sigma_next > 0) {
-            scaled_sample_[i] = (predict_data_[i] + lcm_random.next() * sigma_next);       // producted_out = predict_sample + random_noise * sigma_next
-        } else {
-            scaled_sample_[i] = (predict_data_[i]);
+    const float* random_noise_ = (sigma_next > 0) ? noise(data_size_, step_index_, sigma_next) : nullptr;
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            if (random_noise_) {
+                samples_data_[i] = (predict_data_[i] + random_noise_[i]);                  // producted_out = predict_sample + random_noise * sigma_next
+            } else {
+                samples_data_[i] = (predict_data_[i]);
+            }
         }
-    }
-
-    return scaled_sample_;
+    });
 }
 
 } // namespace scheduler
@@ -13,19 +13,23 @@ namespace scheduler {
 
 class LMSDiscreteScheduler: public SchedulerBase {
 private:
-    std::vector<std::vector<float>> lms_derivatives;
+    HistoryRing lms_derivatives;                // ODE derivatives, newest first
 
 private:
-    float get_lms_coefficient(long order, long t, int current_order);
+    static double get_lms_coefficient(const std::vector<float> &sigmas_, long history_num_, long t, int h);
 
 protected:
-    std::vector<float> execute_method(
+    void correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const override;
+    uint64_t correction_steps(uint64_t inference_steps_) override;
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
     ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
 
 public:
     explicit LMSDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
@@ -35,35 +39,55 @@ public:
 };
 
 //python line 135 of scheduling_lms_discrete.py
-float LMSDiscreteScheduler::get_lms_coefficient(long history_num_, long t, int h)
+double LMSDiscreteScheduler::get_lms_coefficient(const std::vector<float> &sigmas_, long history_num_, long t, int h)
 {
     // Compute a linear multistep coefficient.
-    auto LmsDerivative = [&](float tau)->float {
-        float prod = 1.0;
+    auto LmsDerivative = [&](double tau)->double {
+        double prod = 1.0;
         for (int k = 0; k < history_num_; k++) {
             if (h != k) {
-                prod *= (tau - scheduler_sigmas[t - k]) / (scheduler_sigmas[t - h] - scheduler_sigmas[t - k]);
+                prod *= (tau - sigmas_[t - k]) / (double(sigmas_[t - h]) - sigmas_[t - k]);
             }
         }
         return prod;
     };
 
-    // Calculate integration with encapsulated IntegralHelper
-    int pieces_ = 1000;
-    auto integration_ = IntegralHelper::trapezoidal_integral<float>(
-        LmsDerivative , scheduler_sigmas[t] , scheduler_sigmas[t + 1], pieces_
+    // the integrand is a degree (history_num_ - 1) polynomial: ceil(history_num_ / 2) Gauss-Legendre
+    // points integrate it exactly for any history length
+    int points_ = int(history_num_ + 1) / 2;
+    return IntegralHelper::gauss_legendre_integral<double>(
+        LmsDerivative, double(sigmas_[t]), double(sigmas_[t + 1]), points_
     );
-    return integration_;
 }
 
-std::vector<float> LMSDiscreteScheduler::execute_method(
+// coefficients only depend on the sigma sequence, so the whole trajectory is integrated once per cached schedule
+void LMSDiscreteScheduler::correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const {
+    long maintain_order_ = long(scheduler_config.scheduler_maintain_cache);
+    long step_count_ = long(schedule_.timesteps.size());
+
+    schedule_.coefficients_stride = uint64_t(maintain_order_);
+    schedule_.coefficients.assign(step_count_ * maintain_order_, 0.0f);
+    for (long t = 0; t < step_count_; t++) {
+        long history_num = min(t + 1, maintain_order_);
+        for (int cur_order_ = 0; cur_order_ < history_num; cur_order_++) {
+            schedule_.coefficients[t * maintain_order_ + cur_order_] =
+                float(get_lms_coefficient(schedule_.sigmas, history_num, t, cur_order_));
+        }
+    }
+}
+
+uint64_t LMSDiscreteScheduler::correction_steps(uint64_t inference_steps_){
+    lms_derivatives.reset(long(scheduler_config.scheduler_maintain_cache));
+    return uint64_t(scheduler_steps);
+}
+
+void LMSDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
-    std::vector<float> scaled_sample_(data_size_);
     long maintain_order_ = long(scheduler_config.scheduler_maintain_cache);
 
     // LMS method:: sigma get
@@ -71,36 +95,42 @@ std::vector<float> LMSDiscreteScheduler::execute_method(
     float sigma_curs = scheduler_sigmas[step_index_];
 
     // LMS method:: current noise decrees
-    // 1. Convert to an ODE derivative
-    std::vector<float> cur_derivative_(data_size_);
-    for (int i = 0; i < data_size_; i++) {
-        // derivative_out = (sample - predict_sample) / sigma
-        cur_derivative_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs;
-    }
-
-    // 2. Record ODE derivative in history (reverse recs)
-    lms_derivatives.insert(lms_derivatives.begin(), cur_derivative_);
-    if (lms_derivatives.size() > maintain_order_) {
-        lms_derivatives.pop_back();
-    }
-
-    // 3. compute linear multistep coefficients
-    std::vector<float> lms_coeffs_(history_num);
-    for (int cur_order_ = 0; cur_order_ < history_num; cur_order_++) {
-        // target_coeffs_derivative = lms_method(...)
-        lms_coeffs_[cur_order_] = get_lms_coefficient(history_num, step_index_, cur_order_);
+    // 1. Convert to an ODE derivative, recorded in history (reverse recs, recycles the oldest slot)
+    float* cur_derivative_ = lms_derivatives.push(data_size_);
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            // derivative_out = (sample - predict_sample) / sigma
+            cur_derivative_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs;
+        }
+    });
+
+    // 2. linear multistep coefficients, precomputed in correction_schedule
+    const float* lms_coeffs_ = scheduler_schedule->coefficients.data() +
+                               step_index_ * long(scheduler_schedule->coefficients_stride);
+    std::vector<const float*> derivatives_(history_num);
+    for (int j = 0; j < history_num; j++) {
+        derivatives_[j] = lms_derivatives.at(j);
     }
 
-    // 4. compute previous sample based on the derivative path
-    for (int i = 0; i < data_size_; i++) {
-        // output_latent = sample + sum(lms_coeffs * target_coeffs_derivative)
-        scaled_sample_[i] = samples_data_[i];
-        for (int j = 0; j < history_num; j++) {
-            scaled_sample_[i] += lms_coeffs_[j] * lms_derivatives[j][i];
+    // 3. compute previous sample based on the derivative path
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            // output_latent = sample + sum(lms_coeffs * target_coeffs_derivative)
+            float sample_ = samples_data_[i];
+            for (int j = 0; j < history_num; j++) {
+                sample_ += lms_coeffs_[j] * derivatives_[j][i];
+            }
+            samples_data_[i] = sample_;
         }
-    }
+    });
+}
+
+void LMSDiscreteScheduler::save_history(StateWriter &writer_) const {
+    lms_derivatives.save(writer_);
+}
 
-    return scaled_sample_;
+void LMSDiscreteScheduler::load_history(StateReader &reader_) {
+    lms_derivatives.load(reader_);
 }
 
 } // namespace scheduler
@@ -14,8 +14,8 @@
  *
  * Port notes: eps is recovered from the base-converted x0 as (sample - x0)/σ_i,
  * so ets always holds genuine eps and v_prediction is handled transparently.
- * Internal timestep sequence (leading spacing + prk quarters) is rebuilt in
- * correction_steps.
+ * Internal timestep sequence (leading spacing + prk quarters) is built once per
+ * config in correction_schedule; per-run RK/ets state is reset in correction_steps.
  *
  * Coordinate fix (2026-07-30): paper formula (9) is derived for VP-space
  * samples, but this framework carries EDM samples (x = x0 + σ·ε). Algebra:
@@ -39,34 +39,38 @@ class PNDMDiscreteScheduler: public SchedulerBase {
 private:
     typedef std::vector<float> PndmData;
 
-    std::vector<PndmData> ets_;                // eps history, oldest-first, cap 4
+    HistoryRing ets_;                          // eps history, newest first, cap 4
     PndmData cur_model_output_;                // RK accumulator
     PndmData cur_sample_;                      // RK anchor sample
+    PndmData cur_eps_;                         // eps of RK evaluations that are not recorded in ets_
     long pndm_counter_ = 0;
     long prk_total_steps_ = 0;                 // = 4 * (k-1), k = min(4, inference_steps)
     long delta_ = 0;                           // training_steps / inference_steps
     long delta_half_ = 0;
-    std::vector<int64_t> prk_anchor_ts_;       // prk_timesteps[(c//4)*4] per RK group
 
 private:
-    // deterministic update in EDM space: x_prev = x + (σ_prev − σ_ref)·eps
-    PndmData get_prev_sample(
+    // deterministic update in EDM space: x_prev = x + (σ_prev − σ_ref)·eps, prev_data_ may alias sample_data_
+    void get_prev_sample(
         const float* eps_data_,
         const float* sample_data_,
+        float* prev_data_,
         long data_size_,
         float sigma_ref_,
         float sigma_prev_
     );
 
 protected:
+    void correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const override;
     uint64_t correction_steps(uint64_t inference_steps_) override;
-    std::vector<float> execute_method(
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
     ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
 
 public:
     explicit PNDMDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
@@ -77,44 +81,46 @@ public:
 
 /* Assistant Operations ===================================================*/
 
-PNDMDiscreteScheduler::PndmData PNDMDiscreteScheduler::get_prev_sample(
+void PNDMDiscreteScheduler::get_prev_sample(
     const float* eps_data_,
     const float* sample_data_,
+    float* prev_data_,
     long data_size_,
     float sigma_ref_,
     float sigma_prev_
 ) {
     float sigma_dt_ = sigma_prev_ - sigma_ref_;
-    PndmData prev_samples_(data_size_, 0.0f);
-    for (long i = 0; i < data_size_; i++) {
-        prev_samples_[i] = sample_data_[i] + eps_data_[i] * sigma_dt_;
-    }
-    return prev_samples_;
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            prev_data_[i] = sample_data_[i] + eps_data_[i] * sigma_dt_;
+        }
+    });
 }
 
 /* Essential Operations ===================================================*/
 
-// rebuild internal sequence: [prk quarters (leading spacing), plms descending]
-uint64_t PNDMDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
-    delta_      = long(scheduler_config.scheduler_training_steps / inference_steps_);
-    delta_half_ = delta_ / 2;
+// build internal sequence: [prk quarters (leading spacing), plms descending]
+void PNDMDiscreteScheduler::correction_schedule(ScheduleTable &schedule_, uint64_t inference_steps_) const {
+    long step_delta_      = long(scheduler_config.scheduler_training_steps / inference_steps_);
+    long step_delta_half_ = step_delta_ / 2;
 
-    // leading spacing: t_i = round(i * delta)
-    std::vector<int64_t> base_ts_(inference_steps_);
-    for (uint64_t i = 0; i < inference_steps_; ++i) {
-        base_ts_[i] = int64_t(std::llround(double(i) * double(delta_)));
+    // leading spacing: t_i = round(i * delta); img2img strength keeps the lowest kept_steps_ of them
+    uint64_t kept_steps_ = uint64_t(schedule_.timesteps.size());
+    std::vector<int64_t> base_ts_(kept_steps_);
+    for (uint64_t i = 0; i < kept_steps_; ++i) {
+        base_ts_[i] = int64_t(std::llround(double(i) * double(step_delta_)));
     }
 
     // prk quarters, verbatim from diffusers:
     // prk = base_ts[-k:].repeat(2) + tile([0, delta/2], k); prk = (prk[:-1].repeat(2)[1:-1])[::-1]
-    uint64_t k_ = std::min<uint64_t>(4, inference_steps_);
+    uint64_t k_ = std::min<uint64_t>(4, kept_steps_);
     std::vector<int64_t> prk_;
     {
         std::vector<int64_t> tail_(base_ts_.end() - k_, base_ts_.end());
         std::vector<int64_t> tiled_;
         for (uint64_t i = 0; i < k_; ++i) {
             tiled_.push_back(tail_[i]);
-            tiled_.push_back(tail_[i] + delta_half_);
+            tiled_.push_back(tail_[i] + step_delta_half_);
         }
         tiled_.pop_back();                                   // [:-1]
         std::vector<int64_t> doubled_;
@@ -122,35 +128,31 @@ uint64_t PNDMDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
         prk_.assign(doubled_.begin() + 1, doubled_.end() - 1); // [1:-1]
         std::reverse(prk_.begin(), prk_.end());
     }
-    prk_total_steps_ = long(prk_.size());                    // 4 * (k-1)
-    for (long g_ = 0; g_ * 4 < prk_total_steps_; ++g_) {
-        prk_anchor_ts_.push_back(prk_[size_t(g_ * 4)]);
-    }
 
     // plms = base_ts[:-3] reversed
     std::vector<int64_t> plms_;
     {
-        uint64_t keep_ = (inference_steps_ > 3) ? inference_steps_ - 3 : 0;
+        uint64_t keep_ = (kept_steps_ > 3) ? kept_steps_ - 3 : 0;
         for (uint64_t i = 0; i < keep_; ++i) plms_.push_back(base_ts_[i]);
         std::reverse(plms_.begin(), plms_.end());
     }
 
     // full internal sequence + matching sigmas for base scale/x0-conversion
-    std::map<long, int64_t> expanded_timesteps_;
+    std::vector<int64_t> expanded_timesteps_;
     vector<float> expanded_sigmas_;
-    long idx_ = 0;
     for (int64_t t_ : prk_) {
-        expanded_timesteps_.insert(make_pair(idx_, t_));
+        expanded_timesteps_.push_back(t_);
         expanded_sigmas_.push_back(generate_sigma_at(float(t_)));
-        idx_++;
     }
     for (int64_t t_ : plms_) {
-        expanded_timesteps_.insert(make_pair(idx_, t_));
+        expanded_timesteps_.push_back(t_);
         expanded_sigmas_.push_back(generate_sigma_at(float(t_)));
-        idx_++;
     }
-    scheduler_timesteps = expanded_timesteps_;
-    scheduler_sigmas    = expanded_sigmas_;
+    // a single step has neither RK quarters nor PLMS history: keep the base schedule,
+    // which runs as one PLMS step from σ_max down to σ(0)
+    if (expanded_timesteps_.empty()) return;
+    schedule_.timesteps = expanded_timesteps_;
+    schedule_.sigmas    = expanded_sigmas_;
 
     // init-noise alignment: leading spacing starts at t = (n-1)*delta < 999,
     // so the base σ_max (=σ(999)) no longer matches the first eval timestep.
@@ -158,92 +160,122 @@ uint64_t PNDMDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
     // framework UNet input is mask/√(σ_0²+1), hence set max_sigma = √(σ_0²+1)
     // so that scale(mask) == ε exactly at the first eval.
     float sigma_first_ = expanded_sigmas_[0];
-    scheduler_max_sigma = std::sqrt(sigma_first_ * sigma_first_ + 1.0f);
-    return uint64_t(idx_);
+    schedule_.max_sigma = std::sqrt(sigma_first_ * sigma_first_ + 1.0f);
+}
+
+uint64_t PNDMDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
+    delta_           = long(scheduler_config.scheduler_training_steps / inference_steps_);
+    delta_half_      = delta_ / 2;
+    prk_total_steps_ = 4 * long(std::min<uint64_t>(4, inference_steps_ - scheduler_skip_steps) - 1);
+    pndm_counter_    = 0;
+    ets_.reset(4);
+    cur_model_output_.clear();
+    cur_sample_.clear();
+    return uint64_t(scheduler_steps);
 }
 
-std::vector<float> PNDMDiscreteScheduler::execute_method(
+void PNDMDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
     SD_UNUSED(random_intensity_);
 
-    // recover genuine eps from base-converted x0: eps = (sample - x0) / σ_i
+    // recover genuine eps from base-converted x0: eps = (sample - x0) / σ_i;
+    // RK group heads and PLMS steps write it straight into the ets ring
     float sigma_curs_ = scheduler_sigmas[size_t(step_index_)];
-    PndmData curs_eps_(data_size_, 0.0f);
-    for (long i = 0; i < data_size_; i++) {
-        curs_eps_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs_;
+    bool prk_phase_ = (pndm_counter_ < prk_total_steps_);
+    float* curs_eps_ = nullptr;
+    if (!prk_phase_ || pndm_counter_ % 4 == 0) {
+        curs_eps_ = ets_.push(data_size_);
+    } else {
+        cur_eps_.resize(data_size_);
+        curs_eps_ = cur_eps_.data();
     }
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            curs_eps_[i] = (samples_data_[i] - predict_data_[i]) / sigma_curs_;
+        }
+    });
 
     int64_t t_in_ = scheduler_timesteps[step_index_];
 
-    if (pndm_counter_ < prk_total_steps_) {
+    if (prk_phase_) {
         /* ---- Runge-Kutta quarter phase ---- */
         long diff_to_prev_ = (pndm_counter_ % 2 == 0) ? delta_half_ : 0;
         int64_t prev_t_ = t_in_ - diff_to_prev_;
-        int64_t t_up_ = prk_anchor_ts_[size_t(pndm_counter_ / 4)];
+        int64_t t_up_ = scheduler_timesteps[(pndm_counter_ / 4) * 4];   // RK group anchor
         long phase_ = pndm_counter_ % 4;
 
         if (phase_ == 0) {
-            cur_model_output_.assign(data_size_, 0.0f);
-            for (long i = 0; i < data_size_; i++) cur_model_output_[i] = curs_eps_[i] / 6.0f;
-            ets_.push_back(curs_eps_);
-            if (ets_.size() > 4) ets_.erase(ets_.begin());
+            cur_model_output_.resize(data_size_);
+            ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+                for (long i = begin_; i < end_; i++) cur_model_output_[i] = curs_eps_[i] / 6.0f;
+            });
             cur_sample_.assign(samples_data_, samples_data_ + data_size_);
         } else if (phase_ == 1 || phase_ == 2) {
-            for (long i = 0; i < data_size_; i++) cur_model_output_[i] += curs_eps_[i] / 3.0f;
+            ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+                for (long i = begin_; i < end_; i++) cur_model_output_[i] += curs_eps_[i] / 3.0f;
+            });
         } else {
-            for (long i = 0; i < data_size_; i++) curs_eps_[i] = cur_model_output_[i] + curs_eps_[i] / 6.0f;
-            cur_model_output_.clear();
+            ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+                for (long i = begin_; i < end_; i++) curs_eps_[i] = cur_model_output_[i] + curs_eps_[i] / 6.0f;
+            });
         }
 
         const float* anchor_ = cur_sample_.empty() ? samples_data_ : cur_sample_.data();
         float sigma_ref_  = generate_sigma_at(float(t_up_));
         float sigma_prev_ = generate_sigma_at(float(std::max<int64_t>(prev_t_, 0)));
         pndm_counter_++;
-        return get_prev_sample(curs_eps_.data(), anchor_, data_size_, sigma_ref_, sigma_prev_);
+        get_prev_sample(curs_eps_, anchor_, samples_data_, data_size_, sigma_ref_, sigma_prev_);
     } else {
         /* ---- PLMS phase ---- */
         int64_t prev_t_ = t_in_ - delta_;
-        ets_.push_back(curs_eps_);
-        if (ets_.size() > 4) ets_.erase(ets_.begin());
-
-        PndmData& e1_ = ets_.back();
-        switch (ets_.size()) {
-            case 1:
-                break;                                       // e = e1
-            case 2: {
-                PndmData& e2_ = ets_[ets_.size() - 2];
-                for (long i = 0; i < data_size_; i++) curs_eps_[i] = (3.0f * e1_[i] - e2_[i]) / 2.0f;
-                break;
-            }
-            case 3: {
-                PndmData& e2_ = ets_[ets_.size() - 2];
-                PndmData& e3_ = ets_[ets_.size() - 3];
-                for (long i = 0; i < data_size_; i++) curs_eps_[i] = (23.0f * e1_[i] - 16.0f * e2_[i] + 5.0f * e3_[i]) / 12.0f;
-                break;
-            }
-            default: {
-                PndmData& e2_ = ets_[ets_.size() - 2];
-                PndmData& e3_ = ets_[ets_.size() - 3];
-                PndmData& e4_ = ets_[ets_.size() - 4];
-                for (long i = 0; i < data_size_; i++) curs_eps_[i] = (55.0f * e1_[i] - 59.0f * e2_[i] + 37.0f * e3_[i] - 9.0f * e4_[i]) / 24.0f;
-                break;
-            }
-        }
 
         pndm_counter_++;
         float sigma_ref_  = generate_sigma_at(float(t_in_));
         // last PLMS step hits prev_t < 0: diffusers uses final_alpha_cumprod
         // (= alphas_cumprod[0] when set_alpha_to_one=false), i.e. σ(0)
         float sigma_prev_ = generate_sigma_at(float(std::max<int64_t>(prev_t_, 0)));
-        return get_prev_sample(curs_eps_.data(), samples_data_, data_size_, sigma_ref_, sigma_prev_);
+        float sigma_dt_   = sigma_prev_ - sigma_ref_;
+
+        // AB extrapolation over the ring (newest first), fused with the EDM update
+        long cnt_ = ets_.size();
+        const float* e1_ = ets_.at(0);
+        const float* e2_ = (cnt_ > 1) ? ets_.at(1) : nullptr;
+        const float* e3_ = (cnt_ > 2) ? ets_.at(2) : nullptr;
+        const float* e4_ = (cnt_ > 3) ? ets_.at(3) : nullptr;
+        ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+            for (long i = begin_; i < end_; i++) {
+                float eps_;
+                if (cnt_ == 1)      eps_ = e1_[i];
+                else if (cnt_ == 2) eps_ = (3.0f * e1_[i] - e2_[i]) / 2.0f;
+                else if (cnt_ == 3) eps_ = (23.0f * e1_[i] - 16.0f * e2_[i] + 5.0f * e3_[i]) / 12.0f;
+                else                eps_ = (55.0f * e1_[i] - 59.0f * e2_[i] + 37.0f * e3_[i] - 9.0f * e4_[i]) / 24.0f;
+                samples_data_[i] = samples_data_[i] + eps_ * sigma_dt_;
+            }
+        });
     }
 }
 
+void PNDMDiscreteScheduler::save_history(StateWriter &writer_) const {
+    ets_.save(writer_);
+    writer_.put(cur_model_output_);
+    writer_.put(cur_sample_);
+    writer_.put(cur_eps_);
+    writer_.put<int64_t>(pndm_counter_);
+}
+
+void PNDMDiscreteScheduler::load_history(StateReader &reader_) {
+    ets_.load(reader_);
+    reader_.get(cur_model_output_);
+    reader_.get(cur_sample_);
+    reader_.get(cur_eps_);
+    pndm_counter_ = long(reader_.get<int64_t>());
+}
+
 } // namespace scheduler
 } // namespace sd
 } // namespace onnx
@@ -35,17 +35,18 @@ private:
                                                              // (λ-extrapolation stability guard,
                                                              //  generalizes diffusers lower_order_final)
 
-    std::vector<UniData> history_dnoise;       // model x0-predictions, newest first
-    std::vector<double>  history_lambda;       // lambda value of each history entry, newest first
-    UniData              last_samples_;        // sample produced at previous step
+    HistoryRing history_dnoise;                // model x0-predictions, newest first; entry k was
+                                               // recorded k steps ago, its λ comes from the sigma table
+    UniData     last_samples_;                 // sample produced at previous step
 
 private:
     /* numeric assistants ===================================================*/
     static double lambda_at(float sigma_);                       // λ = -ln(σ_ratio), sigma floored
 
     long   get_unified_history_count(long step_index_) const;
-    UniData get_unified_correction(const UniData& curs_dnoised_, long step_index_);
-    UniData get_unified_prediction(const UniData& curs_samples_, long step_index_);
+    double get_history_lambda(long step_index_, long age_) const;
+    void   get_unified_correction(const float* curs_dnoised_, float* samples_data_, long data_size_, long step_index_);
+    void   get_unified_prediction(float* samples_data_, long data_size_, long step_index_);
 
     // expand Lagrange basis L_k(ξ) (points r_[] with r_[0]=0) into power coefficients
     static std::vector<CoefData> lagrange_power_coefs(const CoefData& r_);
@@ -55,13 +56,16 @@ private:
     static CoefData integrate_basis_corrector(const CoefData& r_, double a_);
 
 protected:
-    std::vector<float> execute_method(
+    uint64_t correction_steps(uint64_t inference_steps_) override;
+    void execute_method(
         const float* predict_data_,
-        const float* samples_data_,
+        float* samples_data_,
         long data_size_,
         long step_index_,
         float random_intensity_
     ) override;
+    void save_history(StateWriter &writer_) const override;
+    void load_history(StateReader &reader_) override;
 
 public:
     explicit UniPCDiscreteScheduler(SchedulerConfig scheduler_config_ = {}) : SchedulerBase(scheduler_config_) {
@@ -81,6 +85,11 @@ long UniPCDiscreteScheduler::get_unified_history_count(long step_index_) const {
     return std::min(maintain_order_, step_index_);
 }
 
+// history is reset per run and recorded once per step, so age k belongs to step (step_index_ - k)
+double UniPCDiscreteScheduler::get_history_lambda(long step_index_, long age_) const {
+    return lambda_at(scheduler_sigmas[size_t(step_index_ - age_)]);
+}
+
 // L_k(ξ) = Π_{j≠k} (ξ - r_j) / (r_k - r_j), returned as power-series coefficients
 std::vector<UniPCDiscreteScheduler::CoefData> UniPCDiscreteScheduler::lagrange_power_coefs(
     const CoefData& r_
@@ -161,10 +170,9 @@ UniPCDiscreteScheduler::CoefData UniPCDiscreteScheduler::integrate_basis_correct
 
 /* Essential Operations ===================================================*/
 
-UniPCDiscreteScheduler::UniData UniPCDiscreteScheduler::get_unified_correction(
-    const UniData& curs_dnoised_, long step_index_
+void UniPCDiscreteScheduler::get_unified_correction(
+    const float* curs_dnoised_, float* samples_data_, long data_size_, long step_index_
 ) {
-    size_t data_size_ = curs_dnoised_.size();
     float sigma_curs = scheduler_sigmas[size_t(step_index_)];
     float sigma_prev = scheduler_sigmas[size_t(step_index_ - 1)];
 
@@ -173,39 +181,41 @@ UniPCDiscreteScheduler::UniData UniPCDiscreteScheduler::get_unified_correction(
 
     // interpolation points: m0(current, r=0) + history, bounded by maintain order;
     // drop to order-1 when the correction interval is a huge λ-jump (see SD_LAMBDA_JUMP_CAP)
-    long order_ = std::min<long>(long(history_dnoise.size()) + 1,
+    long order_ = std::min<long>(history_dnoise.size() + 1,
                                  long(scheduler_config.scheduler_maintain_cache));
     if (-a_ > SD_LAMBDA_JUMP_CAP) order_ = 1;
     CoefData r(size_t(order_), 0.0);
+    std::vector<const float*> history_(size_t(order_), curs_dnoised_);
     for (long k = 1; k < order_; k++) {
-        r[size_t(k)] = history_lambda[size_t(k - 1)] - lambda_s0;
+        r[size_t(k)] = get_history_lambda(step_index_, k) - lambda_s0;
+        history_[size_t(k)] = history_dnoise.at(k - 1);
     }
     CoefData coefs = integrate_basis_corrector(r, a_);
 
     // x_s0 = (σ_s0/σ_prev) * last + Σ Ã_k m_k
     double f_ = double(sigma_curs) / double(sigma_prev);
-    UniData corrected_(data_size_, 0.0f);
-    for (size_t i = 0; i < data_size_; i++) {
-        double accum = 0.0;
-        accum += coefs[0] * double(curs_dnoised_[i]);
-        for (long k = 1; k < order_; k++) {
-            accum += coefs[size_t(k)] * double(history_dnoise[size_t(k - 1)][i]);
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            double accum = 0.0;
+            for (long k = 0; k < order_; k++) {
+                accum += coefs[size_t(k)] * double(history_[size_t(k)][i]);
+            }
+            samples_data_[i] = float(f_ * double(last_samples_[i]) + accum);
         }
-        corrected_[i] = float(f_ * double(last_samples_[i]) + accum);
-    }
-    return corrected_;
+    });
 }
 
-UniPCDiscreteScheduler::UniData UniPCDiscreteScheduler::get_unified_prediction(
-    const UniData& curs_samples_, long step_index_
+void UniPCDiscreteScheduler::get_unified_prediction(
+    float* samples_data_, long data_size_, long step_index_
 ) {
-    size_t data_size_ = curs_samples_.size();
     float sigma_curs = scheduler_sigmas[size_t(step_index_)];
     float sigma_next = scheduler_sigmas[size_t(step_index_ + 1)];  // appended 0 at final step
 
     // final step targets σ=0: exact limit of the ODE solution is the x0-prediction itself
     if (sigma_next <= SD_LAMBDA_FLOOR_SIGMA) {
-        return history_dnoise[0];
+        const float* curs_dnoised_ = history_dnoise.at(0);
+        std::copy(curs_dnoised_, curs_dnoised_ + data_size_, samples_data_);
+        return;
     }
 
     double lambda_s0 = lambda_at(sigma_curs);
@@ -214,65 +224,75 @@ UniPCDiscreteScheduler::UniData UniPCDiscreteScheduler::get_unified_prediction(
 
     // history already holds m0 at front after update;
     // drop to order-1 when the prediction interval is a huge λ-jump (see SD_LAMBDA_JUMP_CAP)
-    long order_ = std::min<long>(long(history_dnoise.size()),
+    long order_ = std::min<long>(history_dnoise.size(),
                                  long(scheduler_config.scheduler_maintain_cache));
     if (h_ > SD_LAMBDA_JUMP_CAP) order_ = 1;
     CoefData r(size_t(order_), 0.0);
+    std::vector<const float*> history_(size_t(order_), history_dnoise.at(0));
     for (long k = 1; k < order_; k++) {
-        r[size_t(k)] = history_lambda[size_t(k)] - lambda_s0;
+        r[size_t(k)] = get_history_lambda(step_index_, k) - lambda_s0;
+        history_[size_t(k)] = history_dnoise.at(k);
     }
     CoefData coefs = integrate_basis_predictor(r, h_);
 
     // x_t = (σ_t/σ_s0) * x + Σ Ã_k m_k
     double f_ = double(sigma_next) / double(sigma_curs);
 
-    UniData predicted_(data_size_, 0.0f);
-    for (size_t i = 0; i < data_size_; i++) {
-        double accum = 0.0;
-        for (long k = 0; k < order_; k++) {
-            accum += coefs[size_t(k)] * double(history_dnoise[size_t(k)][i]);
+    ParallelHelper::parallel_for(data_size_, [&](long begin_, long end_) {
+        for (long i = begin_; i < end_; i++) {
+            double accum = 0.0;
+            for (long k = 0; k < order_; k++) {
+                accum += coefs[size_t(k)] * double(history_[size_t(k)][i]);
+            }
+            samples_data_[i] = float(f_ * double(samples_data_[i]) + accum);
         }
-        predicted_[i] = float(f_ * double(curs_samples_[i]) + accum);
-    }
-    return predicted_;
+    });
+}
+
+// per-run reset: the history ring is sized by the maintain order once
+uint64_t UniPCDiscreteScheduler::correction_steps(uint64_t inference_steps_) {
+    history_dnoise.reset(long(scheduler_config.scheduler_maintain_cache));
+    last_samples_.clear();
+    return uint64_t(scheduler_steps);
 }
 
 /**
  * UniPC main step: correct -> record -> predict
  */
-std::vector<float> UniPCDiscreteScheduler::execute_method(
+void UniPCDiscreteScheduler::execute_method(
     const float* predict_data_,
-    const float* samples_data_,
+    float* samples_data_,
     long data_size_,
     long step_index_,
     float random_intensity_
 ) {
     SD_UNUSED(random_intensity_);
 
+    // UniC: correct previous sample with current model output (from the 2nd step on);
     // predict_data_ is already the x0-prediction (converted by base with c_skip/c_out)
-    UniData curs_dnoised_(predict_data_, predict_data_ + data_size_);
-    UniData curs_samples_(samples_data_, samples_data_ + data_size_);
-    double lambda_s0 = lambda_at(scheduler_sigmas[size_t(step_index_)]);
-
-    // UniC: correct previous sample with current model output (from the 2nd step on)
     if (step_index_ > 0 && !history_dnoise.empty() && long(last_samples_.size()) == data_size_) {
-        curs_samples_ = get_unified_correction(curs_dnoised_, step_index_);
+        get_unified_correction(predict_data_, samples_data_, data_size_, step_index_);
     }
 
-    // UniPC: update history records, insert m0 & λ0 to records->front
+    // UniPC: update history records, insert m0 to records->front (recycles the oldest slot)
     {
-        history_dnoise.insert(history_dnoise.begin(), curs_dnoised_);
-        history_lambda.insert(history_lambda.begin(), lambda_s0);
-        long maintain_order_ = std::max(1L, long(scheduler_config.scheduler_maintain_cache));
-        while (long(history_dnoise.size()) > maintain_order_) {
-            history_dnoise.pop_back();
-            history_lambda.pop_back();
-        }
-        last_samples_ = curs_samples_;
+        float* curs_dnoised_ = history_dnoise.push(data_size_);
+        std::copy(predict_data_, predict_data_ + data_size_, curs_dnoised_);
+        last_samples_.assign(samples_data_, samples_data_ + data_size_);
     }
 
     // UniP: predict next sample from the corrected current state
-    return get_unified_prediction(curs_samples_, step_index_);
+    get_unified_prediction(samples_data_, data_size_, step_index_);
+}
+
+void UniPCDiscreteScheduler::save_history(StateWriter &writer_) const {
+    history_dnoise.save(writer_);
+    writer_.put(last_samples_);
+}
+
+void UniPCDiscreteScheduler::load_history(StateReader &reader_) {
+    history_dnoise.load(reader_);
+    reader_.get(last_samples_);
 }
 
 } // namespace scheduler
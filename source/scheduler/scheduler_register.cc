@@ -20,6 +20,7 @@
 #include "scheduler_discrete_pndm.cc"
 #include "scheduler_discrete_ipndm.cc"
 #include "scheduler_discrete_deis_m.cc"
+#include "scheduler_discrete_adaptive.cc"
 
 namespace onnx {
 namespace sd {
@@ -30,9 +31,52 @@ using namespace base;
 typedef SchedulerBase SchedulerEntity;
 typedef SchedulerBase* SchedulerEntity_ptr;
 
+struct SchedulerRecycler {
+    void operator()(SchedulerEntity_ptr target_ptr_) const;
+};
+// one run's scheduler, handed back to the pool when the lease ends (also on a throwing run)
+typedef std::unique_ptr<SchedulerEntity, SchedulerRecycler> SchedulerLease;
+
+/**
+ * Schedulers are pooled per config: recycle_scheduler() parks the instance with its
+ * training table still created, request_scheduler() hands it out again after reset()
+ * (new seed, first noise stream; the next init() rebinds its schedule from ScheduleCache),
+ * so a pool hit costs a map lookup instead of new + create(). Callers lease one per run.
+ */
 class SchedulerRegister {
-public:
-    static SchedulerEntity_ptr request_scheduler(const SchedulerConfig &scheduler_config_) {
+private:
+    // every config field that shapes a scheduler's tables or history, the seed is re-applied on reuse
+    typedef std::tuple<int, uint64_t, uint64_t, float, float, int, int, int, int, float> PoolKey;
+
+    static constexpr size_t SD_SCHEDULER_POOL_LIMIT = 8;   // idle instances kept per config
+
+    typedef struct SchedulerPool {
+        std::mutex pool_lock;
+        std::map<PoolKey, std::vector<SchedulerEntity_ptr>> idle_schedulers;
+
+        ~SchedulerPool() {
+            for (auto &idle_ : idle_schedulers) {
+                for (SchedulerEntity_ptr scheduler_ : idle_.second) delete scheduler_;
+            }
+        }
+    } SchedulerPool;
+
+    static SchedulerPool &pool() {
+        static SchedulerPool pool_;
+        return pool_;
+    }
+
+    static PoolKey key_of(const SchedulerConfig &config_) {
+        return PoolKey{
+            int(config_.scheduler_type), config_.scheduler_training_steps, config_.scheduler_maintain_cache,
+            config_.scheduler_beta_start, config_.scheduler_beta_end,
+            int(config_.scheduler_beta_type), int(config_.scheduler_alpha_type),
+            int(config_.scheduler_predict_type), int(config_.scheduler_sigma_type),
+            config_.scheduler_tolerance
+        };
+    }
+
+    static SchedulerEntity_ptr create_scheduler(const SchedulerConfig &scheduler_config_) {
         SchedulerEntity_ptr result_ptr_ = nullptr;
         switch (scheduler_config_.scheduler_type) {
             case SCHEDULER_EULER: {
@@ -91,6 +135,10 @@ public:
                 result_ptr_ = new DeisMDiscreteScheduler(scheduler_config_);
                 break;
             }
+            case SCHEDULER_ADAPTIVE: {
+                result_ptr_ = new AdaptiveDiscreteScheduler(scheduler_config_);
+                break;
+            }
             default:{
                 amon_report(class_exception(EXC_LOG_ERR, "ERROR:: selected Scheduler unimplemented"));
                 break;
@@ -102,7 +150,40 @@ public:
         return result_ptr_;
     }
 
+public:
+    static SchedulerEntity_ptr request_scheduler(const SchedulerConfig &scheduler_config_) {
+        SchedulerEntity_ptr result_ptr_ = nullptr;
+        {
+            SchedulerPool &pool_ = pool();
+            std::lock_guard<std::mutex> lock_(pool_.pool_lock);
+            auto found_ = pool_.idle_schedulers.find(key_of(scheduler_config_));
+            if (found_ != pool_.idle_schedulers.end() && !found_->second.empty()) {
+                result_ptr_ = found_->second.back();
+                found_->second.pop_back();
+            }
+        }
+        if (result_ptr_) {
+            result_ptr_->reset(scheduler_config_.scheduler_seed);
+            return result_ptr_;
+        }
+        return create_scheduler(scheduler_config_);
+    }
+
+    static SchedulerLease lease_scheduler(const SchedulerConfig &scheduler_config_) {
+        return SchedulerLease(request_scheduler(scheduler_config_));
+    }
+
     static SchedulerEntity_ptr recycle_scheduler(SchedulerEntity_ptr target_ptr_){
+        if (target_ptr_){
+            target_ptr_->uninit();
+            SchedulerPool &pool_ = pool();
+            std::lock_guard<std::mutex> lock_(pool_.pool_lock);
+            std::vector<SchedulerEntity_ptr> &idle_ = pool_.idle_schedulers[key_of(target_ptr_->config())];
+            if (idle_.size() < SD_SCHEDULER_POOL_LIMIT) {
+                idle_.push_back(target_ptr_);
+                return nullptr;
+            }
+        }
         if (target_ptr_){
             target_ptr_->release();
             delete target_ptr_;
@@ -111,6 +192,10 @@ public:
     }
 };
 
+inline void SchedulerRecycler::operator()(SchedulerEntity_ptr target_ptr_) const {
+    SchedulerRegister::recycle_scheduler(target_ptr_);
+}
+
 } // namespace scheduler
 } // namespace sd
 } // namespace onnx
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2018-2050 SD_Tokenizer Compiled Asset - Arikan.Li
+ * Created by Arikan.Li on 2026/10/19.
+ */
+#ifndef TOKENIZER_ASSET_H
+#define TOKENIZER_ASSET_H
+
+#include "onnxsd_foundation.cc"
+#include "tokenizer_vocab.cc"
+#include "tokenizer_bpe_tables.cc"
+
+namespace onnx {
+namespace sd {
+namespace tokenizer {
+
+using namespace base;
+using namespace amon;
+
+/**
+ * Compiled tokenizer asset (*.adtk): the sealed VocabTable and SymbolMergeTable arrays
+ * written as-is behind a small header, so loading is a memory map plus pointer setup.
+ * The mapping is shared by every tokenizer in the process (MappedFile::share) and its
+ * pages by every process using the same file.
+ *
+ * Layout, host byte order (a foreign-endian file fails the magic check):
+ *   AssetHeader | sections, each 16-byte aligned, in AssetSectionType order
+ * Only the header and the section bounds are validated on attach, the contents are
+ * trusted as written by compile().
+ */
+class TokenizerAsset {
+public:
+    static constexpr uint32_t SD_ASSET_MAGIC = 0x4B544441;      // "ADTK"
+    static constexpr uint32_t SD_ASSET_VERSION = 1;
+
+private:
+    enum AssetSectionType {
+        ASSET_VOCAB_BLOB = 0,
+        ASSET_VOCAB_ENTRIES,
+        ASSET_VOCAB_SLOTS,
+        ASSET_VOCAB_IDS,
+        ASSET_MERGE_SLOTS,
+        ASSET_BYTE_SYMBOLS,
+        ASSET_SYMBOL_TOKENS,
+        ASSET_SECTION_COUNT,
+    };
+
+    typedef struct AssetSection {
+        uint64_t offset;
+        uint64_t count;                         // elements, not bytes
+    } AssetSection;
+
+    typedef struct AssetHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t file_size;
+        uint64_t merge_count;
+        AssetSection sections[ASSET_SECTION_COUNT];
+    } AssetHeader;
+
+    static constexpr uint64_t SD_ASSET_ALIGN = 16;
+
+    template<typename T>
+    static const T *section_at(const AssetHeader &header_, const uint8_t *data_, AssetSectionType type_) {
+        const AssetSection &section_ = header_.sections[type_];
+        bool in_bounds_ = (section_.offset % SD_ASSET_ALIGN == 0) &&
+                          (section_.offset <= header_.file_size) &&
+                          (section_.count <= (header_.file_size - section_.offset) / sizeof(T));
+        return in_bounds_ ? reinterpret_cast<const T *>(data_ + section_.offset) : nullptr;
+    }
+
+    static bool power_of_two(uint64_t count_) {
+        return (count_ & (count_ - 1)) == 0;
+    }
+
+public:
+    /**
+     * @details Write sealed tables into a compiled asset
+     * @param vocab_ sealed vocabulary
+     * @param merges_ sealed merge table, empty for tokenizers without merges
+     * @param asset_path_ destination file
+     * @return false when the file cannot be written
+     */
+    static bool compile(const VocabTable &vocab_, const SymbolMergeTable &merges_, const std::string &asset_path_) {
+        const VocabTable::VocabView &vocab_view_ = vocab_.view();
+        const SymbolMergeTable::MergeView &merge_view_ = merges_.view();
+        bool has_merges_ = (merge_view_.merge_count > 0);
+
+        const std::pair<const void *, uint64_t> payloads_[ASSET_SECTION_COUNT] = {
+            {vocab_view_.blob, vocab_view_.blob_size},
+            {vocab_view_.entries, vocab_view_.entry_count},
+            {vocab_view_.slots, vocab_view_.slot_count},
+            {vocab_view_.ids, vocab_view_.id_count},
+            {merge_view_.slots, has_merges_ ? merge_view_.slot_count : 0},
+            {merge_view_.byte_symbols, has_merges_ ? 2 * 256 : 0},
+            {merge_view_.symbol_tokens, has_merges_ ? merge_view_.symbol_count : 0},
+        };
+        const uint64_t element_sizes_[ASSET_SECTION_COUNT] = {
+            sizeof(char), sizeof(VocabTable::VocabEntry), sizeof(uint32_t), sizeof(uint32_t),
+            sizeof(SymbolMergeTable::MergeSlot), sizeof(uint32_t), sizeof(int32_t)
+        };
+
+        AssetHeader header_{};
+        header_.magic = SD_ASSET_MAGIC;
+        header_.version = SD_ASSET_VERSION;
+        header_.merge_count = has_merges_ ? merge_view_.merge_count : 0;
+        uint64_t offset_ = sizeof(AssetHeader);
+        for (int i = 0; i < ASSET_SECTION_COUNT; ++i) {
+            offset_ = (offset_ + SD_ASSET_ALIGN - 1) / SD_ASSET_ALIGN * SD_ASSET_ALIGN;
+            header_.sections[i] = {offset_, payloads_[i].second};
+            offset_ += payloads_[i].second * element_sizes_[i];
+        }
+        header_.file_size = offset_;
+
+        std::ofstream file_(asset_path_, std::ios::binary);
+        if (!file_) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer asset not writable"));
+            return false;
+        }
+        file_.write(reinterpret_cast<const char *>(&header_), sizeof(AssetHeader));
+        const char padding_[SD_ASSET_ALIGN] = {};
+        for (int i = 0; i < ASSET_SECTION_COUNT; ++i) {
+            auto written_ = uint64_t(file_.tellp());
+            file_.write(padding_, std::streamsize(header_.sections[i].offset - written_));
+            if (payloads_[i].second > 0) {
+                file_.write(static_cast<const char *>(payloads_[i].first),
+                            std::streamsize(payloads_[i].second * element_sizes_[i]));
+            }
+        }
+        return bool(file_);
+    }
+
+    /**
+     * @details Map a compiled asset and point the tables at it, constant time
+     * @param asset_path_ compiled asset
+     * @param vocab_ attached vocabulary
+     * @param merges_ attached merge table, left empty when the asset has no merges
+     * @return false (tables untouched) when the file is missing or malformed
+     */
+    static bool attach(const std::string &asset_path_, VocabTable &vocab_, SymbolMergeTable &merges_) {
+        std::shared_ptr<const MappedFile> mapped_ = MappedFile::share(asset_path_);
+        if (!mapped_ || mapped_->size() < sizeof(AssetHeader)) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer asset not readable"));
+            return false;
+        }
+        AssetHeader header_{};
+        std::memcpy(&header_, mapped_->data(), sizeof(AssetHeader));
+        if (header_.magic != SD_ASSET_MAGIC || header_.version != SD_ASSET_VERSION ||
+            header_.file_size != mapped_->size()) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer asset has an unknown format"));
+            return false;
+        }
+
+        const uint8_t *data_ = mapped_->data();
+        VocabTable::VocabView vocab_view_ = {
+            section_at<char>(header_, data_, ASSET_VOCAB_BLOB), header_.sections[ASSET_VOCAB_BLOB].count,
+            section_at<VocabTable::VocabEntry>(header_, data_, ASSET_VOCAB_ENTRIES), header_.sections[ASSET_VOCAB_ENTRIES].count,
+            section_at<uint32_t>(header_, data_, ASSET_VOCAB_SLOTS), header_.sections[ASSET_VOCAB_SLOTS].count,
+            section_at<uint32_t>(header_, data_, ASSET_VOCAB_IDS), header_.sections[ASSET_VOCAB_IDS].count
+        };
+        SymbolMergeTable::MergeView merge_view_ = {
+            section_at<SymbolMergeTable::MergeSlot>(header_, data_, ASSET_MERGE_SLOTS), header_.sections[ASSET_MERGE_SLOTS].count,
+            header_.merge_count,
+            section_at<uint32_t>(header_, data_, ASSET_BYTE_SYMBOLS),
+            section_at<int32_t>(header_, data_, ASSET_SYMBOL_TOKENS), header_.sections[ASSET_SYMBOL_TOKENS].count
+        };
+
+        bool vocab_valid_ = vocab_view_.blob && vocab_view_.entries && vocab_view_.slots && vocab_view_.ids &&
+                            power_of_two(vocab_view_.slot_count);
+        bool merges_valid_ = (header_.merge_count == 0) || (
+            merge_view_.slots && merge_view_.byte_symbols && merge_view_.symbol_tokens &&
+            power_of_two(merge_view_.slot_count) && header_.merge_count <= merge_view_.slot_count / 2 &&
+            header_.sections[ASSET_BYTE_SYMBOLS].count == 2 * 256
+        );
+        if (!vocab_valid_ || !merges_valid_) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer asset sections out of bounds"));
+            return false;
+        }
+
+        vocab_.attach(vocab_view_, mapped_);
+        if (header_.merge_count > 0) {
+            merges_.attach(merge_view_, mapped_);
+        } else {
+            merges_.clear();
+        }
+        return true;
+    }
+};
+
+} // namespace tokenizer
+} // namespace sd
+} // namespace onnx
+
+#endif //TOKENIZER_ASSET_H
@@ -8,6 +8,11 @@
 #define TOKENIZER_BASE_H
 
 #include "onnxsd_foundation.cc"
+#include "tokenizer_vocab.cc"
+#include "tokenizer_bpe_tables.cc"
+#include "tokenizer_asset.cc"
+#include "tokenizer_prompt_scanner.cc"
+#include "tokenizer_wordpiece_trie.cc"
 #include "json.hpp"
 
 namespace onnx {
@@ -24,39 +29,34 @@ using namespace amon;
  */
 class TokenizerBase {
 public:
-    typedef std::pair<std::string, std::string> Subwords_pair;
-    typedef std::vector<std::pair<std::string, std::string>> SubwordsPair_vec;
     typedef std::vector<std::pair<std::string, float>> PromptWeight_map;
     typedef std::vector<std::pair<Tensor, Tensor>> PreparedToken_vec;
+
+    // B prompts in one contiguous buffer: tokens int32 / multis float, [B, chunks, avail_token_size].
+    // chunks is the longest prompt's chunk count, shorter prompts are filled up with
+    // unconditional rows (start, end, padding) so the whole buffer can go through one
+    // batched text encoder run; chunk_counts keeps each prompt's own chunk count
+    typedef struct PreparedBatch {
+        Tensor tokens = TensorHelper::empty<int32_t>();
+        Tensor multis = TensorHelper::empty<float>();
+        std::vector<size_t> chunk_counts;
+    } PreparedBatch;
     typedef std::vector<std::vector<float>> Embeddings_matrix;
     typedef std::vector<std::vector<float>> Positional_matrix;
 
 protected:
-    typedef std::map<std::pair<std::string, std::string>, int> Merge_Pair_dict;
-    typedef std::map<std::string, int> Token_2_ID_dict;
-    typedef std::map<int, std::string> ID_2_Token_dict;
     typedef std::vector<int32_t> Tokens;
     typedef std::vector<float> Multis;
 
 protected:
     TokenizerConfig sd_tokenizer_config;
-    Token_2_ID_dict sd_tokenizer_tok2id;
-    ID_2_Token_dict sd_tokenizer_id2tok;
-    Merge_Pair_dict sd_tokenizer_merges;
+    VocabTable sd_tokenizer_vocab;
+    int32_t sd_tokenizer_unknown_id = 0;        // id emitted for pieces missing from the vocabulary
+    SymbolMergeTable sd_tokenizer_merges;
     Embeddings_matrix embeddings_matrix;
     Positional_matrix positional_matrix;
 
     const std::string def_vocab_end = ",";
-    const std::regex def_split_reg = std::regex(
-        R"(<\|startoftext\|>|<\|endoftext\|>|'s|'t|'re|'ve|'m|'ll|'d|[a-zA-Z]+|\d|[^ \t\n\r\f\v\w]+)",
-        std::regex::icase
-    );
-    const std::regex re_focusing = std::regex(
-        R"(\\\(|\\\)|\\\[|\\\]|\\\\|\\|\(|\[|:([+-]?[.\d]+)\)|\)|\]|[^\\()\[\]:]+|:)"
-    );
-    const std::regex re_breaking = std::regex(
-        R"(\s*\bBREAK\b\s*)"
-    );
 
     bool sd_tokenizer_vocab_ready = false;
     bool sd_tokenizer_merge_ready = false;
@@ -114,7 +114,7 @@ protected:
      * @details get <|startoftext|> index in dictionary, set by config[tokenizer_dictionary_at]
      * @return <|startoftext|> index in dictionary
      */
-    int32_t get_start_token_index() const {
+    virtual int32_t get_start_token_index() const {
         return sd_tokenizer_config.avail_token_count - 2;
     }
 
@@ -122,7 +122,7 @@ protected:
      * @details get <|endoftext|> index in dictionary, set by config[tokenizer_dictionary_at]
      * @return <|endoftext|> index in dictionary
      */
-    int32_t get_end_token_index() const {
+    virtual int32_t get_end_token_index() const {
         return sd_tokenizer_config.avail_token_count - 1;
     }
 
@@ -133,7 +133,7 @@ protected:
      *    SDXL - Using simple Nan-Mark = 0 as pad_token_idx
      * @return padding token index in model setting
      */
-    int32_t get_pad_token_index() const {
+    virtual int32_t get_pad_token_index() const {
         return get_end_token_index();
     }
 
@@ -194,36 +194,64 @@ protected:
             }
         };
 
-        std::smatch regex_matcher_;
-        std::smatch regex_breaker_;
-        std::string remaining_text = prompts_;
-
-        while (std::regex_search(remaining_text, regex_matcher_, re_focusing)) {
-            std::string text   = regex_matcher_[0];
-            std::string weight = regex_matcher_[1];
+        std::vector<std::string_view> parts_;
+        auto push_text = [&](std::string_view text_) {
+            PromptScanner::split_breaks(text_, parts_);
+            for (size_t i = 0; i < parts_.size(); ++i) {
+                if (i > 0) { prompt_weight_.emplace_back("BREAK", -1.0f); }
+                prompt_weight_.emplace_back(std::string(parts_[i]), 1.0f);
+            }
+        };
 
-            if (text == "(") {
+        // one pass, same tokens as the A1111 pattern:
+        // \\\(|\\\)|\\\[|\\\]|\\\\|\\|\(|\[|:([+-]?[.\d]+)\)|\)|\]|[^\\()\[\]:]+|:
+        const std::string_view text_(prompts_);
+        size_t at_ = 0;
+        while (at_ < text_.size()) {
+            const char mark_ = text_[at_];
+            if (mark_ == '\\') {
+                bool escaped_ = (at_ + 1 < text_.size()) && (
+                    text_[at_ + 1] == '(' || text_[at_ + 1] == ')' || text_[at_ + 1] == '[' ||
+                    text_[at_ + 1] == ']' || text_[at_ + 1] == '\\'
+                );
+                push_text(text_.substr(escaped_ ? at_ + 1 : at_, 1));
+                at_ += escaped_ ? 2 : 1;
+            } else if (mark_ == '(') {
                 increase_list_.push_back((int)prompt_weight_.size());
-            } else if (text == "[") {
+                at_ += 1;
+            } else if (mark_ == '[') {
                 decrease_list_.push_back((int)prompt_weight_.size());
-            } else if (!weight.empty() && !increase_list_.empty()) {
-                multiply_range(increase_list_.back(), std::stof(weight));
-                increase_list_.pop_back();
-            } else if (text == ")" && !increase_list_.empty()) {
+                at_ += 1;
+            } else if (mark_ == ':') {
+                size_t weight_size_ = PromptScanner::match_weight(text_, at_);
+                std::string weight_(text_.substr(at_ + 1, weight_size_ ? weight_size_ - 2 : 0));
+                char *weight_end_ = nullptr;
+                float multiplier_ = std::strtof(weight_.c_str(), &weight_end_);
+                bool weighted_ = (weight_size_ > 0) && (weight_end_ != weight_.c_str());
+                if (weighted_ && !increase_list_.empty()) {
+                    multiply_range(increase_list_.back(), multiplier_);
+                    increase_list_.pop_back();
+                } else {
+                    push_text(text_.substr(at_, weight_size_ ? weight_size_ : 1));
+                }
+                at_ += weight_size_ ? weight_size_ : 1;
+            } else if (mark_ == ')' && !increase_list_.empty()) {
                 multiply_range(increase_list_.back(), sd_tokenizer_config.txt_attn_increase_factor);
                 increase_list_.pop_back();
-            } else if (text == "]" && !decrease_list_.empty()) {
+                at_ += 1;
+            } else if (mark_ == ']' && !decrease_list_.empty()) {
                 multiply_range(decrease_list_.back(), sd_tokenizer_config.txt_attn_decrease_factor);
                 decrease_list_.pop_back();
+                at_ += 1;
+            } else if (mark_ == ')' || mark_ == ']') {
+                push_text(text_.substr(at_, 1));
+                at_ += 1;
             } else {
-                std::vector<std::string> parts = PromptsHelper::split(text, re_breaking);
-                for (int i = 0; i < parts.size(); ++i) {
-                    if (i > 0) { prompt_weight_.emplace_back("BREAK", -1.0f); }
-                    prompt_weight_.emplace_back(parts[i], 1.0f);
-                }
+                size_t end_ = at_ + 1;
+                while (end_ < text_.size() && !PromptScanner::is_attention_mark(text_[end_])) ++end_;
+                push_text(text_.substr(at_, end_ - at_));
+                at_ = end_;
             }
-
-            remaining_text = regex_matcher_.suffix();
         }
 
         for (int pos : increase_list_) {
@@ -250,136 +278,153 @@ protected:
         return prompt_weight_;
     }
 
-protected:      // Subwiords Pairing logic (Common by file structure)
-    SubwordsPair_vec make_words_pair(const std::vector<std::string> &subwords_) {
-        SubwordsPair_vec paired_words_;
-        if (!subwords_.empty() && subwords_.size() > 1) {
-            std::string prev_subword_ = subwords_[0];
-            for (int i = 1; i < subwords_.size(); i++) {
-                std::string cur_subword_ = subwords_[i];
-                std::pair<std::string, std::string> pair(prev_subword_, cur_subword_);
-                paired_words_.emplace_back(pair);
-                prev_subword_ = cur_subword_;
-            }
-        }
-        return paired_words_;
-    }
-
-    Subwords_pair find_min_rank(const SubwordsPair_vec& current_pairs_) {
-        Subwords_pair min_pair = {"", ""};
-        if (!current_pairs_.empty()) {
-            int min_rank = (std::numeric_limits<int>::max)();
-            for (const auto &pair: current_pairs_) {
-                auto it = sd_tokenizer_merges.find(pair);
-                if (it != sd_tokenizer_merges.end() && it->second < min_rank) {
-                    min_rank = it->second;
-                    min_pair = pair;
-                }
-            }
-        }
-        return min_pair;
-    }
-
 protected:      // Dictionary reading & preparing logic
-    void load_vocab_json(const std::string &vocab_path_) {
+    bool load_vocab_json(const std::string &vocab_path_) {
         std::ifstream vocab_file(vocab_path_);
         if (!vocab_file) {
-            std::cerr << "Failed to open " << vocab_path_ << std::endl;
-            exit(1);
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer vocabulary not readable"));
+            return false;
         }
 
-        nlohmann::json json;
-        vocab_file >> json;
+        try {
+            nlohmann::json json;
+            vocab_file >> json;
 
-        for (auto it = json.begin(); it != json.end(); ++it) {
-            std::string str_key = it.key();
-            int int_idx = it.value().get<int>();
+            for (auto it = json.begin(); it != json.end(); ++it) {
+                std::string str_key = it.key();
+                int int_idx = it.value().get<int>();
 
-            str_key = PromptsHelper::replace(str_key, "\\u0120", " ");  // \u0120 -> space
-            str_key = PromptsHelper::replace(str_key, "\\u010a", "\n"); // \u010a -> new line
-            str_key = PromptsHelper::replace(str_key, "\\\"", "\"");    // \\\"   -> "
+                str_key = PromptsHelper::replace(str_key, "\\u0120", " ");  // \u0120 -> space
+                str_key = PromptsHelper::replace(str_key, "\\u010a", "\n"); // \u010a -> new line
+                str_key = PromptsHelper::replace(str_key, "\\\"", "\"");    // \\\"   -> "
 
-            sd_tokenizer_tok2id[str_key] = int_idx;
-            sd_tokenizer_id2tok[int_idx] = str_key;
+                sd_tokenizer_vocab.add(str_key, int_idx);
+            }
+        } catch (const nlohmann::json::exception &) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer vocabulary is not a json token map"));
+            return false;
         }
+        return true;
     }
 
-    void load_vocab_text(const std::string & vocab_path_) {
+    bool load_vocab_text(const std::string & vocab_path_) {
         std::ifstream vocab_file;
         vocab_file.open(vocab_path_);
+        if (!vocab_file) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer vocabulary not readable"));
+            return false;
+        }
         std::string vocab;
         int idx = 0;
         while (getline(vocab_file, vocab)) {
-            sd_tokenizer_tok2id.insert(std::pair<std::string, int>(vocab, idx));
-            sd_tokenizer_id2tok.insert(std::pair<int, std::string>(idx, vocab));
+            if (!vocab.empty() && vocab.back() == '\r') vocab.pop_back();    // CRLF vocab.txt
+            sd_tokenizer_vocab.add(vocab, idx);
             idx++;
         }
         vocab_file.close();
+        return true;
     }
 
-    void load_merge_json(const std::string &merges_path_) {
+    bool load_merge_json(const std::string &merges_path_) {
         std::ifstream merge_file(merges_path_);
         if (!merge_file) {
-            std::cerr << "Failed to open " << merges_path_ << std::endl;
-            exit(1);
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer merges not readable"));
+            return false;
         }
 
-        nlohmann::json json;
-        merge_file >> json;
+        try {
+            nlohmann::json json;
+            merge_file >> json;
 
-        for (auto it = json.begin(); it != json.end(); ++it) {
-            std::string str_key = it.key();
-            int int_rank = it.value().get<int>();
+            for (auto it = json.begin(); it != json.end(); ++it) {
+                std::string str_key = it.key();
+                int int_rank = it.value().get<int>();
 
-            str_key = PromptsHelper::replace(str_key, "\\u0120", " ");  // \u0120 -> space
-            str_key = PromptsHelper::replace(str_key, "\\u010a", "\n"); // \u010a -> new line
-            str_key = PromptsHelper::replace(str_key, "\\\"", "\"");    // \\\"   -> "
+                str_key = PromptsHelper::replace(str_key, "\\u0120", " ");  // \u0120 -> space
+                str_key = PromptsHelper::replace(str_key, "\\u010a", "\n"); // \u010a -> new line
+                str_key = PromptsHelper::replace(str_key, "\\\"", "\"");    // \\\"   -> "
 
-            std::istringstream iss(str_key);
-            std::string first, second;
-            iss >> first >> second;
+                std::istringstream iss(str_key);
+                std::string first, second;
+                iss >> first >> second;
+                if (first.empty() || second.empty()) continue;
 
-            sd_tokenizer_merges[make_pair(first, second)] = int_rank;
+                sd_tokenizer_merges.add_merge(first, second, uint32_t(int_rank));
+            }
+        } catch (const nlohmann::json::exception &) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer merges are not a json rank map"));
+            return false;
         }
+        return true;
     }
 
-    void load_merge_text(const std::string& merges_path_) {
+    bool load_merge_text(const std::string& merges_path_) {
         std::ifstream merge_file;
         merge_file.open(merges_path_);
+        if (!merge_file) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer merges not readable"));
+            return false;
+        }
         std::string line;
-        int rank = 0;   // first line always is "#version: xxx"
+        uint32_t rank = 0;
         while (std::getline(merge_file, line)) {
+            if (line.rfind("#version", 0) == 0) continue;   // header line, not a merge
             std::istringstream iss(line);
             std::string first, second;
             iss >> first >> second;
-            sd_tokenizer_merges[make_pair(first, second)] = rank;
+            if (first.empty() || second.empty()) continue;
+            sd_tokenizer_merges.add_merge(first, second, rank);
             rank++;
         }
         merge_file.close();
+        return true;
     }
 
     void load_vocab_file(const std::string& vocab_path_){
-        if (PromptsHelper::has_extension(vocab_path_, ".json")) {
-            load_vocab_json(vocab_path_);
-            sd_tokenizer_vocab_ready = true;
+        sd_tokenizer_vocab.clear();
+        if (PromptsHelper::has_extension(vocab_path_, ".adtk")) {
+            // compiled asset: vocabulary and merges are mapped as built, nothing to parse
+            sd_tokenizer_vocab_ready = TokenizerAsset::attach(vocab_path_, sd_tokenizer_vocab, sd_tokenizer_merges);
+            sd_tokenizer_merge_ready = sd_tokenizer_vocab_ready && !sd_tokenizer_merges.empty();
+            return;
+        } else if (PromptsHelper::has_extension(vocab_path_, ".json")) {
+            sd_tokenizer_vocab_ready = load_vocab_json(vocab_path_);
         } else if (PromptsHelper::has_extension(vocab_path_, ".txt")) {
-            load_vocab_text(vocab_path_);
-            sd_tokenizer_vocab_ready = true;
+            sd_tokenizer_vocab_ready = load_vocab_text(vocab_path_);
         } else {
             sd_tokenizer_vocab_ready = false;
         }
+        sd_tokenizer_vocab.seal();
+        if (sd_tokenizer_vocab_ready && sd_tokenizer_vocab.empty()) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer vocabulary has no entries"));
+            sd_tokenizer_vocab_ready = false;
+        }
+    }
+
+    /**
+     * @details Unknown-token policy: pieces missing from the vocabulary map to unknown_
+     *          when the vocabulary has it, otherwise to id 0
+     * @param unknown_ unknown token text, "<|endoftext|>" for CLIP BPE, "[UNK]" for WordPiece
+     */
+    void bind_unknown_token(std::string_view unknown_) {
+        sd_tokenizer_unknown_id = sd_tokenizer_vocab.find_or(unknown_, {}, 0);
     }
 
     void load_merge_file(const std::string& merges_path_){
+        sd_tokenizer_merges.clear();
         if (PromptsHelper::has_extension(merges_path_, ".json")) {
-            load_merge_json(merges_path_);
-            sd_tokenizer_merge_ready = true;
+            sd_tokenizer_merge_ready = load_merge_json(merges_path_);
         } else if (PromptsHelper::has_extension(merges_path_, ".txt")) {
-            load_merge_text(merges_path_);
-            sd_tokenizer_merge_ready = true;
+            sd_tokenizer_merge_ready = load_merge_text(merges_path_);
         } else {
             sd_tokenizer_merge_ready = false;
         }
+        // merge results resolve to vocab ids once, encoding never touches strings again
+        sd_tokenizer_merges.seal(sd_tokenizer_vocab);
+        if (sd_tokenizer_merge_ready && sd_tokenizer_merges.empty()) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer merges have no entries"));
+            sd_tokenizer_merge_ready = false;
+        }
     }
 
 private:        // WARNING: Test ONLY! Currently abandoned!
@@ -442,16 +487,34 @@ private:        // WARNING: Test ONLY! Currently abandoned!
 
 protected:
     virtual std::tuple<Tokens, Multis, size_t> encode(PromptWeight_map prompt_weight_) = 0;
+    // everything encode() needs is loaded, BPE also needs its merges
+    virtual bool dictionary_ready() const { return sd_tokenizer_vocab_ready; }
+
+    // shared body of encode(): lowercases each fragment, splits it with split_(text, words),
+    // turns every word into ids with word_(word, tokens) and packs them into avail_token_size
+    // chunks. A chunk boundary landing at most token_safe_gaps_ tokens after the last ","
+    // moves back behind it, the gap and the tail are filled with pad_id_.
+    template<class Split, class Word>
+    std::tuple<Tokens, Multis, size_t> pack_chunks(
+        const PromptWeight_map &prompt_weight_, int32_t pad_id_, int token_safe_gaps_, Split split_, Word word_
+    ) const;
+
+    // one [avail_token_size] row: start mark, avail_token_size - 2 encoded tokens, end mark
+    void write_chunk(const int32_t *tokens_, const float *multis_, int32_t *token_row_, float *multi_row_) const;
+    // one [avail_token_size] row of the empty prompt: start, end, padding
+    void write_unconditional(int32_t *token_row_, float *multi_row_) const;
 
 public:
     explicit TokenizerBase(const TokenizerConfig &config_ = DEFAULT_TOKENIZER_CONFIG) : sd_tokenizer_config(config_) {};
-    virtual ~TokenizerBase() { sd_tokenizer_config.~TokenizerConfig();};
+    virtual ~TokenizerBase() = default;
 
     void create();
     virtual void init() = 0;
     PreparedToken_vec tokenize(const std::string &prompts_);
+    PreparedBatch tokenize_batch(const std::vector<std::string> &prompts_);
     Tensor embedding(const Tensor &token_p_,const Tensor &token_n_);
     std::string untokenize(const std::pair<Tensor, Tensor> &tpair_);
+    bool compile(const std::string &asset_path_) const;
     virtual void uninit() = 0;
     void release();
 };
@@ -459,64 +522,176 @@ public:
 void TokenizerBase::create() {
 }
 
+template<class Split, class Word>
+std::tuple<TokenizerBase::Tokens, TokenizerBase::Multis, size_t> TokenizerBase::pack_chunks(
+    const PromptWeight_map &prompt_weight_, int32_t pad_id_, int token_safe_gaps_, Split split_, Word word_
+) const {
+    const float token_end_multi_ = get_boundary_factor();
+    const int avail_ = get_avail_token_size();      // limit of current token_size 75
+
+    Tokens remade_tokens;
+    Multis remade_multis;
+
+    size_t pair_count_ = 1;
+    int last_vocab_at_ = -1;
+    Tokens word_tokens_;
+    std::vector<std::string> vocab_list_;
+    for (const auto &concise_: prompt_weight_) {
+
+        // both vocabularies are lowercase only
+        std::string lowered_ = concise_.first;
+        std::transform(lowered_.begin(), lowered_.end(), lowered_.begin(), [](char c) {
+            return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+        });
+
+        vocab_list_.clear();
+        split_(lowered_, vocab_list_);
+        for (const std::string& vocab_: vocab_list_) {
+            word_tokens_.clear();
+            word_(vocab_, word_tokens_);
+
+            for (int32_t token_: word_tokens_) {
+                bool reach_space_mark_ = (vocab_ == def_vocab_end);
+                bool needs_split_last_ = ((remade_tokens.size() % avail_ == 0) && (last_vocab_at_ != -1) &&
+                                          (remade_tokens.size() - last_vocab_at_ <= token_safe_gaps_));
+                if (reach_space_mark_) {
+                    last_vocab_at_ = int(remade_tokens.size());
+                } else if (needs_split_last_) {
+                    last_vocab_at_ += 1;
+                    Tokens tokens_cache_(remade_tokens.begin() + last_vocab_at_, remade_tokens.end());
+                    Multis multis_cache_(remade_multis.begin() + last_vocab_at_, remade_multis.end());
+
+                    // do split token with last reach max length
+                    remade_tokens.resize(last_vocab_at_);
+                    remade_multis.resize(last_vocab_at_);
+                    int token_end_ = int(ceil(float(remade_tokens.size()) / float(avail_)) * avail_ - remade_tokens.size());
+                    remade_tokens.insert(remade_tokens.end(), token_end_, pad_id_);
+                    remade_multis.insert(remade_multis.end(), token_end_, token_end_multi_);
+
+                    remade_tokens.insert(remade_tokens.end(), tokens_cache_.begin(), tokens_cache_.end());
+                    remade_multis.insert(remade_multis.end(), multis_cache_.begin(), multis_cache_.end());
+                    pair_count_ += 1;
+                }
+
+                remade_tokens.push_back(token_);
+                remade_multis.push_back(concise_.second);
+            }
+        }
+    }
+
+    int finish_at_ = int(ceil(remade_tokens.size() / float(avail_)) * avail_ - remade_tokens.size());
+    remade_tokens.insert(remade_tokens.end(), finish_at_, pad_id_);
+    remade_multis.insert(remade_multis.end(), finish_at_, token_end_multi_);
+
+    return {remade_tokens, remade_multis, pair_count_};
+}
+
+void TokenizerBase::write_unconditional(int32_t *token_row_, float *multi_row_) const {
+    token_row_[0] = get_start_token_index();
+    token_row_[1] = get_end_token_index();
+    std::fill(token_row_ + 2, token_row_ + sd_tokenizer_config.avail_token_size, get_pad_token_index());
+    std::fill(multi_row_, multi_row_ + sd_tokenizer_config.avail_token_size, get_boundary_factor());
+}
+
+void TokenizerBase::write_chunk(const int32_t *tokens_, const float *multis_, int32_t *token_row_, float *multi_row_) const {
+    const int avail_token_size_ = get_avail_token_size();
+    token_row_[0] = get_start_token_index();
+    multi_row_[0] = get_boundary_factor();
+    std::copy(tokens_, tokens_ + avail_token_size_, token_row_ + 1);
+    std::copy(multis_, multis_ + avail_token_size_, multi_row_ + 1);
+    token_row_[avail_token_size_ + 1] = get_end_token_index();
+    multi_row_[avail_token_size_ + 1] = get_boundary_factor();
+}
+
 TokenizerBase::PreparedToken_vec TokenizerBase::tokenize(const std::string& prompts_) {
 
     PreparedToken_vec matched_results_;
+    TensorShape paired_shape_ = {1, sd_tokenizer_config.avail_token_size};
 
     bool need_uncond_manual = prompts_.empty();
     if (need_uncond_manual) {
         // manual make uncondtational <token_idx, weight>
-        TensorShape paired_shape_ = {1, sd_tokenizer_config.avail_token_size};
-        Tokens tokens_cache_(sd_tokenizer_config.avail_token_size);
-        Multis multis_cache_(sd_tokenizer_config.avail_token_size);
-        {
-            tokens_cache_[0] = get_start_token_index();
-            tokens_cache_[1] = get_end_token_index();
-            multis_cache_[0] = get_boundary_factor();
-            multis_cache_[1] = get_boundary_factor();
-            for (int i = 2; i < sd_tokenizer_config.avail_token_size; ++i) {
-                tokens_cache_[i] = get_pad_token_index();
-                multis_cache_[i] = get_boundary_factor();
-            }
-        }
-        Tensor token_tensor = TensorHelper::create<int32_t>(paired_shape_, tokens_cache_);
-        Tensor multi_tensor = TensorHelper::create<float>(paired_shape_, multis_cache_);
+        Tensor token_tensor = TensorHelper::allocate<int32_t>(paired_shape_);
+        Tensor multi_tensor = TensorHelper::allocate<float>(paired_shape_);
+        write_unconditional(token_tensor.GetTensorMutableData<int32_t>(), multi_tensor.GetTensorMutableData<float>());
         matched_results_.emplace_back(std::move(token_tensor), std::move(multi_tensor));
     } else {
         // parsing input prompts to get <token_idx, weight>
         PromptWeight_map cur_parsed_attention = parse_prompt_attention(prompts_);
         std::tuple<Tokens, Multis, size_t> encoded_input = encode(cur_parsed_attention);     // {tokens, weights}
 
-        Tokens encoded_tokens_ = std::get<0>(encoded_input);
-        Multis encoded_multis_ = std::get<1>(encoded_input);
+        const Tokens &encoded_tokens_ = std::get<0>(encoded_input);
+        const Multis &encoded_multis_ = std::get<1>(encoded_input);
         size_t encoded_pair_num = std::get<2>(encoded_input);
         const int avail_token_size_ = get_avail_token_size();      // limit of current token_size
 
-        auto encoded_token_index_ = encoded_tokens_.begin();
-        auto encoded_multi_index_ = encoded_multis_.begin();
         for (int i = 0; i < encoded_pair_num; ++i) {
-            Tokens tokens_cache_(encoded_token_index_, encoded_token_index_ + avail_token_size_);
-            Multis multis_cache_(encoded_multi_index_, encoded_multi_index_ + avail_token_size_);
-            tokens_cache_.insert(tokens_cache_.begin(), get_start_token_index());
-            multis_cache_.insert(multis_cache_.begin(), get_boundary_factor());
-            tokens_cache_.push_back(get_end_token_index());
-            multis_cache_.push_back(get_boundary_factor());
-
-            TensorShape paired_shape_ = {1, sd_tokenizer_config.avail_token_size};
-            Tensor token_tensor = TensorHelper::create<int32_t>(paired_shape_, tokens_cache_);
-            Tensor multi_tensor = TensorHelper::create<float>(paired_shape_, multis_cache_);
+            Tensor token_tensor = TensorHelper::allocate<int32_t>(paired_shape_);
+            Tensor multi_tensor = TensorHelper::allocate<float>(paired_shape_);
+            write_chunk(
+                encoded_tokens_.data() + size_t(i) * avail_token_size_, encoded_multis_.data() + size_t(i) * avail_token_size_,
+                token_tensor.GetTensorMutableData<int32_t>(), multi_tensor.GetTensorMutableData<float>()
+            );
             matched_results_.emplace_back(std::move(token_tensor), std::move(multi_tensor));
 
             check_tensor_range(matched_results_.back().first, -49408, 49407);
-
-            encoded_token_index_= encoded_token_index_ + avail_token_size_;
-            encoded_multi_index_= encoded_multi_index_ + avail_token_size_;
         }
     }
 
     return matched_results_;
 }
 
+TokenizerBase::PreparedBatch TokenizerBase::tokenize_batch(const std::vector<std::string> &prompts_) {
+    const long batch_size_ = long(prompts_.size());
+    const int avail_token_size_ = get_avail_token_size();
+
+    // encode every prompt on the work pool, tables are read-only and encode keeps its state local
+    std::vector<std::tuple<Tokens, Multis, size_t>> encoded_inputs_(prompts_.size());
+    ParallelHelper::parallel_for(batch_size_, [&](long begin_, long end_) {
+        for (long b = begin_; b < end_; ++b) {
+            if (prompts_[b].empty()) continue;                      // unconditional, 0 chunks encoded
+            encoded_inputs_[b] = encode(parse_prompt_attention(prompts_[b]));
+        }
+    }, 1);
+
+    PreparedBatch batch_;
+    batch_.chunk_counts.resize(prompts_.size());
+    size_t chunk_count_ = 1;
+    for (long b = 0; b < batch_size_; ++b) {
+        batch_.chunk_counts[b] = std::max<size_t>(1, std::get<2>(encoded_inputs_[b]));
+        chunk_count_ = std::max(chunk_count_, batch_.chunk_counts[b]);
+    }
+
+    TensorShape batch_shape_ = {batch_size_, long(chunk_count_), sd_tokenizer_config.avail_token_size};
+    batch_.tokens = TensorHelper::allocate<int32_t>(batch_shape_);
+    batch_.multis = TensorHelper::allocate<float>(batch_shape_);
+    int32_t *token_data_ = batch_.tokens.GetTensorMutableData<int32_t>();
+    float *multi_data_ = batch_.multis.GetTensorMutableData<float>();
+
+    // row (b, c) holds chunk c of prompt b, rows past a prompt's own chunks are unconditional
+    const long row_count_ = batch_size_ * long(chunk_count_);
+    const long row_grain_ = std::max<long>(1, ParallelHelper::SD_PARALLEL_GRAIN / sd_tokenizer_config.avail_token_size);
+    ParallelHelper::parallel_for(row_count_, [&](long begin_, long end_) {
+        for (long r = begin_; r < end_; ++r) {
+            const size_t b = size_t(r) / chunk_count_;
+            const size_t c = size_t(r) % chunk_count_;
+            int32_t *token_row_ = token_data_ + r * sd_tokenizer_config.avail_token_size;
+            float *multi_row_ = multi_data_ + r * sd_tokenizer_config.avail_token_size;
+            if (c < std::get<2>(encoded_inputs_[b])) {
+                const size_t offset_ = c * avail_token_size_;
+                write_chunk(
+                    std::get<0>(encoded_inputs_[b]).data() + offset_, std::get<1>(encoded_inputs_[b]).data() + offset_,
+                    token_row_, multi_row_
+                );
+            } else {
+                write_unconditional(token_row_, multi_row_);
+            }
+        }
+    }, row_grain_);
+
+    return batch_;
+}
+
 Tensor TokenizerBase::embedding(const Tensor &token_p_, const Tensor &token_n_) {
     Tensor encoded_token_ = TensorHelper::clone<float>(token_p_);
     Tensor unconditional_ = TensorHelper::clone<float>(token_n_);
@@ -540,9 +715,16 @@ std::string TokenizerBase::untokenize(const  std::pair<Tensor, Tensor>& tpair_)
     return "";
 }
 
+bool TokenizerBase::compile(const std::string &asset_path_) const {
+    if (!dictionary_ready()) {
+        amon_report(class_exception(EXC_LOG_ERR, "ERROR:: tokenizer dictionary not loaded, nothing to compile"));
+        return false;
+    }
+    return TokenizerAsset::compile(sd_tokenizer_vocab, sd_tokenizer_merges, asset_path_);
+}
+
 void TokenizerBase::release() {
-    sd_tokenizer_tok2id.clear();
-    sd_tokenizer_id2tok.clear();
+    sd_tokenizer_vocab.clear();
     sd_tokenizer_merges.clear();
     embeddings_matrix.clear();
     positional_matrix.clear();
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2018-2050 SD_Tokenizer BPE Tables - Arikan.Li
+ * Created by Arikan.Li on 2026/10/19.
+ */
+#ifndef TOKENIZER_BPE_TABLES_H
+#define TOKENIZER_BPE_TABLES_H
+
+#include "onnxsd_foundation.cc"
+#include "tokenizer_vocab.cc"
+
+namespace onnx {
+namespace sd {
+namespace tokenizer {
+
+using namespace base;
+using namespace amon;
+
+/**
+ * BPE merge ranks over interned symbols. Every symbol that can appear while merging
+ * (the 2 x 256 byte symbols and every merge result) gets a dense id, ranks live in a
+ * flat open-addressing table keyed by the (left, right) id pair: one probe per
+ * candidate pair instead of a string-pair map lookup. seal() resolves every symbol
+ * to its vocab id; encoding reads only the sealed arrays (MergeView), which may
+ * also live inside a compiled asset.
+ */
+class SymbolMergeTable {
+public:
+    static constexpr uint32_t SD_SYMBOL_NONE = 0xFFFFFFFFu;
+
+    typedef struct MergeRule {
+        uint32_t rank;                          // lower merges first
+        uint32_t merged;                        // symbol id of left + right
+    } MergeRule;
+
+    static constexpr uint64_t SD_SLOT_EMPTY = ~uint64_t(0);
+
+    typedef struct MergeSlot {
+        uint64_t key = SD_SLOT_EMPTY;
+        MergeRule rule = {0, SD_SYMBOL_NONE};
+    } MergeSlot;
+
+    // the sealed arrays encoding reads, owned or inside a mapped asset
+    typedef struct MergeView {
+        const MergeSlot *slots = nullptr;       // power-of-two capacity, load <= 1/2
+        size_t slot_count = 0;
+        size_t merge_count = 0;
+        const uint32_t *byte_symbols = nullptr; // 2 x 256: [0] inside a word, [1] word end ("</w>")
+        const int32_t *symbol_tokens = nullptr; // symbol id -> vocab id, SD_TOKEN_NONE when missing
+        size_t symbol_count = 0;
+    } MergeView;
+
+private:
+    std::unordered_map<std::string, uint32_t> symbol_ids;
+    std::vector<std::string> symbol_names;
+    std::vector<MergeSlot> merge_slots;
+    size_t merge_count = 0;
+    uint32_t byte_symbols[2][256] = {};
+    std::vector<int32_t> symbol_tokens;
+    MergeView merge_view;
+    std::shared_ptr<const void> merge_backing;  // keeps an attached asset mapped
+
+    static uint64_t key_of(uint32_t left_, uint32_t right_) {
+        return (uint64_t(left_) << 32) | uint64_t(right_);
+    }
+
+    static uint64_t hash_of(uint64_t key_) {    // splitmix64 finalizer
+        key_ ^= key_ >> 30; key_ *= 0xBF58476D1CE4E5B9ull;
+        key_ ^= key_ >> 27; key_ *= 0x94D049BB133111EBull;
+        return key_ ^ (key_ >> 31);
+    }
+
+    void grow() {
+        std::vector<MergeSlot> old_slots_ = std::move(merge_slots);
+        merge_slots.assign(std::max<size_t>(1024, old_slots_.size() * 2), MergeSlot{});
+        for (const MergeSlot &slot_ : old_slots_) {
+            if (slot_.key != SD_SLOT_EMPTY) place(slot_.key, slot_.rule);
+        }
+    }
+
+    static const MergeSlot *probe(const MergeSlot *slots_, size_t slot_count_, uint64_t key_) {
+        if (slot_count_ == 0) return nullptr;
+        size_t mask_ = slot_count_ - 1;
+        for (size_t at_ = hash_of(key_) & mask_;; at_ = (at_ + 1) & mask_) {
+            if (slots_[at_].key == key_) return &slots_[at_];
+            if (slots_[at_].key == SD_SLOT_EMPTY) return nullptr;
+        }
+    }
+
+    void place(uint64_t key_, MergeRule rule_) {
+        size_t mask_ = merge_slots.size() - 1;
+        for (size_t at_ = hash_of(key_) & mask_;; at_ = (at_ + 1) & mask_) {
+            if (merge_slots[at_].key == SD_SLOT_EMPTY) {
+                merge_slots[at_] = {key_, rule_};
+                return;
+            }
+        }
+    }
+
+public:
+    /**
+     * GPT-2 / CLIP byte-level alphabet: printable latin-1 bytes map to themselves,
+     * the rest to U+0100 onwards, each returned as UTF-8
+     */
+    static const std::array<std::string, 256> &byte_alphabet() {
+        static const std::array<std::string, 256> alphabet_ = [] {
+            std::array<std::string, 256> result_;
+            uint32_t shifted_ = 0;
+            for (uint32_t b = 0; b < 256; ++b) {
+                bool printable_ = (b >= 0x21 && b <= 0x7E) || (b >= 0xA1 && b <= 0xAC) || (b >= 0xAE);
+                uint32_t code_ = printable_ ? b : 256 + shifted_++;
+                std::string utf8_;
+                if (code_ < 0x80) {
+                    utf8_ += char(code_);
+                } else {
+                    utf8_ += char(0xC0 | (code_ >> 6));
+                    utf8_ += char(0x80 | (code_ & 0x3F));
+                }
+                result_[b] = utf8_;
+            }
+            return result_;
+        }();
+        return alphabet_;
+    }
+
+    SymbolMergeTable() {
+        clear();
+    }
+
+    uint32_t intern(const std::string &symbol_) {
+        auto found_ = symbol_ids.find(symbol_);
+        if (found_ != symbol_ids.end()) return found_->second;
+        auto id_ = uint32_t(symbol_names.size());
+        symbol_ids.emplace(symbol_, id_);
+        symbol_names.push_back(symbol_);
+        return id_;
+    }
+
+    uint32_t find_symbol(const std::string &symbol_) const {
+        auto found_ = symbol_ids.find(symbol_);
+        return (found_ != symbol_ids.end()) ? found_->second : SD_SYMBOL_NONE;
+    }
+
+    const std::string &symbol(uint32_t symbol_id_) const { return symbol_names[symbol_id_]; }
+
+    // a pair listed twice keeps its first (lowest) rank, as the reference tokenizers do
+    void add_merge(const std::string &left_, const std::string &right_, uint32_t rank_) {
+        uint32_t left_id_ = intern(left_);
+        uint32_t right_id_ = intern(right_);
+        if (probe(merge_slots.data(), merge_slots.size(), key_of(left_id_, right_id_))) return;
+        uint32_t merged_id_ = intern(left_ + right_);
+        if ((merge_count + 1) * 2 > merge_slots.size()) grow();
+        place(key_of(left_id_, right_id_), {rank_, merged_id_});
+        merge_count++;
+    }
+
+    // resolves every symbol against the vocabulary and publishes the sealed view
+    void seal(const VocabTable &vocab_) {
+        symbol_tokens.resize(symbol_names.size());
+        for (size_t i = 0; i < symbol_names.size(); ++i) {
+            symbol_tokens[i] = vocab_.find(symbol_names[i]);
+        }
+        merge_view = {
+            merge_slots.data(), merge_slots.size(), merge_count,
+            &byte_symbols[0][0], symbol_tokens.data(), symbol_tokens.size()
+        };
+    }
+
+    // serve lookups from arrays owned by backing_ (a mapped asset), sealed as by seal()
+    void attach(const MergeView &view_, std::shared_ptr<const void> backing_) {
+        clear();
+        merge_view = view_;
+        merge_backing = std::move(backing_);
+    }
+
+    const MergeView &view() const { return merge_view; }
+
+    const MergeRule *find_merge(uint32_t left_, uint32_t right_) const {
+        const MergeSlot *slot_ = probe(merge_view.slots, merge_view.slot_count, key_of(left_, right_));
+        return slot_ ? &slot_->rule : nullptr;
+    }
+
+    uint32_t byte_symbol(uint8_t byte_, bool word_end_) const {
+        return merge_view.byte_symbols[(word_end_ ? 256 : 0) + byte_];
+    }
+
+    int32_t symbol_token(uint32_t symbol_id_) const {
+        return (symbol_id_ < merge_view.symbol_count) ? merge_view.symbol_tokens[symbol_id_] : VocabTable::SD_TOKEN_NONE;
+    }
+
+    size_t size() const { return merge_view.merge_count; }
+    bool empty() const { return merge_view.merge_count == 0; }
+
+    // drops every merge and symbol, only the byte symbols stay interned
+    void clear() {
+        merge_slots.clear();
+        merge_count = 0;
+        symbol_ids.clear();
+        symbol_names.clear();
+        symbol_tokens.clear();
+        merge_view = {};
+        merge_backing.reset();
+        const auto &alphabet_ = byte_alphabet();
+        for (uint32_t b = 0; b < 256; ++b) {
+            byte_symbols[0][b] = intern(alphabet_[b]);
+            byte_symbols[1][b] = intern(alphabet_[b] + "</w>");
+        }
+    }
+};
+
+/**
+ * LRU cache of word -> token ids. Prompts repeat the same words across requests,
+ * a hit skips byte mapping and merging entirely. Guarded by its own lock so
+ * tokenizers can be shared between threads.
+ */
+class WordTokenCache {
+private:
+    typedef std::list<std::pair<std::string, std::vector<int32_t>>> Entry_list;
+
+    mutable std::mutex cache_lock;
+    Entry_list cache_entries;                   // most recent first
+    std::unordered_map<std::string, Entry_list::iterator> cache_index;
+    size_t cache_capacity;
+
+public:
+    explicit WordTokenCache(size_t capacity_ = 8192) : cache_capacity(capacity_) {}
+
+    bool find(const std::string &word_, std::vector<int32_t> &tokens_) {
+        std::lock_guard<std::mutex> lock_(cache_lock);
+        auto found_ = cache_index.find(word_);
+        if (found_ == cache_index.end()) return false;
+        cache_entries.splice(cache_entries.begin(), cache_entries, found_->second);
+        tokens_.insert(tokens_.end(), found_->second->second.begin(), found_->second->second.end());
+        return true;
+    }
+
+    void insert(const std::string &word_, const int32_t *tokens_, size_t count_) {
+        std::lock_guard<std::mutex> lock_(cache_lock);
+        if (cache_capacity == 0 || cache_index.count(word_)) return;
+        cache_entries.emplace_front(word_, std::vector<int32_t>(tokens_, tokens_ + count_));
+        cache_index.emplace(word_, cache_entries.begin());
+        if (cache_entries.size() > cache_capacity) {
+            cache_index.erase(cache_entries.back().first);
+            cache_entries.pop_back();
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock_(cache_lock);
+        cache_entries.clear();
+        cache_index.clear();
+    }
+};
+
+} // namespace tokenizer
+} // namespace sd
+} // namespace onnx
+
+#endif //TOKENIZER_BPE_TABLES_H
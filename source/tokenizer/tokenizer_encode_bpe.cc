@@ -13,109 +13,93 @@ namespace tokenizer {
 
 class BPETokenizer : public TokenizerBase {
 protected:
-    std::string bep_pair_merge(const std::string &sentence_) {
-        // before split sentence to words, we need do BPE first, that means do Merge First.
-        // but first we need to check if merges.txt exist
-        if (!sd_tokenizer_merge_ready) return sentence_;
-
-        // step.1: cut sentence to chars, careful about space
-        std::vector<std::string> char_list_(sentence_.size());
-        std::transform(sentence_.begin(), sentence_.end(), char_list_.begin(), [](char c) {
-            return std::string(1, c);
-        });
-
-        // step.2: search from bep_ranking_maps, found ranked byte(char)_pair and do merge for new one, update
-        SubwordsPair_vec current_pairs_ = make_words_pair(char_list_);
-        Subwords_pair minimum_pair = find_min_rank(current_pairs_);
-
-        while (!(current_pairs_.empty()) &&
-               !(minimum_pair.first.empty() && minimum_pair.second.empty())) {
-            {
-                std::vector<std::string> new_word;
-                for (size_t i = 0; i < char_list_.size(); ++i) {
-                    bool need_merge_ = (
-                        i < char_list_.size() - 1 &&
-                        char_list_[i] == minimum_pair.first &&
-                        char_list_[i + 1] == minimum_pair.second
-                    );
-                    if (need_merge_) {  // merge & skip next
-                        new_word.push_back(minimum_pair.first + minimum_pair.second);
-                        ++i;
-                    } else {            // keep steady
-                        new_word.push_back(char_list_[i]);
-                    }
-                }
-                char_list_ = std::move(new_word);
+    typedef struct MergeSymbol {
+        uint32_t symbol;                        // SD_SYMBOL_NONE once absorbed by its left neighbour
+        int32_t prev;
+        int32_t next;
+    } MergeSymbol;
+
+    // (rank, left position, left symbol, right symbol, merged symbol), smallest rank then leftmost first
+    typedef std::tuple<uint32_t, int32_t, uint32_t, uint32_t, uint32_t> MergeCandidate;
+    typedef std::priority_queue<MergeCandidate, std::vector<MergeCandidate>, std::greater<>> MergeQueue;
+
+    WordTokenCache word_cache;
+
+    /**
+     * @details BPE one pre-split word into vocab ids (appended to tokens_), as CLIP does:
+     *          bytes map to the byte-level alphabet, the last one carries "</w>", then the
+     *          lowest ranked adjacent pair is merged until none is left. Candidates sit in a
+     *          min-heap over a linked symbol list, stale entries are dropped when popped, so
+     *          a word costs O(n log n) hash probes instead of a string-pair scan per merge.
+     * @param word_ a single word from the pre-tokenization split
+     * @param tokens_ destination, the word's ids are appended
+     */
+    void bpe_word(const std::string &word_, Tokens &tokens_) {
+        if (word_.empty() || word_cache.find(word_, tokens_)) return;
+        size_t first_ = tokens_.size();
+
+        if (!sd_tokenizer_merge_ready || sd_tokenizer_merges.empty()) {
+            // no merges, whole word lookup
+            tokens_.push_back(sd_tokenizer_vocab.find_or(word_, "</w>", sd_tokenizer_unknown_id));
+        } else {
+            const auto count_ = int32_t(word_.size());
+            std::vector<MergeSymbol> symbols_(count_);
+            for (int32_t i = 0; i < count_; ++i) {
+                symbols_[i] = {
+                    sd_tokenizer_merges.byte_symbol(uint8_t(word_[i]), i == count_ - 1),
+                    i - 1, (i + 1 < count_) ? i + 1 : -1
+                };
             }
-            current_pairs_ = make_words_pair(char_list_);
-            minimum_pair = find_min_rank(current_pairs_);
-        }
 
-        // step.3: if no chars can be merged, the return final result.
-        // Mark: if there have unrecognisable words, that means words is not in vocabs, needs retraining add.
-        std::string paired_result_;
-        for (size_t i = 0; i < char_list_.size(); ++i) {
-            paired_result_ += char_list_[i];
-            if (i != char_list_.size() - 1) {
-                paired_result_ += " ";
+            MergeQueue queue_;
+            auto propose_ = [&](int32_t left_) {
+                if (left_ < 0 || symbols_[left_].next < 0) return;
+                uint32_t left_symbol_ = symbols_[left_].symbol;
+                uint32_t right_symbol_ = symbols_[symbols_[left_].next].symbol;
+                const auto *rule_ = sd_tokenizer_merges.find_merge(left_symbol_, right_symbol_);
+                if (rule_) queue_.emplace(rule_->rank, left_, left_symbol_, right_symbol_, rule_->merged);
+            };
+            for (int32_t i = 0; i + 1 < count_; ++i) propose_(i);
+
+            while (!queue_.empty()) {
+                auto [rank_, left_, left_symbol_, right_symbol_, merged_] = queue_.top();
+                queue_.pop();
+                MergeSymbol &left_item_ = symbols_[left_];
+                int32_t right_ = left_item_.next;
+                bool still_valid_ = (left_item_.symbol == left_symbol_ && right_ >= 0 &&
+                                     symbols_[right_].symbol == right_symbol_);
+                if (!still_valid_) continue;
+
+                left_item_.symbol = merged_;
+                left_item_.next = symbols_[right_].next;
+                if (left_item_.next >= 0) symbols_[left_item_.next].prev = left_;
+                symbols_[right_].symbol = SymbolMergeTable::SD_SYMBOL_NONE;
+
+                propose_(left_item_.prev);
+                propose_(left_);
             }
-        }
-        return paired_result_;
-    }
 
-    std::tuple<Tokens, Multis, size_t> encode(PromptWeight_map prompt_weight_) override {
-
-        const float token_end_multi_ = get_boundary_factor();
-        const int token_end_index_ = get_end_token_index();
-        const int token_safe_gaps_ = 20;
-        const int avail_ = get_avail_token_size();      // limit of current token_size 75
-
-        Tokens remade_tokens;
-        Multis remade_multis;
-
-        size_t pair_count_ = 1;
-        int last_vocab_at_ = -1;
-        for (auto concise_: prompt_weight_) {
-
-            std::string bep_paired_ = bep_pair_merge(concise_.first);
-
-            std::vector<std::string> vocab_list_ = PromptsHelper::split(
-                PromptsHelper::whitespace(bep_paired_),
-                def_split_reg, false
-            );
-            for (const std::string& vocab_: vocab_list_) {
-                bool reach_space_mark_ = (vocab_ == def_vocab_end);
-                bool needs_split_last_ = ((remade_tokens.size() % avail_ == 0) && (last_vocab_at_ != -1) &&
-                                          (remade_tokens.size() - last_vocab_at_ <= token_safe_gaps_));
-                if (reach_space_mark_) {
-                    last_vocab_at_ = int(remade_tokens.size());
-                } else if (needs_split_last_) {
-                    last_vocab_at_ += 1;
-                    Tokens tokens_cache_(remade_tokens.begin() + last_vocab_at_, remade_tokens.end());
-                    Multis multis_cache_(remade_multis.begin() + last_vocab_at_, remade_multis.end());
-
-                    // do split token with last reach max length
-                    remade_tokens.resize(last_vocab_at_);
-                    remade_multis.resize(last_vocab_at_);
-                    int token_end_ = int(ceil(float(remade_tokens.size()) / float(avail_)) * avail_ - remade_tokens.size());
-                    remade_tokens.insert(remade_tokens.end(), token_end_, token_end_index_);
-                    remade_multis.insert(remade_multis.end(), token_end_, token_end_multi_);
-
-                    remade_tokens.insert(remade_tokens.end(), tokens_cache_.begin(), tokens_cache_.end());
-                    remade_multis.insert(remade_multis.end(), multis_cache_.begin(), multis_cache_.end());
-                    pair_count_ += 1;
-                }
-
-                remade_tokens.push_back(sd_tokenizer_tok2id[vocab_ + "</w>"]);
-                remade_multis.push_back(concise_.second);
+            // Mark: unrecognisable symbols are not in vocabs, they fall back to the unknown token
+            for (int32_t at_ = 0; at_ >= 0; at_ = symbols_[at_].next) {
+                int32_t token_ = sd_tokenizer_merges.symbol_token(symbols_[at_].symbol);
+                tokens_.push_back((token_ != VocabTable::SD_TOKEN_NONE) ? token_ : sd_tokenizer_unknown_id);
             }
         }
 
-        int finish_at_ = int(ceil(remade_tokens.size() / float(avail_)) * avail_ - remade_tokens.size());
-        remade_tokens.insert(remade_tokens.end(), finish_at_, token_end_index_);
-        remade_multis.insert(remade_multis.end(), finish_at_, token_end_multi_);
+        word_cache.insert(word_, tokens_.data() + first_, tokens_.size() - first_);
+    }
 
-        return {remade_tokens, remade_multis, pair_count_};
+    std::tuple<Tokens, Multis, size_t> encode(PromptWeight_map prompt_weight_) override {
+        // CLIP pre-tokenization, chunks padded with the end mark
+        return pack_chunks(
+            prompt_weight_, get_end_token_index(), 20,
+            [](const std::string &text_, std::vector<std::string> &words_) { PromptScanner::split_words(text_, words_); },
+            [this](const std::string &word_, Tokens &tokens_) { bpe_word(word_, tokens_); }
+        );
+    }
+
+    bool dictionary_ready() const override {
+        return sd_tokenizer_vocab_ready && sd_tokenizer_merge_ready;
     }
 
 public:
@@ -127,14 +111,19 @@ public:
 };
 
 void BPETokenizer::init(){
-    // loading vocabulary
+    // loading vocabulary, a compiled asset brings its merges along
     load_vocab_file(sd_tokenizer_config.tokenizer_dictionary_at);
     // loading aggregates
-    load_merge_file(sd_tokenizer_config.tokenizer_aggregates_at);
+    if (!sd_tokenizer_merge_ready) {
+        load_merge_file(sd_tokenizer_config.tokenizer_aggregates_at);
+    }
+    // CLIP has no dedicated unknown token, its tokenizer reuses <|endoftext|>
+    bind_unknown_token("<|endoftext|>");
+    word_cache.clear();
 }
 
 void BPETokenizer::uninit() {
-
+    word_cache.clear();
 }
 
 } // namespace tokenizer
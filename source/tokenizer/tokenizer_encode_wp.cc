@@ -13,56 +13,73 @@ namespace tokenizer {
 
 class WPTokenizer : public TokenizerBase {
 protected:
-    std::tuple<Tokens, Multis, size_t> encode(PromptWeight_map prompt_weight_) override {
-
-        const float token_end_multi_ = get_boundary_factor();
-        const int token_end_index_ = get_end_token_index();
-        const int token_safe_gaps_ = 2;
-        const int avail_ = get_avail_token_size();      // limit of current token_size 75
-
-        Tokens remade_tokens;
-        Multis remade_multis;
-
-        size_t pair_count_ = 1;
-        int last_vocab_at_ = -1;
-        for (auto concise_: prompt_weight_) {
-            std::vector<std::string> vocab_list_ = PromptsHelper::split(
-                PromptsHelper::whitespace(concise_.first),
-                def_split_reg, false
-            );
-            for (const std::string& vocab_: vocab_list_) {
-                bool reach_space_mark_ = (vocab_ == def_vocab_end);
-                bool needs_split_last_ = ((remade_tokens.size() % avail_ == 0) && (last_vocab_at_ != -1) &&
-                                          (remade_tokens.size() - last_vocab_at_ <= token_safe_gaps_));
-                if (reach_space_mark_) {
-                    last_vocab_at_ = int(remade_tokens.size());
-                } else if (needs_split_last_) {
-                    last_vocab_at_ += 1;
-                    Tokens tokens_cache_(remade_tokens.begin() + last_vocab_at_, remade_tokens.end());
-                    Multis multis_cache_(remade_multis.begin() + last_vocab_at_, remade_multis.end());
-
-                    // do split token with last reach max length
-                    remade_tokens.resize(last_vocab_at_);
-                    remade_multis.resize(last_vocab_at_);
-                    int token_end_ = int(ceil(float(remade_tokens.size()) / float(avail_)) * avail_ - remade_tokens.size());
-                    remade_tokens.insert(remade_tokens.end(), token_end_, token_end_index_);
-                    remade_multis.insert(remade_multis.end(), token_end_, token_end_multi_);
-
-                    remade_tokens.insert(remade_tokens.end(), tokens_cache_.begin(), tokens_cache_.end());
-                    remade_multis.insert(remade_multis.end(), multis_cache_.begin(), multis_cache_.end());
-                    pair_count_ += 1;
+    static constexpr size_t SD_WP_MAX_WORD_BYTES = 100;    // longer words are a single [UNK], as BERT does
+
+    WordPieceTrie wp_trie;
+    int32_t wp_start_id = VocabTable::SD_TOKEN_NONE;
+    int32_t wp_end_id = VocabTable::SD_TOKEN_NONE;
+    int32_t wp_pad_id = VocabTable::SD_TOKEN_NONE;
+
+    /**
+     * @details WordPiece one pre-split word into vocab ids (appended to tokens_): greedy
+     *          longest-match-first, the first piece from the trie root, every following one
+     *          from the node after "##". A word with any unmatched rest becomes one [UNK].
+     *          A piece costs one trie walk over its bytes (no word cache: a walk is cheaper
+     *          than a locked cache probe).
+     * @param word_ a single word from the basic pre-tokenization split
+     * @param tokens_ destination, the word's ids are appended
+     */
+    void wordpiece_word(const std::string &word_, Tokens &tokens_) {
+        if (word_.empty()) return;
+        size_t first_ = tokens_.size();
+
+        bool unknown_ = (word_.size() > SD_WP_MAX_WORD_BYTES);
+        size_t start_ = 0;
+        while (!unknown_ && start_ < word_.size()) {
+            int32_t node_ = (start_ == 0) ? wp_trie.root() : wp_trie.continuation();
+            int32_t match_id_ = VocabTable::SD_TOKEN_NONE;
+            size_t match_end_ = start_;
+            for (size_t at_ = start_; at_ < word_.size() && node_ != WordPieceTrie::SD_TRIE_NONE; ++at_) {
+                node_ = wp_trie.step(node_, uint8_t(word_[at_]));
+                int32_t value_ = wp_trie.value(node_);
+                if (value_ != WordPieceTrie::SD_TRIE_NONE) {
+                    match_id_ = value_;
+                    match_end_ = at_ + 1;
                 }
-
-                remade_tokens.push_back(sd_tokenizer_tok2id[vocab_ + "</w>"]);
-                remade_multis.push_back(concise_.second);
             }
+            if (match_id_ == VocabTable::SD_TOKEN_NONE) {
+                unknown_ = true;
+            } else {
+                tokens_.push_back(match_id_);
+                start_ = match_end_;
+            }
+        }
+        if (unknown_) {
+            tokens_.resize(first_);
+            tokens_.push_back(sd_tokenizer_unknown_id);
         }
+    }
 
-        int finish_at_ = int(ceil(remade_tokens.size() / float(avail_)) * avail_ - remade_tokens.size());
-        remade_tokens.insert(remade_tokens.end(), finish_at_, token_end_index_);
-        remade_multis.insert(remade_multis.end(), finish_at_, token_end_multi_);
+    std::tuple<Tokens, Multis, size_t> encode(PromptWeight_map prompt_weight_) override {
+        // BERT basic pre-tokenization, chunks padded with [PAD]
+        return pack_chunks(
+            prompt_weight_, get_pad_token_index(), 2,
+            [](const std::string &text_, std::vector<std::string> &words_) { PromptScanner::split_basic(text_, words_); },
+            [this](const std::string &word_, Tokens &tokens_) { wordpiece_word(word_, tokens_); }
+        );
+    }
+
+    // BERT marks when the vocabulary has them, otherwise the configured indices
+    int32_t get_start_token_index() const override {
+        return (wp_start_id != VocabTable::SD_TOKEN_NONE) ? wp_start_id : TokenizerBase::get_start_token_index();
+    }
+
+    int32_t get_end_token_index() const override {
+        return (wp_end_id != VocabTable::SD_TOKEN_NONE) ? wp_end_id : TokenizerBase::get_end_token_index();
+    }
 
-        return {remade_tokens, remade_multis, pair_count_};
+    int32_t get_pad_token_index() const override {
+        return (wp_pad_id != VocabTable::SD_TOKEN_NONE) ? wp_pad_id : TokenizerBase::get_pad_token_index();
     }
 
 public:
@@ -74,12 +91,18 @@ public:
 };
 
 void WPTokenizer::init(){
-    // loading vocabulary
+    // loading vocabulary, plain vocab.txt or a compiled asset
     load_vocab_file(sd_tokenizer_config.tokenizer_dictionary_at);
+    bind_unknown_token("[UNK]");
+    wp_start_id = sd_tokenizer_vocab.find("[CLS]");
+    wp_end_id = sd_tokenizer_vocab.find("[SEP]");
+    wp_pad_id = sd_tokenizer_vocab.find("[PAD]");
+    // piece matching runs on the trie, the table stays for marks and decoding
+    wp_trie.build(sd_tokenizer_vocab);
 }
 
 void WPTokenizer::uninit() {
-    // nothing to do
+    wp_trie.clear();
 }
 
 } // namespace tokenizer
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2018-2050 SD_Tokenizer Prompt Scanner - Arikan.Li
+ * Created by Arikan.Li on 2026/10/19.
+ */
+#ifndef TOKENIZER_PROMPT_SCANNER_H
+#define TOKENIZER_PROMPT_SCANNER_H
+
+#include "onnxsd_foundation.cc"
+
+namespace onnx {
+namespace sd {
+namespace tokenizer {
+
+using namespace base;
+using namespace amon;
+
+/**
+ * Single-pass scanners for the prompt grammars the tokenizers used to drive through
+ * std::regex. Each one reproduces the leftmost-first matching of the pattern it
+ * replaces (quoted above the method), on byte strings in the classic locale.
+ */
+class PromptScanner {
+private:
+    static bool is_space(char c_) {             // ECMAScript \s
+        return c_ == ' ' || c_ == '\t' || c_ == '\n' || c_ == '\r' || c_ == '\f' || c_ == '\v';
+    }
+
+    static bool is_alpha(char c_) {
+        return (c_ >= 'a' && c_ <= 'z') || (c_ >= 'A' && c_ <= 'Z');
+    }
+
+    static bool is_digit(char c_) {
+        return c_ >= '0' && c_ <= '9';
+    }
+
+    static bool is_word(char c_) {              // ECMAScript \w
+        return is_alpha(c_) || is_digit(c_) || c_ == '_';
+    }
+
+    static char lower(char c_) {
+        return (c_ >= 'A' && c_ <= 'Z') ? char(c_ - 'A' + 'a') : c_;
+    }
+
+    static bool starts_with_icase(std::string_view text_, size_t at_, std::string_view literal_) {
+        if (text_.size() - at_ < literal_.size()) return false;
+        for (size_t i = 0; i < literal_.size(); ++i) {
+            if (lower(text_[at_ + i]) != literal_[i]) return false;
+        }
+        return true;
+    }
+
+public:
+    static bool is_attention_mark(char c_) {
+        return c_ == '\\' || c_ == '(' || c_ == ')' || c_ == '[' || c_ == ']' || c_ == ':';
+    }
+
+    /**
+     * @details Length of an explicit attention weight ":1.3)" starting at at_, 0 if none
+     *          :([+-]?[.\d]+)\)
+     */
+    static size_t match_weight(std::string_view text_, size_t at_) {
+        size_t end_ = at_ + 1;
+        if (end_ < text_.size() && (text_[end_] == '+' || text_[end_] == '-')) ++end_;
+        size_t digits_ = end_;
+        while (end_ < text_.size() && (is_digit(text_[end_]) || text_[end_] == '.')) ++end_;
+        if (end_ == digits_ || end_ >= text_.size() || text_[end_] != ')') return 0;
+        return end_ + 1 - at_;
+    }
+
+    /**
+     * @details Split a text fragment on BREAK keywords, consuming the whitespace around them
+     *          \s*\bBREAK\b\s*  (as an sregex_token_iterator with -1: every part before a
+     *          keyword, even empty, then the tail only if not empty; no keyword keeps text_)
+     * @param text_ fragment to split
+     * @param parts_ result, views into text_
+     */
+    static void split_breaks(std::string_view text_, std::vector<std::string_view> &parts_) {
+        parts_.clear();
+        size_t part_at_ = 0;
+        size_t search_at_ = 0;
+        while (true) {
+            size_t keyword_at_ = text_.find("BREAK", search_at_);
+            if (keyword_at_ == std::string_view::npos) break;
+            size_t keyword_end_ = keyword_at_ + 5;
+            bool bounded_ = (keyword_at_ == 0 || !is_word(text_[keyword_at_ - 1])) &&
+                            (keyword_end_ == text_.size() || !is_word(text_[keyword_end_]));
+            if (!bounded_) {
+                search_at_ = keyword_at_ + 1;
+                continue;
+            }
+            size_t match_at_ = keyword_at_;
+            while (match_at_ > part_at_ && is_space(text_[match_at_ - 1])) --match_at_;
+            size_t match_end_ = keyword_end_;
+            while (match_end_ < text_.size() && is_space(text_[match_end_])) ++match_end_;
+
+            parts_.push_back(text_.substr(part_at_, match_at_ - part_at_));
+            part_at_ = search_at_ = match_end_;
+        }
+        if (parts_.empty() || part_at_ < text_.size()) {
+            parts_.push_back(text_.substr(part_at_));
+        }
+    }
+
+    /**
+     * @details BERT basic pre-tokenization: split on whitespace, every ASCII punctuation
+     *          byte is a word of its own, other control bytes are dropped. Non-ASCII bytes
+     *          stay inside words (no accent stripping / CJK splitting)
+     * @param text_ text to split
+     * @param words_ result, appended
+     */
+    static void split_basic(std::string_view text_, std::vector<std::string> &words_) {
+        auto is_punctuation_ = [](char c_) {
+            return (c_ >= 33 && c_ <= 47) || (c_ >= 58 && c_ <= 64) || (c_ >= 91 && c_ <= 96) || (c_ >= 123 && c_ <= 126);
+        };
+        size_t at_ = 0;
+        while (at_ < text_.size()) {
+            char c_ = text_[at_];
+            if (is_punctuation_(c_)) {
+                words_.emplace_back(1, c_);
+                ++at_;
+                continue;
+            }
+            if (is_space(c_) || (uint8_t(c_) < 0x20) || c_ == 0x7F) {
+                ++at_;
+                continue;
+            }
+            size_t end_ = at_ + 1;
+            while (end_ < text_.size() && !is_space(text_[end_]) && !is_punctuation_(text_[end_]) &&
+                   uint8_t(text_[end_]) >= 0x20 && text_[end_] != 0x7F) ++end_;
+            words_.emplace_back(text_.substr(at_, end_ - at_));
+            at_ = end_;
+        }
+    }
+
+    /**
+     * @details CLIP pre-tokenization, every match in order, unmatched bytes are dropped
+     *          <\|startoftext\|>|<\|endoftext\|>|'s|'t|'re|'ve|'m|'ll|'d|[a-zA-Z]+|\d|[^ \t\n\r\f\v\w]+
+     *          (case-insensitive)
+     * @param text_ text to split
+     * @param words_ result, appended
+     */
+    static void split_words(std::string_view text_, std::vector<std::string> &words_) {
+        static const std::string_view specials_[] = {
+            "<|startoftext|>", "<|endoftext|>", "'s", "'t", "'re", "'ve", "'m", "'ll", "'d"
+        };
+        size_t at_ = 0;
+        while (at_ < text_.size()) {
+            char c_ = text_[at_];
+            size_t end_ = at_;
+            if (c_ == '<' || c_ == '\'') {
+                for (std::string_view special_ : specials_) {
+                    if (starts_with_icase(text_, at_, special_)) {
+                        end_ = at_ + special_.size();
+                        break;
+                    }
+                }
+            }
+            if (end_ == at_) {
+                if (is_alpha(c_)) {
+                    while (end_ < text_.size() && is_alpha(text_[end_])) ++end_;
+                } else if (is_digit(c_)) {
+                    end_ = at_ + 1;
+                } else if (!is_space(c_) && !is_word(c_)) {
+                    while (end_ < text_.size() && !is_space(text_[end_]) && !is_word(text_[end_])) ++end_;
+                } else {
+                    ++at_;              // whitespace or '_', not part of any word
+                    continue;
+                }
+            }
+            words_.emplace_back(text_.substr(at_, end_ - at_));
+            at_ = end_;
+        }
+    }
+};
+
+} // namespace tokenizer
+} // namespace sd
+} // namespace onnx
+
+#endif //TOKENIZER_PROMPT_SCANNER_H
@@ -19,6 +19,7 @@ using namespace base;
 typedef TokenizerBase TokenizerEntity;
 typedef TokenizerBase* TokenizerEntity_ptr;
 typedef TokenizerBase::PreparedToken_vec PairedTokenWeight;
+typedef TokenizerBase::PreparedBatch PairedTokenBatch;
 
 class TokenizerRegister {
 public:
@@ -51,6 +52,25 @@ public:
         }
         return nullptr;
     }
+
+    // loads a dictionary (+ merges) once and writes them as a compiled *.adtk asset
+    static bool compile_tokenizer(
+        TokenizerType tokenizer_type_, const std::string &dictionary_at_,
+        const std::string &aggregates_at_, const std::string &asset_path_
+    ){
+        TokenizerConfig tokenizer_config_ = DEFAULT_TOKENIZER_CONFIG;
+        tokenizer_config_.tokenizer_type = tokenizer_type_;
+        tokenizer_config_.tokenizer_dictionary_at = dictionary_at_;
+        tokenizer_config_.tokenizer_aggregates_at = aggregates_at_;
+
+        TokenizerEntity_ptr target_ptr_ = request_tokenizer(tokenizer_config_);
+        if (!target_ptr_) return false;
+        target_ptr_->init();
+        bool compiled_ = target_ptr_->compile(asset_path_);
+        target_ptr_->uninit();
+        recycle_tokenizer(target_ptr_);
+        return compiled_;
+    }
 };
 
 } // namespace tokenizer
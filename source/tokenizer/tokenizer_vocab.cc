@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2018-2050 SD_Tokenizer Vocabulary - Arikan.Li
+ * Created by Arikan.Li on 2026/10/19.
+ */
+#ifndef TOKENIZER_VOCAB_H
+#define TOKENIZER_VOCAB_H
+
+#include "onnxsd_foundation.cc"
+
+namespace onnx {
+namespace sd {
+namespace tokenizer {
+
+using namespace base;
+using namespace amon;
+
+/**
+ * Read-only vocabulary. Token text is packed into one contiguous blob, entries keep
+ * (offset, length, id, hash) and an open-addressing table of entry indices answers
+ * token -> id; id -> token is a dense index. Built once by add() + seal(), or attached
+ * to the same arrays inside a compiled asset, after that it is never written, so one
+ * instance can serve concurrent requests.
+ * Lookups take string views (optionally as head + tail, e.g. word + "</w>"), so
+ * nothing is allocated or inserted per lookup; a miss returns SD_TOKEN_NONE and the
+ * caller applies its unknown-token policy.
+ */
+class VocabTable {
+public:
+    static constexpr int32_t SD_TOKEN_NONE = -1;
+
+    typedef struct VocabEntry {
+        uint32_t offset;                        // into the blob
+        uint32_t length;
+        int32_t id;
+        uint32_t hash;                          // low 32 bits, rejects most probes before memcmp
+    } VocabEntry;
+
+    static constexpr uint32_t SD_ENTRY_NONE = 0xFFFFFFFFu;
+
+    // the sealed arrays every lookup reads, owned or inside a mapped asset
+    typedef struct VocabView {
+        const char *blob = nullptr;
+        size_t blob_size = 0;
+        const VocabEntry *entries = nullptr;
+        size_t entry_count = 0;
+        const uint32_t *slots = nullptr;        // entry index per slot, power-of-two capacity, load <= 1/2
+        size_t slot_count = 0;
+        const uint32_t *ids = nullptr;          // id -> entry index
+        size_t id_count = 0;
+    } VocabView;
+
+private:
+    std::string vocab_blob;
+    std::vector<VocabEntry> vocab_entries;
+    std::vector<uint32_t> vocab_slots;
+    std::vector<uint32_t> vocab_ids;
+    VocabView vocab_view;
+    std::shared_ptr<const void> vocab_backing;  // keeps an attached asset mapped
+
+    static uint64_t hash_of(std::string_view head_, std::string_view tail_) {    // FNV-1a 64
+        uint64_t hash_ = 0xCBF29CE484222325ull;
+        for (char c : head_) { hash_ ^= uint8_t(c); hash_ *= 0x100000001B3ull; }
+        for (char c : tail_) { hash_ ^= uint8_t(c); hash_ *= 0x100000001B3ull; }
+        return hash_ ^ (hash_ >> 32);
+    }
+
+    bool matches(const VocabEntry &entry_, uint32_t hash_, std::string_view head_, std::string_view tail_) const {
+        if (entry_.hash != hash_ || entry_.length != head_.size() + tail_.size()) return false;
+        const char *text_ = vocab_view.blob + entry_.offset;
+        return (head_.empty() || std::memcmp(text_, head_.data(), head_.size()) == 0) &&
+               (tail_.empty() || std::memcmp(text_ + head_.size(), tail_.data(), tail_.size()) == 0);
+    }
+
+    uint32_t find_entry(std::string_view head_, std::string_view tail_) const {
+        if (vocab_view.slot_count == 0) return SD_ENTRY_NONE;
+        uint64_t hash_ = hash_of(head_, tail_);
+        size_t mask_ = vocab_view.slot_count - 1;
+        for (size_t at_ = hash_ & mask_;; at_ = (at_ + 1) & mask_) {
+            uint32_t entry_at_ = vocab_view.slots[at_];
+            if (entry_at_ == SD_ENTRY_NONE) return SD_ENTRY_NONE;
+            if (matches(vocab_view.entries[entry_at_], uint32_t(hash_), head_, tail_)) return entry_at_;
+        }
+    }
+
+public:
+    VocabTable() = default;
+    VocabTable(const VocabTable &) = delete;
+    VocabTable &operator=(const VocabTable &) = delete;
+
+    // build phase, ids may come in any order and may leave holes
+    void add(std::string_view token_, int32_t id_) {
+        if (id_ < 0) return;
+        vocab_entries.push_back({
+            uint32_t(vocab_blob.size()), uint32_t(token_.size()), id_, uint32_t(hash_of(token_, {}))
+        });
+        vocab_blob.append(token_.data(), token_.size());
+    }
+
+    // builds both indices; a token listed twice keeps its first entry
+    void seal() {
+        size_t capacity_ = 1024;
+        while (capacity_ < vocab_entries.size() * 2) capacity_ <<= 1;
+        vocab_slots.assign(capacity_, SD_ENTRY_NONE);
+
+        int32_t max_id_ = -1;
+        for (const VocabEntry &entry_ : vocab_entries) max_id_ = std::max(max_id_, entry_.id);
+        vocab_ids.assign(size_t(max_id_ + 1), SD_ENTRY_NONE);
+
+        size_t mask_ = capacity_ - 1;
+        for (uint32_t i = 0; i < uint32_t(vocab_entries.size()); ++i) {
+            const VocabEntry &entry_ = vocab_entries[i];
+            std::string_view text_(vocab_blob.data() + entry_.offset, entry_.length);
+            uint64_t hash_ = hash_of(text_, {});
+            for (size_t at_ = hash_ & mask_;; at_ = (at_ + 1) & mask_) {
+                uint32_t entry_at_ = vocab_slots[at_];
+                if (entry_at_ == SD_ENTRY_NONE) {
+                    vocab_slots[at_] = i;
+                    if (vocab_ids[entry_.id] == SD_ENTRY_NONE) vocab_ids[entry_.id] = i;
+                    break;
+                }
+                const VocabEntry &other_ = vocab_entries[entry_at_];
+                if (other_.hash == entry_.hash && other_.length == entry_.length &&
+                    std::memcmp(vocab_blob.data() + other_.offset, text_.data(), text_.size()) == 0) break;
+            }
+        }
+
+        vocab_view = {
+            vocab_blob.data(), vocab_blob.size(),
+            vocab_entries.data(), vocab_entries.size(),
+            vocab_slots.data(), vocab_slots.size(),
+            vocab_ids.data(), vocab_ids.size()
+        };
+    }
+
+    // serve lookups from arrays owned by backing_ (a mapped asset), sealed as by seal()
+    void attach(const VocabView &view_, std::shared_ptr<const void> backing_) {
+        clear();
+        vocab_view = view_;
+        vocab_backing = std::move(backing_);
+    }
+
+    const VocabView &view() const { return vocab_view; }
+
+    int32_t find(std::string_view head_, std::string_view tail_ = {}) const {
+        uint32_t entry_at_ = find_entry(head_, tail_);
+        return (entry_at_ == SD_ENTRY_NONE) ? SD_TOKEN_NONE : vocab_view.entries[entry_at_].id;
+    }
+
+    int32_t find_or(std::string_view head_, std::string_view tail_, int32_t unknown_) const {
+        int32_t id_ = find(head_, tail_);
+        return (id_ == SD_TOKEN_NONE) ? unknown_ : id_;
+    }
+
+    // empty view when the id is not in the vocabulary
+    std::string_view token(int32_t id_) const {
+        if (id_ < 0 || size_t(id_) >= vocab_view.id_count || vocab_view.ids[id_] == SD_ENTRY_NONE) return {};
+        const VocabEntry &entry_ = vocab_view.entries[vocab_view.ids[id_]];
+        return {vocab_view.blob + entry_.offset, entry_.length};
+    }
+
+    bool contains(std::string_view token_) const { return find(token_) != SD_TOKEN_NONE; }
+    size_t size() const { return vocab_view.entry_count; }
+    bool empty() const { return vocab_view.entry_count == 0; }
+
+    void clear() {
+        vocab_blob.clear();
+        vocab_entries.clear();
+        vocab_slots.clear();
+        vocab_ids.clear();
+        vocab_view = {};
+        vocab_backing.reset();
+    }
+};
+
+} // namespace tokenizer
+} // namespace sd
+} // namespace onnx
+
+#endif //TOKENIZER_VOCAB_H
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2018-2050 SD_Tokenizer WordPiece Trie - Arikan.Li
+ * Created by Arikan.Li on 2026/10/19.
+ */
+#ifndef TOKENIZER_WORDPIECE_TRIE_H
+#define TOKENIZER_WORDPIECE_TRIE_H
+
+#include "onnxsd_foundation.cc"
+#include "tokenizer_vocab.cc"
+
+namespace onnx {
+namespace sd {
+namespace tokenizer {
+
+using namespace base;
+using namespace amon;
+
+/**
+ * Double-array trie over the vocabulary bytes: a transition is child = base[node] + byte,
+ * valid when check[child] == node, so walking a word costs one array probe per byte.
+ * value[node] holds the token id ending there. Greedy longest-match-first WordPiece
+ * walks once per piece and keeps the last terminal node it passed, instead of trying
+ * every prefix length against a hash map.
+ */
+class WordPieceTrie {
+public:
+    static constexpr int32_t SD_TRIE_NONE = -1;
+
+private:
+    std::vector<int32_t> trie_base;
+    std::vector<int32_t> trie_check;
+    std::vector<int32_t> trie_value;
+    std::vector<int32_t> free_next;             // build only: slot -> a later candidate free slot
+    int32_t continuation_root = SD_TRIE_NONE;   // node after "##"
+
+    typedef std::pair<std::string_view, int32_t> TrieKey;
+
+    void reserve(size_t size_) {
+        if (size_ <= trie_check.size()) return;
+        size_t grown_ = std::max(size_, trie_check.size() * 2);
+        trie_base.resize(grown_, 0);
+        trie_check.resize(grown_, SD_TRIE_NONE);
+        trie_value.resize(grown_, SD_TRIE_NONE);
+        size_t from_ = free_next.size();
+        free_next.resize(grown_ + 1);
+        for (size_t i = from_; i <= grown_; ++i) free_next[i] = int32_t(i);
+    }
+
+    // first free slot at or after at_, occupied runs are skipped with path halving
+    size_t next_free(size_t at_) {
+        while (size_t(free_next[at_]) != at_) {
+            free_next[at_] = free_next[free_next[at_]];
+            at_ = size_t(free_next[at_]);
+        }
+        return at_;
+    }
+
+    void occupy(size_t at_, int32_t parent_) {
+        trie_check[at_] = parent_;
+        free_next[at_] = int32_t(at_ + 1);
+    }
+
+    // keys_[lo_, hi_) share their first depth_ bytes and end up below node_
+    void insert(const std::vector<TrieKey> &keys_, size_t lo_, size_t hi_, size_t depth_, int32_t node_,
+                size_t &search_from_) {
+        if (keys_[lo_].first.size() == depth_) {        // sorted, so the exact key comes first
+            trie_value[node_] = keys_[lo_].second;
+            ++lo_;
+        }
+        if (lo_ == hi_) return;
+
+        std::vector<std::pair<uint8_t, size_t>> children_;     // label, first key
+        for (size_t i = lo_; i < hi_; ++i) {
+            auto label_ = uint8_t(keys_[i].first[depth_]);
+            if (children_.empty() || children_.back().first != label_) children_.emplace_back(label_, i);
+        }
+
+        // first base whose child slots are all free: the first child is tried on free slots
+        // only, so a single-child node (most of them) takes the first free slot it sees
+        const size_t first_label_ = children_.front().first;
+        size_t base_ = 0;
+        for (size_t slot_ = next_free(search_from_);; slot_ = next_free(slot_ + 1)) {
+            if (slot_ <= first_label_) continue;
+            base_ = slot_ - first_label_;
+            reserve(base_ + 256 + 1);
+            bool free_ = true;
+            for (const auto &child_ : children_) {
+                if (trie_check[base_ + child_.first] != SD_TRIE_NONE) { free_ = false; break; }
+            }
+            if (free_) break;
+        }
+        trie_base[node_] = int32_t(base_);
+        for (const auto &child_ : children_) occupy(base_ + child_.first, node_);
+        search_from_ = next_free(search_from_);
+
+        for (size_t c = 0; c < children_.size(); ++c) {
+            size_t end_ = (c + 1 < children_.size()) ? children_[c + 1].second : hi_;
+            insert(keys_, children_[c].second, end_, depth_ + 1, int32_t(base_ + children_[c].first), search_from_);
+        }
+    }
+
+public:
+    void build(const VocabTable &vocab_) {
+        clear();
+        const VocabTable::VocabView &view_ = vocab_.view();
+        std::vector<TrieKey> keys_;
+        keys_.reserve(view_.entry_count);
+        for (size_t i = 0; i < view_.entry_count; ++i) {
+            const VocabTable::VocabEntry &entry_ = view_.entries[i];
+            std::string_view token_(view_.blob + entry_.offset, entry_.length);
+            if (!token_.empty() && vocab_.find(token_) == entry_.id) keys_.emplace_back(token_, entry_.id);
+        }
+        std::sort(keys_.begin(), keys_.end());
+
+        reserve(keys_.size() * 4 + 256 + 1);
+        occupy(0, 0);                           // root owns slot 0
+        size_t search_from_ = 1;
+        if (!keys_.empty()) insert(keys_, 0, keys_.size(), 0, 0, search_from_);
+        free_next.clear();
+        free_next.shrink_to_fit();
+
+        continuation_root = step(step(0, '#'), '#');
+    }
+
+    int32_t root() const { return trie_check.empty() ? SD_TRIE_NONE : 0; }
+    int32_t continuation() const { return continuation_root; }
+
+    int32_t step(int32_t node_, uint8_t byte_) const {
+        if (node_ < 0) return SD_TRIE_NONE;
+        size_t child_ = size_t(trie_base[node_]) + byte_;
+        bool valid_ = (child_ > 0 && child_ < trie_check.size() && trie_check[child_] == node_);
+        return valid_ ? int32_t(child_) : SD_TRIE_NONE;
+    }
+
+    int32_t value(int32_t node_) const { return (node_ < 0) ? SD_TRIE_NONE : trie_value[node_]; }
+
+    bool empty() const { return trie_check.empty(); }
+    size_t size() const { return trie_check.size(); }
+
+    void clear() {
+        trie_base.clear();
+        trie_check.clear();
+        trie_value.clear();
+        free_next.clear();
+        continuation_root = SD_TRIE_NONE;
+    }
+};
+
+} // namespace tokenizer
+} // namespace sd
+} // namespace onnx
+
+#endif //TOKENIZER_WORDPIECE_TRIE_H
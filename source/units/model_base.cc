@@ -24,6 +24,8 @@ private:
     typedef struct OrtMdlMeta {
         std::vector<std::string> tensor_names_i{};
         std::vector<std::string> tensor_names_o{};
+        std::vector<ONNXTensorElementDataType> tensor_types_i{};
+        std::vector<ONNXTensorElementDataType> tensor_types_o{};
         size_t tensor_count_i = 0;
         size_t tensor_count_o = 0;
     } OrtMdlMeta;
@@ -32,10 +34,39 @@ private:
     OrtSession model_session = nullptr;
     OrtMdlPath model_path;
     OrtMdlMeta model_meta{};
+    PrecisionType model_precision = PRECISION_AUTO;
+
+    std::string calibration_dump_at;                // <dump_at>/<unit>, empty when not dumping
+    uint64_t calibration_sample = 0;
+
+private:
+    void check_precision();
+    void dump_calibration(const std::vector<Tensor>& bound_inputs_);
 
 protected:
     void print_model_detail(const Ort::AllocatorWithDefaultOptions& allocator, bool is_input);
     void execute(std::vector<Tensor>& input_tensors_, std::vector<Tensor>& output_tensors_);
+    // output_tensors_[k] receives model output output_index_[k], every other output is never fetched
+    void execute(std::vector<Tensor>& input_tensors_, std::vector<Tensor>& output_tensors_,
+                 const std::vector<size_t>& output_index_);
+
+    // declared element type of an output; UNDEFINED when unavailable
+    ONNXTensorElementDataType model_output_element_type(size_t index_) const {
+        return (index_ < model_meta.tensor_types_o.size()) ?
+               model_meta.tensor_types_o[index_] : ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+    }
+
+    // input_ in the model's declared floating precision (FP16/BF16 exports), else a plain view;
+    // lets callers convert loop-invariant inputs once instead of on every run
+    Tensor adapt_input(size_t index_, const Tensor &input_) const {
+        ONNXTensorElementDataType declared_ = (index_ < model_meta.tensor_types_i.size()) ?
+                                              model_meta.tensor_types_i[index_] : ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+        ONNXTensorElementDataType provided_ = input_.GetTensorTypeAndShapeInfo().GetElementType();
+        if (declared_ != provided_ && TensorHelper::is_float_type(declared_) && TensorHelper::is_float_type(provided_)) {
+            return TensorHelper::convert(input_, declared_);
+        }
+        return TensorHelper::view(input_);
+    }
 
     // query the declared element type (and rank) of a model input; UNDEFINED when unavailable
     ONNXTensorElementDataType model_input_element_type(size_t index_, size_t* rank_ = nullptr) {
@@ -50,35 +81,42 @@ protected:
         return tensor_info_.GetElementType();
     }
 
+    // declared shape of a model input (dynamic dims as -1); empty when unavailable
+    TensorShape model_input_shape(size_t index_) {
+        if (!model_session || index_ >= model_meta.tensor_count_i) {
+            return {};
+        }
+        Ort::TypeInfo type_info_ = model_session->GetInputTypeInfo(index_);
+        auto tensor_info_ = type_info_.GetTensorTypeAndShapeInfo();
+        return tensor_info_.GetShape();
+    }
+
+    // position of a named model input; model_input_count() when the model has no such input
+    size_t model_input_index(const std::string &name_) const {
+        auto found_ = std::find(model_meta.tensor_names_i.begin(), model_meta.tensor_names_i.end(), name_);
+        return size_t(found_ - model_meta.tensor_names_i.begin());
+    }
+
     size_t model_input_count() const { return model_meta.tensor_count_i; }
     size_t model_output_count() const { return model_meta.tensor_count_o; }
     std::string model_output_name(size_t index_) {
         return (index_ < model_meta.tensor_count_o) ? model_meta.tensor_names_o[index_] : "";
     }
 
-    // run with ORT-allocated outputs (shapes resolved by the model itself);
-    // needed when output arity/shapes vary across exports (e.g. SDXL text encoders)
-    std::vector<Tensor> execute_alloc(std::vector<Tensor>& input_tensors_) {
-        if (!model_session) {
-            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: model not found"));
+    // declared shape of a model output (dynamic dims as -1); empty when unavailable
+    TensorShape model_output_shape(size_t index_) {
+        if (!model_session || index_ >= model_meta.tensor_count_o) {
             return {};
         }
-        try {
-            std::vector<const char*> input_names_;
-            std::vector<const char*> output_names_;
-            for (auto& name_ : model_meta.tensor_names_i) input_names_.push_back(name_.c_str());
-            for (auto& name_ : model_meta.tensor_names_o) output_names_.push_back(name_.c_str());
-            return model_session->Run(
-                Ort::RunOptions{nullptr},
-                input_names_.data(), input_tensors_.data(), input_tensors_.size(),
-                output_names_.data(), output_names_.size()
-            );
-        } catch (const Ort::Exception &e) {
-            std::cerr << "ONNX Runtime exception: " << e.what() << std::endl;
-        } catch (const std::exception &e) {
-            std::cerr << "Standard exception: " << e.what() << std::endl;
-        }
-        return {};
+        Ort::TypeInfo type_info_ = model_session->GetOutputTypeInfo(index_);
+        auto tensor_info_ = type_info_.GetTensorTypeAndShapeInfo();
+        return tensor_info_.GetShape();
+    }
+
+    // position of a named model output; model_output_count() when the model has no such output
+    size_t model_output_index(const std::string &name_) const {
+        auto found_ = std::find(model_meta.tensor_names_o.begin(), model_meta.tensor_names_o.end(), name_);
+        return size_t(found_ - model_meta.tensor_names_o.begin());
     }
 
 protected:
@@ -88,6 +126,15 @@ public:
     explicit ModelBase(std::string model_path_) : model_path(std::move(model_path_)) {};
     virtual ~ModelBase() = default;
 
+    // set before init(): INT8 opens the session with QDQ-tuned options
+    void set_precision(PrecisionType precision_) { model_precision = precision_; }
+
+    // set before running: every run's bound inputs land in <dump_at_>/<unit_tag_>/<sample>/<input>.npy
+    void set_calibration_dump(const std::string &dump_at_, const std::string &unit_tag_) {
+        calibration_dump_at = dump_at_.empty() ? "" : (std::filesystem::path(dump_at_) / unit_tag_).string();
+        calibration_sample = 0;
+    }
+
     void init(ONNXRuntimeExecutor &ort_executor_);
     void release(ONNXRuntimeExecutor &ort_executor_);
 };
@@ -133,7 +180,7 @@ void ModelBase::init(ONNXRuntimeExecutor &ort_executor_) {
         amon_report(class_exception(EXC_LOG_ERR, "ERROR:: model path is NaN"));
         return;
     }
-    model_session = ort_executor_.request_model(model_path);
+    model_session = ort_executor_.request_model(model_path, model_precision);
     if (!model_session) {
         amon_report(class_exception(EXC_LOG_ERR, "ERROR:: model create failed"));
         return;
@@ -146,34 +193,110 @@ void ModelBase::init(ONNXRuntimeExecutor &ort_executor_) {
     for (int i = 0; i < input_count; i++) {
         auto input_name = model_session->GetInputNameAllocated(i, ort_alloc);
         model_meta.tensor_names_i.emplace_back(input_name.get());
+        Ort::TypeInfo type_info_ = model_session->GetInputTypeInfo(i);
+        model_meta.tensor_types_i.emplace_back(type_info_.GetTensorTypeAndShapeInfo().GetElementType());
     }
     for (int i = 0; i < output_count; i++) {
         auto input_name = model_session->GetOutputNameAllocated(i, ort_alloc);
         model_meta.tensor_names_o.emplace_back(input_name.get());
+        Ort::TypeInfo type_info_ = model_session->GetOutputTypeInfo(i);
+        model_meta.tensor_types_o.emplace_back(type_info_.GetTensorTypeAndShapeInfo().GetElementType());
     }
 
     model_meta.tensor_count_i = input_count;
     model_meta.tensor_count_o = output_count;
+    check_precision();
 
     std::cout << model_path.c_str() << std::endl;
     print_model_detail(ort_alloc, true);
     print_model_detail(ort_alloc, false);
 }
 
+void ModelBase::check_precision() {
+    auto declares_ = [this](const std::function<bool(ONNXTensorElementDataType)> &match_) {
+        return std::any_of(model_meta.tensor_types_i.begin(), model_meta.tensor_types_i.end(), match_) ||
+               std::any_of(model_meta.tensor_types_o.begin(), model_meta.tensor_types_o.end(), match_);
+    };
+    bool half_io_ = declares_([](ONNXTensorElementDataType type_) {
+        return type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16 || type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16;
+    });
+    bool fp16_io_ = declares_([](ONNXTensorElementDataType type_) {
+        return type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16;
+    });
+    // quantized exports (QDQ / dynamic) keep float32 IO and only the graph body is int8,
+    // so the declared IO can only flag a float32 request that was handed a half export;
+    // fp16 selects no session options, it asserts an fp16 export (IO converted at the boundary)
+    if ((model_precision == PRECISION_FP32 || model_precision == PRECISION_INT8) && half_io_) {
+        amon_report(class_exception(EXC_LOG_WARN, "WARNING:: fp32/int8 precision requested, but model declares half precision IO"));
+    }
+    if (model_precision == PRECISION_FP16 && !fp16_io_) {
+        amon_report(class_exception(EXC_LOG_WARN, "WARNING:: fp16 precision requested, but model declares no fp16 IO"));
+    }
+}
+
+void ModelBase::dump_calibration(const std::vector<Tensor>& bound_inputs_) {
+    if (calibration_dump_at.empty()) return;
+    char sample_tag_[16];
+    snprintf(sample_tag_, sizeof(sample_tag_), "%06llu", (unsigned long long) calibration_sample++);
+    std::filesystem::path sample_at_ = std::filesystem::path(calibration_dump_at) / sample_tag_;
+    std::error_code fs_error_;
+    std::filesystem::create_directories(sample_at_, fs_error_);
+    if (fs_error_) {
+        amon_report(class_exception(EXC_LOG_WARN, "WARNING:: calibration dump directory create failed"));
+        return;
+    }
+    for (size_t i = 0; i < bound_inputs_.size() && i < model_meta.tensor_count_i; ++i) {
+        // scoped export names may carry '/'
+        std::string file_name_ = model_meta.tensor_names_i[i];
+        std::replace(file_name_.begin(), file_name_.end(), '/', '_');
+        if (!TensorHelper::save_npy(bound_inputs_[i], (sample_at_ / (file_name_ + ".npy")).string())) {
+            amon_report(class_exception(EXC_LOG_WARN, "WARNING:: calibration dump skipped an input"));
+        }
+    }
+}
+
 void ModelBase::execute(std::vector<Tensor>& input_tensors_, std::vector<Tensor>& output_tensors_) {
+    std::vector<size_t> output_index_(model_meta.tensor_count_o);
+    std::iota(output_index_.begin(), output_index_.end(), size_t(0));
+    execute(input_tensors_, output_tensors_, output_index_);
+}
+
+void ModelBase::execute(std::vector<Tensor>& input_tensors_, std::vector<Tensor>& output_tensors_,
+                        const std::vector<size_t>& output_index_) {
     if (!model_session) {
         amon_report(class_exception(EXC_LOG_ERR, "ERROR:: model not found"));
         return;
     }
     try {
+        // FP16/BF16 exports: inputs are converted at the boundary (no-op when already
+        // adapted), outputs run through half staging buffers and land back in float32
+        std::vector<Tensor> bound_inputs_;
+        std::vector<Tensor> staged_outputs_;
+        std::vector<size_t> staged_index_;
+        bound_inputs_.reserve(model_meta.tensor_count_i);
+        staged_outputs_.reserve(output_index_.size());
         Ort::IoBinding io_binding(*model_session);
         for (size_t i = 0; i < model_meta.tensor_count_i; ++i) {
-            io_binding.BindInput(model_meta.tensor_names_i[i].c_str(), input_tensors_[i]);
+            bound_inputs_.emplace_back(adapt_input(i, input_tensors_[i]));
+            io_binding.BindInput(model_meta.tensor_names_i[i].c_str(), bound_inputs_.back());
         }
-        for (size_t i = 0; i < model_meta.tensor_count_o; ++i) {
-            io_binding.BindOutput(model_meta.tensor_names_o[i].c_str(), output_tensors_[i]);
+        dump_calibration(bound_inputs_);
+        for (size_t k = 0; k < output_index_.size(); ++k) {
+            const size_t i = output_index_[k];
+            ONNXTensorElementDataType declared_ = model_output_element_type(i);
+            ONNXTensorElementDataType provided_ = output_tensors_[k].GetTensorTypeAndShapeInfo().GetElementType();
+            if (declared_ != provided_ && TensorHelper::is_float_type(declared_) && TensorHelper::is_float_type(provided_)) {
+                staged_outputs_.emplace_back(TensorHelper::convert(output_tensors_[k], declared_));
+                staged_index_.push_back(k);
+                io_binding.BindOutput(model_meta.tensor_names_o[i].c_str(), staged_outputs_.back());
+            } else {
+                io_binding.BindOutput(model_meta.tensor_names_o[i].c_str(), output_tensors_[k]);
+            }
         }
         model_session->Run(Ort::RunOptions{nullptr}, io_binding);
+        for (size_t k = 0; k < staged_index_.size(); ++k) {
+            TensorHelper::convert_into(staged_outputs_[k], output_tensors_[staged_index_[k]].GetTensorMutableData<float>());
+        }
     } catch (const Ort::Exception &e) {
         std::cerr << "ONNX Runtime exception: " << e.what() << std::endl;
     } catch (const std::exception &e) {
@@ -185,7 +308,8 @@ void ModelBase::release(ONNXRuntimeExecutor &ort_executor_) {
     ort_executor_.release_model(model_session);
     model_session = nullptr;
     model_path.clear();
-    model_meta.~OrtMdlMeta();
+    model_meta = {};
+    calibration_dump_at.clear();
 }
 
 } // namespace units
@@ -38,13 +38,28 @@ typedef struct ClipEmbedResult {
     Tensor pooled = TensorHelper::create(TensorShape{0}, std::vector<float>{});
 } ClipEmbedResult;
 
+// raw encoder rows of a prompt list, before weighting: row first_rows[b] + c is chunk c of prompt b
+typedef struct ClipEncodedBatch {
+    PairedTokenBatch tokens;
+    std::vector<long> token_rows;               // encoder row -> its chunk row in tokens
+    std::vector<long> first_rows;               // prompt -> its first encoder row
+    Tensor hidden = TensorHelper::empty<float>();     // [R, 77, hidden_dim]
+    Tensor pooled = TensorHelper::empty<float>();     // [R, projection_dim], empty when not provided
+} ClipEncodedBatch;
+
 class Clip : public ModelBase {
 private:
     ModelClipConfig sd_clip_config;
     TokenizerEntity_ptr sd_tokenizer_p;
+    size_t clip_hidden_at = 0;                  // model output read as the hidden sequence
+    size_t clip_pooled_at = 0;                  // model output read as pooled, model_output_count() when none
+
+private:
+    void select_outputs();
 
 protected:
     void generate_output(std::vector<Tensor>& output_tensors_) override;
+    void generate_output(std::vector<Tensor>& output_tensors_, long batch_size_);
     Tensor tokenizing(const std::string& prompts_);
 
 public:
@@ -52,6 +67,12 @@ public:
     ~Clip() override;
 
     ClipEmbedResult embedding(const std::string& prompts_);
+    std::vector<ClipEmbedResult> embedding(const std::vector<std::string>& prompts_);
+
+    ClipEncodedBatch encode(const std::vector<std::string>& prompts_);
+    TensorShape hidden_shape(const ClipEncodedBatch& encoded_, size_t prompt_) const;
+    void write_hidden(const ClipEncodedBatch& encoded_, size_t prompt_, Tensor& target_, long column_at_) const;
+    Tensor pooled(const ClipEncodedBatch& encoded_, size_t prompt_) const;
 };
 
 Clip::Clip(const std::string &model_path_, const ModelClipConfig &clip_config_) : ModelBase(model_path_){
@@ -63,102 +84,189 @@ Clip::Clip(const std::string &model_path_, const ModelClipConfig &clip_config_)
 Clip::~Clip(){
     sd_tokenizer_p->uninit();
     sd_tokenizer_p = TokenizerRegister::recycle_tokenizer(sd_tokenizer_p);
-    sd_clip_config.~ModelClipConfig();
 }
 
 void Clip::generate_output(std::vector<Tensor> &output_tensors_) {
-    {
-        std::vector<float> output_hidden_(
-            sd_clip_config.sd_tokenizer_config.avail_token_size *
-            sd_clip_config.sd_tokenizer_config.major_hidden_dim
-        );
-        TensorShape hidden_shape_ = {
-            1,
-            sd_clip_config.sd_tokenizer_config.avail_token_size,
-            sd_clip_config.sd_tokenizer_config.major_hidden_dim
-        };
-        output_tensors_.emplace_back(TensorHelper::create(hidden_shape_, output_hidden_));
+    generate_output(output_tensors_, 1);
+}
+
+// selected outputs for batch_size_ stacked chunks: [B, 77, hidden_dim] and [B, pooled_dim],
+// declared dims first, the tokenizer config's major_hidden_dim when the export leaves them dynamic
+void Clip::generate_output(std::vector<Tensor> &output_tensors_, long batch_size_) {
+    auto declared_dim_ = [this](size_t index_) {
+        TensorShape declared_ = model_output_shape(index_);
+        return (!declared_.empty() && declared_.back() > 0) ?
+               long(declared_.back()) : long(sd_clip_config.sd_tokenizer_config.major_hidden_dim);
+    };
+    TensorShape hidden_shape_ = {
+        batch_size_,
+        sd_clip_config.sd_tokenizer_config.avail_token_size,
+        declared_dim_(clip_hidden_at)
+    };
+    output_tensors_.emplace_back(TensorHelper::allocate<float>(hidden_shape_));
+    if (clip_pooled_at < model_output_count()) {
+        TensorShape pooler_shape_ = {batch_size_, declared_dim_(clip_pooled_at)};
+        output_tensors_.emplace_back(TensorHelper::allocate<float>(pooler_shape_));
     }
-    {
-        std::vector<float> output_pooler_(
-            sd_clip_config.sd_tokenizer_config.major_hidden_dim
-        );
-        TensorShape pooler_shape_ = {
-            1,
-            sd_clip_config.sd_tokenizer_config.major_hidden_dim
-        };
-        output_tensors_.emplace_back(TensorHelper::create(pooler_shape_, output_pooler_));
+}
+
+// legacy exports expose [last_hidden_state, pooler_output] (by position when named otherwise);
+// SDXL-style exports also list every hidden_states.N layer, only the conditioning one is read;
+// a pruned export (sd/quantize/prune_clip_outputs.py) keeps just the layer it was pruned for
+void Clip::select_outputs() {
+    const size_t output_count_ = model_output_count();
+    size_t layer_count_ = 0;
+    size_t last_layer_at_ = output_count_;
+    for (size_t o_ = 0; o_ < output_count_; ++o_) {
+        if (model_output_name(o_).rfind("hidden_states.", 0) == 0) {
+            layer_count_++;
+            last_layer_at_ = o_;
+        }
+    }
+
+    clip_hidden_at = output_count_;
+    if (sd_clip_config.use_penultimate && layer_count_ >= 2) {
+        clip_hidden_at = model_output_index("hidden_states." + std::to_string(layer_count_ - 2));
     }
+    if (clip_hidden_at == output_count_) clip_hidden_at = model_output_index("last_hidden_state");
+    if (clip_hidden_at == output_count_ && layer_count_ == 1) clip_hidden_at = last_layer_at_;
+    if (clip_hidden_at == output_count_) clip_hidden_at = 0;
+
+    clip_pooled_at = model_output_index("pooler_output");
+    if (clip_pooled_at == output_count_) clip_pooled_at = model_output_index("text_embeds");
+    if (clip_pooled_at == output_count_ && output_count_ == 2) clip_pooled_at = 1 - clip_hidden_at;
 }
 
 ClipEmbedResult Clip::embedding(const std::string& prompts_) {
-    // tokenize prompts
-    PairedTokenWeight tokenizer_output_ = sd_tokenizer_p->tokenize(prompts_);
+    return std::move(embedding(std::vector<std::string>{prompts_}).front());
+}
+
+ClipEncodedBatch Clip::encode(const std::vector<std::string>& prompts_) {
+    const long token_size_ = sd_clip_config.sd_tokenizer_config.avail_token_size;
+
+    // tokenize every prompt into one [B, chunks, 77] buffer
+    ClipEncodedBatch encoded_;
+    encoded_.tokens = sd_tokenizer_p->tokenize_batch(prompts_);
+    const PairedTokenBatch &tokenizer_output_ = encoded_.tokens;
+    const size_t chunk_count_ = tokenizer_output_.tokens.GetTensorTypeAndShapeInfo().GetShape()[1];
+
+    // only the real chunks are encoded: row r of the encoder batch is chunk (b, c) of the buffer
+    std::vector<long> &chunk_rows_ = encoded_.token_rows;
+    for (size_t b = 0; b < prompts_.size(); ++b) {
+        encoded_.first_rows.push_back(long(chunk_rows_.size()));
+        for (size_t c = 0; c < tokenizer_output_.chunk_counts[b]; ++c) {
+            chunk_rows_.push_back(long(b * chunk_count_ + c));
+        }
+    }
+    const long row_count_ = long(chunk_rows_.size());
 
     // adapt token tensor dtype to the text encoder's declared input:
     // tokenizer emits int32 (legacy exports expect that), newer exports
     // (e.g. SD v2.x via optimum) declare int64 input_ids
     ONNXTensorElementDataType ids_type_ = model_input_element_type(0);
-
-    // legacy exports expose exactly [last_hidden_state, pooler_output];
-    // SDXL-style exports additionally dump every hidden_states.N layer and
-    // must be run with ORT-allocated outputs, selecting layers by name
-    const bool legacy_outputs_ = (model_output_count() <= 2);
-
-    std::string hidden_pick_ = "last_hidden_state";
-    if (!legacy_outputs_ && sd_clip_config.use_penultimate) {
-        long layer_count_ = 0;
-        for (size_t o_ = 0; o_ < model_output_count(); ++o_) {
-            if (model_output_name(o_).rfind("hidden_states.", 0) == 0) layer_count_++;
+    const bool ids_int64_ = (ids_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64);
+    const int32_t *token_data_ = tokenizer_output_.tokens.GetTensorData<int32_t>();
+    TensorShape ids_shape_ = {row_count_, token_size_};
+    Tensor ids_ = ids_int64_ ? TensorHelper::allocate<int64_t>(ids_shape_) : TensorHelper::allocate<int32_t>(ids_shape_);
+    for (long r = 0; r < row_count_; ++r) {
+        const int32_t *row_ = token_data_ + chunk_rows_[r] * token_size_;
+        if (ids_int64_) {
+            std::copy(row_, row_ + token_size_, ids_.GetTensorMutableData<int64_t>() + r * token_size_);
+        } else {
+            std::copy(row_, row_ + token_size_, ids_.GetTensorMutableData<int32_t>() + r * token_size_);
         }
-        hidden_pick_ = "hidden_states." + std::to_string(std::max(0L, layer_count_ - 2));
     }
 
-    std::vector<Tensor> merged_hidden_;
-    Tensor pooled_ = TensorHelper::create(TensorShape{0}, std::vector<float>{});
-    for (auto &tw_pair_: tokenizer_output_) {           // major_hidden_dim = 768 in SD, 1280 in SDXL
-        Tensor &tokens_ = tw_pair_.first;               // [1, 77]
-        Tensor &weight_ = tw_pair_.second;              // [1, 77]
+    select_outputs();
+    if (clip_hidden_at >= model_output_count()) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: clip hidden output not found"));
+    }
+    std::vector<size_t> output_index_ = {clip_hidden_at};
+    if (clip_pooled_at < model_output_count()) output_index_.push_back(clip_pooled_at);
+
+    // every chunk in one run when the export has a dynamic batch axis, else one run per chunk
+    TensorShape declared_ids_ = model_input_shape(0);
+    const bool batched_ = (declared_ids_.size() == 2 && declared_ids_[0] < 0);
+    const long run_size_ = batched_ ? row_count_ : 1;
 
+    // selected outputs of every run land straight in one [R, ...] buffer each
+    std::vector<Tensor> selected_;
+    generate_output(selected_, row_count_);
+    const Tensor &hidden_all_ = selected_[0];
+    const TensorShape hidden_shape_ = hidden_all_.GetTensorTypeAndShapeInfo().GetShape();
+    const TensorShape pooled_shape_ = (selected_.size() > 1) ?
+                                      selected_[1].GetTensorTypeAndShapeInfo().GetShape() : TensorShape{};
+    for (long run_at_ = 0; run_at_ < row_count_; run_at_ += run_size_) {
+        const long run_index_ = run_at_ / run_size_;
         std::vector<Tensor> input_tensors;
-        if (ids_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64) {
-            input_tensors.emplace_back(TensorHelper::cast<int64_t, int32_t>(tokens_));
-        } else {
-            input_tensors.emplace_back(TensorHelper::clone<int32_t>(tokens_)); // [vocab_size, major_hidden_dim]
+        input_tensors.emplace_back(ids_int64_ ?
+            TensorHelper::view<int64_t>(ids_, run_index_, {run_size_, token_size_}) :
+            TensorHelper::view<int32_t>(ids_, run_index_, {run_size_, token_size_})
+        );
+        std::vector<Tensor> output_tensors;
+        output_tensors.emplace_back(TensorHelper::view<float>(hidden_all_, run_index_, {run_size_, hidden_shape_[1], hidden_shape_[2]}));
+        if (selected_.size() > 1) {
+            output_tensors.emplace_back(TensorHelper::view<float>(selected_[1], run_index_, {run_size_, pooled_shape_[1]}));
         }
+        execute(input_tensors, output_tensors, output_index_);
+    }
 
-        Tensor hidden_ = TensorHelper::create(TensorShape{0}, std::vector<float>{});
-        if (legacy_outputs_) {
-            std::vector<Tensor> output_tensors;         // [1, 77, major_hidden_dim]
-            generate_output(output_tensors);
-            execute(input_tensors, output_tensors);
-            hidden_ = std::move(output_tensors[0]);
-            if (!TensorHelper::have_data(pooled_) && output_tensors.size() > 1) {
-                pooled_ = TensorHelper::clone<float>(output_tensors[1]);
-            }
-        } else {
-            std::vector<Tensor> output_tensors = execute_alloc(input_tensors);
-            for (size_t o_ = 0; o_ < output_tensors.size(); ++o_) {
-                const std::string name_ = model_output_name(o_);
-                if (name_ == hidden_pick_) {
-                    hidden_ = TensorHelper::clone<float>(output_tensors[o_]);
-                } else if (name_ == "pooler_output" || name_ == "text_embeds") {
-                    pooled_ = TensorHelper::clone<float>(output_tensors[o_]);
-                }
-            }
-        }
-        if (!TensorHelper::have_data(hidden_)) {
-            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: clip hidden output not found"));
-        }
+    encoded_.hidden = std::move(selected_[0]);
+    if (selected_.size() > 1) encoded_.pooled = std::move(selected_[1]);
+    return encoded_;
+}
+
+TensorShape Clip::hidden_shape(const ClipEncodedBatch &encoded_, size_t prompt_) const {
+    const TensorShape row_shape_ = encoded_.hidden.GetTensorTypeAndShapeInfo().GetShape();
+    const long chunks_ = long(encoded_.tokens.chunk_counts[prompt_]);
+    return {1, row_shape_[1] * chunks_, row_shape_[2]};
+}
+
+// prompt_'s chunks, weighted and mean re-normalized each, written one after another on the
+// sequence dim of target_ [1, 77 * N, D_total], in the columns [column_at_, column_at_ + hidden_dim)
+void Clip::write_hidden(const ClipEncodedBatch &encoded_, size_t prompt_, Tensor &target_, long column_at_) const {
+    const TensorShape row_shape_ = encoded_.hidden.GetTensorTypeAndShapeInfo().GetShape();
+    const TensorShape target_shape_ = target_.GetTensorTypeAndShapeInfo().GetShape();
+    const long token_size_ = long(row_shape_[1]);
+    const long hidden_dim_ = long(row_shape_[2]);
+    const long chunks_ = long(encoded_.tokens.chunk_counts[prompt_]);
+    if (target_shape_.size() != 3 || target_shape_[1] != token_size_ * chunks_ ||
+        column_at_ < 0 || column_at_ + hidden_dim_ > target_shape_[2]) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: clip hidden target shape mismatch"));
+    }
 
-        merged_hidden_.push_back(                       // [1, 77, major_hidden_dim]
-            TensorHelper::weight<float>(hidden_, weight_, 1, true)
+    const long target_dim_ = long(target_shape_[2]);
+    float *target_data_ = target_.GetTensorMutableData<float>();
+    for (long c = 0; c < chunks_; ++c) {
+        const long row_ = encoded_.first_rows[prompt_] + c;
+        Tensor hidden_ = TensorHelper::view<float>(encoded_.hidden, row_, {1, token_size_, hidden_dim_});
+        Tensor weight_ = TensorHelper::view<float>(encoded_.tokens.multis, encoded_.token_rows[row_], {1, token_size_});
+        TensorHelper::weight_into<float>(
+            hidden_, weight_, 1, true,
+            target_data_ + c * token_size_ * target_dim_ + column_at_, target_dim_
         );
     }
-    // seems not right
-    Tensor hidden_state_ = TensorHelper::merge<float>(merged_hidden_, 1);  // [1, 77 * N, major_hidden_dim]
+}
 
-    return {std::move(hidden_state_), std::move(pooled_)};
+// pooled conditioning from the prompt's first chunk (as A1111 / ComfyUI), empty when not provided
+Tensor Clip::pooled(const ClipEncodedBatch &encoded_, size_t prompt_) const {
+    if (!TensorHelper::have_data(encoded_.pooled)) return TensorHelper::empty<float>();
+    const long pooled_dim_ = long(encoded_.pooled.GetTensorTypeAndShapeInfo().GetShape().back());
+    return TensorHelper::clone<float>(
+        TensorHelper::view<float>(encoded_.pooled, encoded_.first_rows[prompt_], {1, pooled_dim_})
+    );
+}
+
+std::vector<ClipEmbedResult> Clip::embedding(const std::vector<std::string>& prompts_) {
+    ClipEncodedBatch encoded_ = encode(prompts_);
+    std::vector<ClipEmbedResult> results_(prompts_.size());
+    for (size_t b = 0; b < prompts_.size(); ++b) {
+        // [1, 77 * N, major_hidden_dim]
+        results_[b].hidden = TensorHelper::allocate<float>(hidden_shape(encoded_, b));
+        write_hidden(encoded_, b, results_[b].hidden, 0);
+        results_[b].pooled = pooled(encoded_, b);
+    }
+    return results_;
 }
 
 } // namespace units
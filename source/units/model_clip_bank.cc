@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2018-2050 SD_Clip Embedding Bank - Arikan.Li
+ * Created by Arikan.Li on 2026/10/19.
+ */
+#ifndef MODEL_CLIP_BANK_H
+#define MODEL_CLIP_BANK_H
+
+#include "model_clip.cc"
+
+namespace onnx {
+namespace sd {
+namespace units {
+
+using namespace base;
+using namespace amon;
+using namespace tokenizer;
+
+/**
+ * Precompiled prompt conditioning (*.adeb): the final ClipEmbedResult of every prompt in a
+ * fixed catalog (presets, stock negatives), keyed by prompt hash, for one encoder fingerprint.
+ * The file is memory-mapped (MappedFile::share) and a lookup is a binary search plus one copy
+ * of the matched rows, so a hit skips tokenization and text encoding, and the text encoders
+ * are only loaded once a prompt misses.
+ *
+ * Layout, host byte order (a foreign-endian file fails the magic check):
+ *   BankHeader | sections, each 16-byte aligned, in BankSectionType order
+ * Entries are sorted by (prompt hash, text); the prompt text is kept and compared, so a hash
+ * collision is a miss, never a wrong embedding.
+ */
+class ClipEmbeddingBank {
+public:
+    static constexpr uint32_t SD_BANK_MAGIC = 0x42454441;       // "ADEB"
+    static constexpr uint32_t SD_BANK_VERSION = 1;
+
+private:
+    enum BankSectionType {
+        BANK_ENTRIES = 0,
+        BANK_TEXT,
+        BANK_VALUES,
+        BANK_SECTION_COUNT,
+    };
+
+    typedef struct BankSection {
+        uint64_t offset;
+        uint64_t count;                         // elements, not bytes
+    } BankSection;
+
+    typedef struct BankHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t file_size;
+        uint64_t encoder_hash;
+        BankSection sections[BANK_SECTION_COUNT];
+    } BankHeader;
+
+    typedef struct BankEntry {
+        uint64_t prompt_hash;
+        uint64_t text_offset;                   // into BANK_TEXT
+        uint64_t text_length;
+        uint64_t hidden_offset;                 // into BANK_VALUES, [1, hidden_rows, hidden_dim]
+        uint32_t hidden_rows;
+        uint32_t hidden_dim;
+        uint64_t pooled_offset;                 // into BANK_VALUES, [1, pooled_dim], 0 dim when none
+        uint32_t pooled_dim;
+        uint32_t reserved;
+    } BankEntry;
+
+    static constexpr uint64_t SD_BANK_ALIGN = 16;
+
+    std::shared_ptr<const MappedFile> bank_mapped;
+    const BankEntry *bank_entries = nullptr;
+    size_t bank_entry_count = 0;
+    const char *bank_text = nullptr;
+    const float *bank_values = nullptr;
+
+    template<typename T>
+    static const T *section_at(const BankHeader &header_, const uint8_t *data_, BankSectionType type_) {
+        const BankSection &section_ = header_.sections[type_];
+        bool in_bounds_ = (section_.offset % SD_BANK_ALIGN == 0) &&
+                          (section_.offset <= header_.file_size) &&
+                          (section_.count <= (header_.file_size - section_.offset) / sizeof(T));
+        return in_bounds_ ? reinterpret_cast<const T *>(data_ + section_.offset) : nullptr;
+    }
+
+    static uint64_t hash_bytes(const void *data_, size_t size_, uint64_t hash_ = 0xCBF29CE484222325ull) {  // FNV-1a 64
+        auto bytes_ = static_cast<const uint8_t *>(data_);
+        for (size_t i = 0; i < size_; ++i) { hash_ ^= bytes_[i]; hash_ *= 0x100000001B3ull; }
+        return hash_;
+    }
+
+    // size plus strided samples of the content: enough to tell checkpoints apart without
+    // reading gigabytes of weights on every start
+    static uint64_t hash_file(const std::string &file_path_, uint64_t hash_) {
+        std::ifstream file_(file_path_, std::ios::binary | std::ios::ate);
+        if (!file_) return hash_bytes("-", 1, hash_);
+        auto file_size_ = uint64_t(file_.tellg());
+        hash_ = hash_bytes(&file_size_, sizeof(file_size_), hash_);
+
+        const uint64_t window_ = 64 * 1024;
+        const uint64_t samples_ = 16;
+        std::vector<char> buffer_(window_);
+        for (uint64_t s = 0; s <= samples_; ++s) {
+            uint64_t at_ = (file_size_ > window_) ? (file_size_ - window_) / samples_ * s : 0;
+            file_.seekg(std::streamoff(at_));
+            file_.read(buffer_.data(), std::streamsize(std::min(window_, file_size_)));
+            hash_ = hash_bytes(buffer_.data(), size_t(file_.gcount()), hash_);
+            file_.clear();
+            if (file_size_ <= window_) break;
+        }
+        return hash_;
+    }
+
+public:
+    static uint64_t prompt_hash(const std::string &prompt_) {
+        return hash_bytes(prompt_.data(), prompt_.size());
+    }
+
+    /**
+     * @details Fingerprint of everything a prompt's conditioning depends on: the text encoder
+     *          model files (with external weight files next to them, e.g. model.onnx_data),
+     *          their precision, the tokenizer files and the settings that shape chunking and weighting
+     * @param encoder_paths_ text encoder models in conditioning order (clip, clip_2)
+     * @param tokenizer_config_ tokenizer shared by the encoders
+     * @param encoder_precision_ precision the encoders run at
+     * @return hash stored in, and checked against, every bank
+     */
+    static uint64_t encoder_hash(const std::vector<std::string> &encoder_paths_, const TokenizerConfig &tokenizer_config_,
+                                 PrecisionType encoder_precision_) {
+        uint64_t hash_ = hash_bytes(&SD_BANK_VERSION, sizeof(SD_BANK_VERSION));
+        for (const std::string &path_ : encoder_paths_) {
+            hash_ = hash_file(path_, hash_);
+            std::error_code fs_error_;
+            std::filesystem::path model_path_(path_);
+            std::vector<std::string> siblings_;
+            for (const auto &sibling_ : std::filesystem::directory_iterator(model_path_.parent_path().empty() ? "." : model_path_.parent_path(), fs_error_)) {
+                std::string name_ = sibling_.path().filename().string();
+                if (name_ != model_path_.filename().string() && name_.rfind(model_path_.filename().string(), 0) == 0) {
+                    siblings_.push_back(sibling_.path().string());
+                }
+            }
+            std::sort(siblings_.begin(), siblings_.end());
+            for (const std::string &sibling_ : siblings_) hash_ = hash_file(sibling_, hash_);
+        }
+        hash_ = hash_file(tokenizer_config_.tokenizer_dictionary_at, hash_);
+        hash_ = hash_file(tokenizer_config_.tokenizer_aggregates_at, hash_);
+        const float factors_[] = {
+            tokenizer_config_.major_boundary_factor,
+            tokenizer_config_.txt_attn_increase_factor,
+            tokenizer_config_.txt_attn_decrease_factor
+        };
+        const int64_t settings_[] = {
+            int64_t(tokenizer_config_.tokenizer_type),
+            int64_t(tokenizer_config_.avail_token_size),
+            int64_t(encoder_paths_.size()),
+            int64_t(encoder_precision_)
+        };
+        hash_ = hash_bytes(factors_, sizeof(factors_), hash_);
+        return hash_bytes(settings_, sizeof(settings_), hash_);
+    }
+
+    /**
+     * @details Write prompt conditionings into a bank
+     * @param encoder_hash_ encoder_hash() of the encoders that produced embeds_
+     * @param prompts_ catalog prompts, without repeats
+     * @param embeds_ conditioning of each prompt, as prepare() builds it
+     * @param bank_path_ destination file
+     * @return false when the file cannot be written
+     */
+    static bool compile(uint64_t encoder_hash_, const std::vector<std::string> &prompts_,
+                        const std::vector<ClipEmbedResult> &embeds_, const std::string &bank_path_) {
+        std::vector<uint64_t> hashes_(prompts_.size());
+        std::transform(prompts_.begin(), prompts_.end(), hashes_.begin(), prompt_hash);
+        std::vector<size_t> order_(prompts_.size());
+        std::iota(order_.begin(), order_.end(), size_t(0));
+        std::sort(order_.begin(), order_.end(), [&prompts_, &hashes_](size_t l_, size_t r_) {
+            return (hashes_[l_] != hashes_[r_]) ? (hashes_[l_] < hashes_[r_]) : (prompts_[l_] < prompts_[r_]);
+        });
+
+        std::vector<BankEntry> entries_;
+        std::string text_;
+        uint64_t value_count_ = 0;
+        for (size_t i : order_) {
+            const TensorShape hidden_shape_ = embeds_[i].hidden.GetTensorTypeAndShapeInfo().GetShape();
+            if (hidden_shape_.size() != 3) {
+                amon_report(class_exception(EXC_LOG_ERR, "ERROR:: embedding bank needs [1, rows, dim] conditioning"));
+                return false;
+            }
+            BankEntry entry_{};
+            entry_.prompt_hash = hashes_[i];
+            entry_.text_offset = text_.size();
+            entry_.text_length = prompts_[i].size();
+            entry_.hidden_offset = value_count_;
+            entry_.hidden_rows = uint32_t(hidden_shape_[1]);
+            entry_.hidden_dim = uint32_t(hidden_shape_[2]);
+            value_count_ += uint64_t(entry_.hidden_rows) * entry_.hidden_dim;
+            entry_.pooled_offset = value_count_;
+            if (TensorHelper::have_data(embeds_[i].pooled)) {
+                entry_.pooled_dim = uint32_t(embeds_[i].pooled.GetTensorTypeAndShapeInfo().GetElementCount());
+                value_count_ += entry_.pooled_dim;
+            }
+            text_ += prompts_[i];
+            entries_.push_back(entry_);
+        }
+
+        BankHeader header_{};
+        header_.magic = SD_BANK_MAGIC;
+        header_.version = SD_BANK_VERSION;
+        header_.encoder_hash = encoder_hash_;
+        const uint64_t counts_[BANK_SECTION_COUNT] = {entries_.size(), text_.size(), value_count_};
+        const uint64_t element_sizes_[BANK_SECTION_COUNT] = {sizeof(BankEntry), sizeof(char), sizeof(float)};
+        uint64_t offset_ = sizeof(BankHeader);
+        for (int i = 0; i < BANK_SECTION_COUNT; ++i) {
+            offset_ = (offset_ + SD_BANK_ALIGN - 1) / SD_BANK_ALIGN * SD_BANK_ALIGN;
+            header_.sections[i] = {offset_, counts_[i]};
+            offset_ += counts_[i] * element_sizes_[i];
+        }
+        header_.file_size = offset_;
+
+        // written aside and renamed over, a worker may still have the previous bank mapped
+        const std::string staging_path_ = bank_path_ + ".tmp";
+        std::ofstream file_(staging_path_, std::ios::binary);
+        if (!file_) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: embedding bank not writable"));
+            return false;
+        }
+        const char padding_[SD_BANK_ALIGN] = {};
+        auto pad_to_ = [&file_, &padding_](uint64_t offset_) {
+            file_.write(padding_, std::streamsize(offset_ - uint64_t(file_.tellp())));
+        };
+        file_.write(reinterpret_cast<const char *>(&header_), sizeof(BankHeader));
+        pad_to_(header_.sections[BANK_ENTRIES].offset);
+        file_.write(reinterpret_cast<const char *>(entries_.data()), std::streamsize(entries_.size() * sizeof(BankEntry)));
+        pad_to_(header_.sections[BANK_TEXT].offset);
+        file_.write(text_.data(), std::streamsize(text_.size()));
+        pad_to_(header_.sections[BANK_VALUES].offset);
+        for (size_t k = 0; k < order_.size(); ++k) {
+            const ClipEmbedResult &embed_ = embeds_[order_[k]];
+            file_.write(reinterpret_cast<const char *>(embed_.hidden.GetTensorData<float>()),
+                        std::streamsize(uint64_t(entries_[k].hidden_rows) * entries_[k].hidden_dim * sizeof(float)));
+            if (entries_[k].pooled_dim > 0) {
+                file_.write(reinterpret_cast<const char *>(embed_.pooled.GetTensorData<float>()),
+                            std::streamsize(entries_[k].pooled_dim * sizeof(float)));
+            }
+        }
+        file_.close();
+        std::error_code fs_error_;
+        if (!file_.fail()) std::filesystem::rename(staging_path_, bank_path_, fs_error_);
+        if (file_.fail() || fs_error_) {
+            std::filesystem::remove(staging_path_, fs_error_);
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: embedding bank not writable"));
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @details Map a bank and serve lookups from it
+     * @param bank_path_ compiled bank
+     * @param encoder_hash_ encoder_hash() of the configured encoders
+     * @return false (bank left empty) when the file is missing, malformed or was
+     *         compiled for other encoders
+     */
+    bool attach(const std::string &bank_path_, uint64_t encoder_hash_) {
+        clear();
+        std::shared_ptr<const MappedFile> mapped_ = MappedFile::share(bank_path_);
+        if (!mapped_ || mapped_->size() < sizeof(BankHeader)) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: embedding bank not readable"));
+            return false;
+        }
+        BankHeader header_{};
+        std::memcpy(&header_, mapped_->data(), sizeof(BankHeader));
+        if (header_.magic != SD_BANK_MAGIC || header_.version != SD_BANK_VERSION ||
+            header_.file_size != mapped_->size()) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: embedding bank has an unknown format"));
+            return false;
+        }
+        if (header_.encoder_hash != encoder_hash_) {
+            amon_report(class_exception(EXC_LOG_WARN, "WARNING:: embedding bank compiled for other text encoders, ignored"));
+            return false;
+        }
+
+        const uint8_t *data_ = mapped_->data();
+        const auto *entries_ = section_at<BankEntry>(header_, data_, BANK_ENTRIES);
+        const auto *text_ = section_at<char>(header_, data_, BANK_TEXT);
+        const auto *values_ = section_at<float>(header_, data_, BANK_VALUES);
+        if (!entries_ || !text_ || !values_) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: embedding bank sections out of bounds"));
+            return false;
+        }
+        const uint64_t text_size_ = header_.sections[BANK_TEXT].count;
+        const uint64_t value_count_ = header_.sections[BANK_VALUES].count;
+        for (uint64_t i = 0; i < header_.sections[BANK_ENTRIES].count; ++i) {
+            const BankEntry &entry_ = entries_[i];
+            uint64_t hidden_size_ = uint64_t(entry_.hidden_rows) * entry_.hidden_dim;
+            bool in_bounds_ = entry_.text_offset <= text_size_ && entry_.text_length <= text_size_ - entry_.text_offset &&
+                              entry_.hidden_offset <= value_count_ && hidden_size_ <= value_count_ - entry_.hidden_offset &&
+                              entry_.pooled_offset <= value_count_ && entry_.pooled_dim <= value_count_ - entry_.pooled_offset;
+            if (!in_bounds_) {
+                amon_report(class_exception(EXC_LOG_ERR, "ERROR:: embedding bank entry out of bounds"));
+                return false;
+            }
+        }
+
+        bank_mapped = std::move(mapped_);
+        bank_entries = entries_;
+        bank_entry_count = size_t(header_.sections[BANK_ENTRIES].count);
+        bank_text = text_;
+        bank_values = values_;
+        return true;
+    }
+
+    /**
+     * @details Conditioning of a catalog prompt, copied out of the mapping
+     * @param prompt_ prompt exactly as passed to prepare()
+     * @param result_ hidden [1, 77 * N, hidden_dim] and pooled [1, pooled_dim] (empty when none)
+     * @return false when the prompt is not in the bank
+     */
+    bool find(const std::string &prompt_, ClipEmbedResult &result_) const {
+        if (bank_entry_count == 0) return false;
+        const uint64_t hash_ = prompt_hash(prompt_);
+        const BankEntry *end_ = bank_entries + bank_entry_count;
+        const BankEntry *at_ = std::lower_bound(bank_entries, end_, hash_, [](const BankEntry &entry_, uint64_t key_) {
+            return entry_.prompt_hash < key_;
+        });
+        for (; at_ != end_ && at_->prompt_hash == hash_; ++at_) {
+            std::string_view text_(bank_text + at_->text_offset, at_->text_length);
+            if (text_ != prompt_) continue;
+
+            const long rows_ = long(at_->hidden_rows);
+            const long dim_ = long(at_->hidden_dim);
+            result_.hidden = TensorHelper::allocate<float>(TensorShape{1, rows_, dim_});
+            const float *hidden_ = bank_values + at_->hidden_offset;
+            std::copy(hidden_, hidden_ + rows_ * dim_, result_.hidden.GetTensorMutableData<float>());
+            if (at_->pooled_dim > 0) {
+                result_.pooled = TensorHelper::allocate<float>(TensorShape{1, long(at_->pooled_dim)});
+                const float *pooled_ = bank_values + at_->pooled_offset;
+                std::copy(pooled_, pooled_ + at_->pooled_dim, result_.pooled.GetTensorMutableData<float>());
+            } else {
+                result_.pooled = TensorHelper::empty<float>();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    size_t size() const { return bank_entry_count; }
+    bool empty() const { return bank_entry_count == 0; }
+
+    void clear() {
+        bank_mapped.reset();
+        bank_entries = nullptr;
+        bank_entry_count = 0;
+        bank_text = nullptr;
+        bank_values = nullptr;
+    }
+};
+
+} // namespace units
+} // namespace sd
+} // namespace onnx
+
+#endif //MODEL_CLIP_BANK_H
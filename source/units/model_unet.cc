@@ -26,7 +26,9 @@ using namespace detail;
         /*sd_input_height*/     512,                                 \
         /*sd_input_channel*/    4,                                   \
         /*sd_scale_guidance*/   7.5f,                                \
-        /*sd_random_intensity*/ 1.0f                                 \
+        /*sd_random_intensity*/ 1.0f,                                \
+        /*sd_img2img_strength*/ 1.0f,                                \
+        /*sd_guidance_config*/  DEFAULT_GUIDANCE_CONFIG              \
     }                                                                \
 
 typedef struct ModelUNetConfig {
@@ -37,15 +39,47 @@ typedef struct ModelUNetConfig {
     uint64_t sd_input_channel;
     float sd_scale_guidance;
     float sd_random_intensity;
+    float sd_img2img_strength;      // img2img only: fraction of the schedule to run, (0, 1); else full
+    GuidanceConfig sd_guidance_config;
 } ModelUNetConfig;
 
+// overrides for the remaining steps of a resumed trajectory snapshot
+typedef struct UNetResume {
+    int64_t sd_seed;                // noise of the remaining steps, -1 keeps the snapshot's
+    float sd_scale_guidance;        // 0 keeps the snapshot's
+    uint64_t sd_inference_steps;    // re-grid the rest to this base step count, 0 keeps the snapshot's schedule
+    bool sd_use_conditioning;       // true: the given embeddings replace the snapshot's
+} UNetResume;
+
 class UNet : public ModelBase {
 private:
+    static constexpr uint32_t SD_SNAPSHOT_MAGIC   = 0x50414E53;     // "SNAP"
+    static constexpr uint32_t SD_SNAPSHOT_VERSION = 1;
+
     ModelUNetConfig sd_unet_config = DEFAULT_UNET_CONFIG;
-    SchedulerEntity_ptr sd_scheduler_p;
+    SchedulerLease sd_scheduler_p;      // leased from the pool for one inference / resume
+
+    std::string sd_snapshot_path;       // armed for the next run only, empty when off
+    uint64_t sd_snapshot_step = 0;      // written before this evaluation index
+    bool sd_snapshot_stop = false;      // end the run once written (preemption)
+    bool sd_preempted = false;
+    uint64_t sd_unet_runs = 0;
 
 protected:
     void generate_output(std::vector<Tensor>& output_tensors_) override;
+    float guidance_scale(float progress_, float scale_) const;
+    static Tensor guidance_embedding(float scale_, int64_t embedding_dim_);
+
+    void save_snapshot(
+        const Tensor &embs_positive_, const Tensor &embs_negative_,
+        const Tensor &pooled_positive_, const Tensor &pooled_negative_,
+        const Tensor &latents_, int step_index_, float scale_guidance_
+    ) const;
+    Tensor denoise(
+        const Tensor &embs_positive_, const Tensor &embs_negative_,
+        const Tensor &pooled_positive_, const Tensor &pooled_negative_,
+        Tensor latents_, int start_index_, float scale_guidance_
+    );
 
 public:
     explicit UNet(const std::string &model_path_, const ModelUNetConfig &unet_config_ = DEFAULT_UNET_CONFIG);
@@ -56,15 +90,26 @@ public:
         const Tensor &pooled_positive_, const Tensor &pooled_negative_,
         const Tensor &encoded_img_
     );
+
+    // trajectory snapshots: K variations of one prompt share the first steps, long jobs can be preempted
+    void set_snapshot(const std::string &snapshot_path_, uint64_t snapshot_step_, bool snapshot_stop_);
+    Tensor resume(
+        const std::string &snapshot_path_, const UNetResume &resume_,
+        const Tensor &embs_positive_, const Tensor &embs_negative_,
+        const Tensor &pooled_positive_, const Tensor &pooled_negative_
+    );
+    // last run ended at its snapshot, the returned latent is not denoised
+    bool preempted() const { return sd_preempted; }
+    // UNet evaluations of the last run, positive and negative passes counted separately
+    uint64_t last_unet_runs() const { return sd_unet_runs; }
 };
 
 UNet::UNet(const std::string &model_path_, const ModelUNetConfig& unet_config_) : ModelBase(model_path_){
     sd_unet_config = unet_config_;
-    sd_scheduler_p = SchedulerRegister::request_scheduler(unet_config_.sd_scheduler_config);
 }
 
 UNet::~UNet(){
-    sd_scheduler_p = SchedulerRegister::recycle_scheduler(sd_scheduler_p);
+    sd_scheduler_p.reset();
     sd_unet_config.~ModelUNetConfig();
 }
 
@@ -83,6 +128,44 @@ void UNet::generate_output(std::vector<Tensor> &output_tensors_) {
     output_tensors_.emplace_back(TensorHelper::create(hidden_shape_, output_hidden_));
 }
 
+// progress_: fraction of the trajectory done, from the scheduler (σ-based for adaptive stepping)
+float UNet::guidance_scale(float progress_, float scale_) const {
+    const GuidanceConfig &guidance_ = sd_unet_config.sd_guidance_config;
+    const float start_ = std::max(guidance_.sd_guidance_start, 0.0f);
+    const float end_ = (guidance_.sd_guidance_end <= 0.0f) ? 1.0f : std::min(guidance_.sd_guidance_end, 1.0f);
+    const float at_ = progress_;
+    if (scale_ <= 1 || at_ < start_ || at_ >= end_) {
+        return 1.0f;    // outside the window: positive prediction only
+    }
+
+    // position inside the window, 0 at its start
+    const float u_ = (at_ - start_) / (end_ - start_);
+    switch (guidance_.sd_guidance_schedule) {
+        case GUIDANCE_SCHEDULE_LINEAR:
+            return 1.0f + (scale_ - 1.0f) * (1.0f - u_);
+        case GUIDANCE_SCHEDULE_COSINE:
+            return 1.0f + (scale_ - 1.0f) * 0.5f * (1.0f + std::cos(float(M_PI) * u_));
+        case GUIDANCE_SCHEDULE_CONSTANT:
+        default:
+            return scale_;
+    }
+}
+
+// LCM w-embedding (as diffusers get_guidance_scale_embedding): sin|cos of (scale - 1) * 1000
+// over embedding_dim_ / 2 log-spaced frequencies, odd dims zero padded
+Tensor UNet::guidance_embedding(float scale_, int64_t embedding_dim_) {
+    std::vector<float> embedding_(embedding_dim_, 0.0f);
+    const int64_t half_dim_ = embedding_dim_ / 2;
+    const float w_ = (scale_ - 1.0f) * 1000.0f;
+    const float exponent_ = (half_dim_ > 1) ? std::log(10000.0f) / float(half_dim_ - 1) : 0.0f;
+    for (int64_t k = 0; k < half_dim_; ++k) {
+        float angle_ = w_ * std::exp(-exponent_ * float(k));
+        embedding_[k] = std::sin(angle_);
+        embedding_[half_dim_ + k] = std::cos(angle_);
+    }
+    return TensorHelper::create(TensorShape{1, embedding_dim_}, embedding_);
+}
+
 Tensor UNet::inference(
     const Tensor &embs_positive_,
     const Tensor &embs_negative_,
@@ -93,9 +176,112 @@ Tensor UNet::inference(
     int w_ = int(sd_unet_config.sd_input_width);
     int h_ = int(sd_unet_config.sd_input_height);
     int c_ = int(sd_unet_config.sd_input_channel);
-    const bool need_guidance_ = (sd_unet_config.sd_scale_guidance > 1);
-    const uint64_t working_steps_ = sd_scheduler_p->init(sd_unet_config.sd_inference_steps);
+    // img2img strength truncates the schedule: the encoded image is noised to the first kept σ
+    // and only the remaining steps are evaluated
+    const float strength_ = TensorHelper::have_data(encoded_img_) ? sd_unet_config.sd_img2img_strength : 1.0f;
+    sd_scheduler_p = SchedulerRegister::lease_scheduler(sd_unet_config.sd_scheduler_config);
+    sd_scheduler_p->init(sd_unet_config.sd_inference_steps, strength_);
+
+    TensorShape latent_shape_{1, c_, h_, w_};
+    std::vector<float> latent_empty_(c_ * h_ * w_, 0.0f);
+    Tensor latents_ = (TensorHelper::have_data(encoded_img_)) ?
+                      TensorHelper::clone<float>(encoded_img_, latent_shape_) :
+                      TensorHelper::create(latent_shape_, latent_empty_);
+    Tensor init_mask_ = sd_scheduler_p->mask(latent_shape_);
+    latents_ = TensorHelper::add<float>(latents_, init_mask_, latent_shape_);
+
+    return denoise(
+        embs_positive_, embs_negative_, pooled_positive_, pooled_negative_,
+        std::move(latents_), 0, sd_unet_config.sd_scale_guidance
+    );
+}
+
+void UNet::set_snapshot(const std::string &snapshot_path_, uint64_t snapshot_step_, bool snapshot_stop_) {
+    sd_snapshot_path = snapshot_path_;
+    sd_snapshot_step = snapshot_step_;
+    sd_snapshot_stop = snapshot_stop_;
+}
+
+// layout: magic, version, next evaluation index, its σ, guidance scale, latent,
+// conditioning (positive, negative, pooled positive, pooled negative), scheduler state
+void UNet::save_snapshot(
+    const Tensor &embs_positive_, const Tensor &embs_negative_,
+    const Tensor &pooled_positive_, const Tensor &pooled_negative_,
+    const Tensor &latents_, int step_index_, float scale_guidance_
+) const {
+    StateWriter writer_;
+    writer_.put<uint32_t>(SD_SNAPSHOT_MAGIC);
+    writer_.put<uint32_t>(SD_SNAPSHOT_VERSION);
+    writer_.put<int64_t>(step_index_);
+    writer_.put<float>(sd_scheduler_p->sigma(step_index_));
+    writer_.put<float>(scale_guidance_);
+    writer_.put(latents_);
+    writer_.put(embs_positive_);
+    writer_.put(embs_negative_);
+    writer_.put(pooled_positive_);
+    writer_.put(pooled_negative_);
+    sd_scheduler_p->save_state(writer_);
+    if (!writer_.save(sd_snapshot_path)) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: trajectory snapshot not writable"));
+    }
+}
 
+Tensor UNet::resume(
+    const std::string &snapshot_path_, const UNetResume &resume_,
+    const Tensor &embs_positive_, const Tensor &embs_negative_,
+    const Tensor &pooled_positive_, const Tensor &pooled_negative_
+) {
+    StateReader reader_ = StateReader::load(snapshot_path_);
+    if (reader_.get<uint32_t>() != SD_SNAPSHOT_MAGIC || reader_.get<uint32_t>() != SD_SNAPSHOT_VERSION) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: not a trajectory snapshot"));
+    }
+    int step_index_ = int(reader_.get<int64_t>());
+    float latent_sigma_ = reader_.get<float>();
+    float scale_guidance_ = reader_.get<float>();
+    Tensor latents_ = reader_.get_tensor();
+    Tensor saved_positive_ = reader_.get_tensor();
+    Tensor saved_negative_ = reader_.get_tensor();
+    Tensor saved_pooled_positive_ = reader_.get_tensor();
+    Tensor saved_pooled_negative_ = reader_.get_tensor();
+
+    TensorShape latent_shape_{
+        1, int64_t(sd_unet_config.sd_input_channel),
+        int64_t(sd_unet_config.sd_input_height), int64_t(sd_unet_config.sd_input_width)
+    };
+    if (!TensorHelper::have_data(latents_) || latents_.GetTensorTypeAndShapeInfo().GetShape() != latent_shape_) {
+        amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: snapshot latent does not match the UNet size"));
+    }
+
+    // same schedule: continue with the saved history and noise stream; other step count:
+    // enter the new grid at the latent's σ with fresh history, on the stream after the snapshot's
+    sd_scheduler_p = SchedulerRegister::lease_scheduler(sd_unet_config.sd_scheduler_config);
+    sd_scheduler_p->load_state(reader_);
+    if (resume_.sd_inference_steps > 0 && resume_.sd_inference_steps != sd_scheduler_p->inference_steps()) {
+        sd_scheduler_p->rebase(resume_.sd_inference_steps, latent_sigma_, sd_scheduler_p->request() + 1);
+        step_index_ = 0;
+    }
+    if (resume_.sd_seed != -1) sd_scheduler_p->reseed(resume_.sd_seed);
+    if (resume_.sd_scale_guidance > 0) scale_guidance_ = resume_.sd_scale_guidance;
+
+    const bool replaced_ = resume_.sd_use_conditioning && TensorHelper::have_data(embs_positive_);
+    return denoise(
+        replaced_ ? embs_positive_ : saved_positive_,
+        replaced_ ? embs_negative_ : saved_negative_,
+        replaced_ ? pooled_positive_ : saved_pooled_positive_,
+        replaced_ ? pooled_negative_ : saved_pooled_negative_,
+        std::move(latents_), step_index_, scale_guidance_
+    );
+}
+
+Tensor UNet::denoise(
+    const Tensor &embs_positive_,
+    const Tensor &embs_negative_,
+    const Tensor &pooled_positive_,
+    const Tensor &pooled_negative_,
+    Tensor latents_,
+    int start_index_,
+    float scale_guidance_
+) {
     // adapt timestep tensor to the UNet's declared input signature:
     // legacy exports take int64 {1}; newer exports (e.g. SD v2.x via optimum)
     // declare float scalar. Feeding a mismatched tensor makes ORT throw inside
@@ -110,10 +296,23 @@ Tensor UNet::inference(
         }
     }
 
+    // LCM / guidance-distilled UNets take the guidance scale as an extra trailing input
+    // (timestep_cond, [1, time_cond_proj_dim]): one pass per step, no negative prediction
+    const size_t w_cond_index_ = model_input_index("timestep_cond");
+    const bool w_conditioned_ = (w_cond_index_ < model_input_count());
+    int64_t w_cond_dim_ = 256;
+    if (w_conditioned_) {
+        TensorShape w_cond_shape_ = model_input_shape(w_cond_index_);
+        if (w_cond_shape_.size() == 2 && w_cond_shape_[1] > 0) w_cond_dim_ = w_cond_shape_[1];
+        if (w_cond_index_ + 1 != model_input_count()) {
+            amon_exception(basic_exception(EXC_LOG_ERR, "ERROR:: UNet timestep_cond must be the last model input"));
+        }
+    }
+
     // SDXL UNets declare 5 inputs (sample, timestep, encoder_hidden_states,
     // text_embeds, time_ids): micro-conditioning built from the pooled
     // embedding + [orig_h, orig_w, crop_top, crop_left, target_h, target_w]
-    const bool sdxl_conditioned_ = (model_input_count() >= 5);
+    const bool sdxl_conditioned_ = (model_input_count() - (w_conditioned_ ? 1 : 0) >= 5);
     Tensor time_ids_ = TensorHelper::create(TensorShape{0}, std::vector<float>{});
     if (sdxl_conditioned_) {
         std::vector<float> time_ids_value_ = {
@@ -121,79 +320,113 @@ Tensor UNet::inference(
             0.0f, 0.0f,
             float(sd_unet_config.sd_input_height * 8), float(sd_unet_config.sd_input_width * 8)
         };
-        time_ids_ = TensorHelper::create(TensorShape{1, 6}, time_ids_value_);
+        time_ids_ = adapt_input(4, TensorHelper::create(TensorShape{1, 6}, time_ids_value_));
     }
 
-    TensorShape latent_shape_{1, c_, h_, w_};
-    std::vector<float> latent_empty_(c_ * h_ * w_, 0.0f);
-    Tensor latents_ = (TensorHelper::have_data(encoded_img_)) ?
-                      TensorHelper::clone<float>(encoded_img_, latent_shape_) :
-                      TensorHelper::create(latent_shape_, latent_empty_);
-    Tensor init_mask_ = sd_scheduler_p->mask(latent_shape_);
-    latents_ = TensorHelper::add<float>(latents_, init_mask_, latent_shape_);
+    // loop-invariant conditioning: brought to the UNet's declared precision once (FP16/BF16
+    // exports), then bound by view on every step instead of cloned
+    Tensor bound_positive_ = TensorHelper::have_data(embs_positive_) ? adapt_input(2, embs_positive_) : TensorHelper::empty<float>();
+    Tensor bound_negative_ = TensorHelper::have_data(embs_negative_) ? adapt_input(2, embs_negative_) : TensorHelper::empty<float>();
+    Tensor bound_pooled_positive_ = sdxl_conditioned_ ? adapt_input(3, pooled_positive_) : TensorHelper::empty<float>();
+    Tensor bound_pooled_negative_ = sdxl_conditioned_ ? adapt_input(3, pooled_negative_) : TensorHelper::empty<float>();
+    Tensor bound_w_cond_ = TensorHelper::empty<float>();
+    float bound_w_scale_ = 0.0f;    // scale embedded in bound_w_cond_, rebuilt only when the schedule moves it
+
+    // fixed schedulers stop after their working steps, adaptive ones decide while stepping (at most that many)
+    const bool snapshot_armed_ = !sd_snapshot_path.empty();
+    bool snapshot_written_ = false;
+    sd_preempted = false;
+    uint64_t unet_runs_ = 0;
+    int i = start_index_;
+    for (; !sd_scheduler_p->finished(i); ++i) {
+        // snapshot before evaluation i: the latent sits at σ_i, history / noise stream as left by step i-1
+        if (snapshot_armed_ && uint64_t(i) == sd_snapshot_step) {
+            save_snapshot(embs_positive_, embs_negative_, pooled_positive_, pooled_negative_, latents_, i, scale_guidance_);
+            snapshot_written_ = true;
+            if (sd_snapshot_stop) {
+                sd_preempted = true;
+                break;
+            }
+        }
 
-    for (int i = 0; i < working_steps_; ++i) {
         Tensor model_latent_ = sd_scheduler_p->scale(latents_, i);
         Tensor timestep_ = sd_scheduler_p->time(i);
-        if (timestep_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+        if (TensorHelper::is_float_type(timestep_type_)) {
             float timestep_value_ = float(timestep_.GetTensorData<int64_t>()[0]);
             TensorShape timestep_shape_ = (timestep_rank_ == 0) ? TensorShape{} : TensorShape{1};
-            timestep_ = TensorHelper::create<float>(timestep_shape_, std::vector<float>{timestep_value_});
+            timestep_ = adapt_input(1, TensorHelper::create<float>(timestep_shape_, std::vector<float>{timestep_value_}));
+        }
+        Tensor bound_latent_ = adapt_input(0, model_latent_);
+
+        // CFG only inside the guidance window: outside it the negative pass is skipped;
+        // w-conditioned UNets get the scale embedded instead and never run the negative pass
+        const float merge_factor_ = guidance_scale(sd_scheduler_p->progress(i), scale_guidance_);
+        const bool need_guidance_ = !w_conditioned_ && (merge_factor_ > 1) && TensorHelper::have_data(embs_negative_);
+        if (w_conditioned_ && (!TensorHelper::have_data(bound_w_cond_) || merge_factor_ != bound_w_scale_)) {
+            bound_w_cond_ = adapt_input(w_cond_index_, guidance_embedding(merge_factor_, w_cond_dim_));
+            bound_w_scale_ = merge_factor_;
         }
-        auto clone_timestep_ = [&](const Tensor& t_) -> Tensor {
-            return (timestep_type_ == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) ?
-                   TensorHelper::clone<float_t>(t_) : TensorHelper::clone<int64_t>(t_);
-        };
 
         // do positive N_pos_embed_num times
         Tensor pred_positive_ = TensorHelper::create(TensorShape{0}, std::vector<float>{});
         if (TensorHelper::have_data(embs_positive_)) {
             std::vector<Tensor> input_tensors;
-            input_tensors.emplace_back(TensorHelper::clone<float_t>(model_latent_));
-            input_tensors.emplace_back(clone_timestep_(timestep_));
-            input_tensors.emplace_back(TensorHelper::clone<float_t>(embs_positive_));
+            input_tensors.emplace_back(TensorHelper::view(bound_latent_));
+            input_tensors.emplace_back(TensorHelper::view(timestep_));
+            input_tensors.emplace_back(TensorHelper::view(bound_positive_));
             if (sdxl_conditioned_) {
-                input_tensors.emplace_back(TensorHelper::clone<float_t>(pooled_positive_));
-                input_tensors.emplace_back(TensorHelper::clone<float_t>(time_ids_));
+                input_tensors.emplace_back(TensorHelper::view(bound_pooled_positive_));
+                input_tensors.emplace_back(TensorHelper::view(time_ids_));
+            }
+            if (w_conditioned_) {
+                input_tensors.emplace_back(TensorHelper::view(bound_w_cond_));
             }
             std::vector<Tensor> output_tensors;
             generate_output(output_tensors);
             execute(input_tensors, output_tensors);
             pred_positive_ = std::move(output_tensors[0]);
+            unet_runs_++;
         }
 
         // do negative N_neg_embed_num times
         Tensor pred_negative_ = TensorHelper::create(TensorShape{0}, std::vector<float>{});
-        if (TensorHelper::have_data(embs_negative_) && need_guidance_) {
+        if (need_guidance_) {
             std::vector<Tensor> input_tensors;
-            input_tensors.emplace_back(TensorHelper::clone<float_t>(model_latent_));
-            input_tensors.emplace_back(clone_timestep_(timestep_));
-            input_tensors.emplace_back(TensorHelper::clone<float_t>(embs_negative_));
+            input_tensors.emplace_back(TensorHelper::view(bound_latent_));
+            input_tensors.emplace_back(TensorHelper::view(timestep_));
+            input_tensors.emplace_back(TensorHelper::view(bound_negative_));
             if (sdxl_conditioned_) {
-                input_tensors.emplace_back(TensorHelper::clone<float_t>(pooled_negative_));
-                input_tensors.emplace_back(TensorHelper::clone<float_t>(time_ids_));
+                input_tensors.emplace_back(TensorHelper::view(bound_pooled_negative_));
+                input_tensors.emplace_back(TensorHelper::view(time_ids_));
             }
             std::vector<Tensor> output_tensors;
             generate_output(output_tensors);
             execute(input_tensors, output_tensors);
             pred_negative_ = std::move(output_tensors[0]);
+            unet_runs_++;
         }
 
         // Merge predictions
-        float merge_factor_ = sd_unet_config.sd_scale_guidance;
         Tensor guided_pred_ = (
             (need_guidance_) ?
             TensorHelper::guide<float>(pred_negative_, pred_positive_, merge_factor_) :
-            TensorHelper::clone<float>(pred_positive_, latent_shape_)
+            std::move(pred_positive_)
         );
 
         // Dnoise & Step
-        latents_ = sd_scheduler_p->step(latents_, guided_pred_, i, sd_unet_config.sd_random_intensity);
+        sd_scheduler_p->step(latents_, guided_pred_, i, sd_unet_config.sd_random_intensity);
 
-        CommonHelper::print_progress_bar(float(i + 1) / float(working_steps_));
+        CommonHelper::print_progress_bar(sd_scheduler_p->progress(i + 1));
+    }
+    sd_unet_runs = unet_runs_;
+    if (snapshot_armed_) {
+        if (!snapshot_written_) {
+            amon_report(class_exception(EXC_LOG_ERR, "ERROR:: snapshot step past the trajectory, nothing written"));
+        }
+        sd_snapshot_path.clear();
     }
 
-    sd_scheduler_p->uninit();
+    sd_scheduler_p.reset();     // back to the pool, reset() on the next lease
     return latents_;
 }
 
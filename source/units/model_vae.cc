@@ -42,8 +42,8 @@ public:
     explicit VAE(const std::string &model_path_, const ModelVAEsConfig &vae_config_ = DEFAULT_VAEs_CONFIG);
     ~VAE() override;
 
-    Tensor encode(const Tensor &inimage_);
-    Tensor decode(const Tensor &latents_);
+    Tensor encode(Tensor inimage_);            // inimage_ pixels already in [-1, 1], bound as-is
+    Tensor decode(const Tensor &latents_);     // returns raw decoder output in [-1, 1]
 };
 
 VAE::VAE(const std::string &model_path_, const ModelVAEsConfig &vae_config_) : ModelBase(model_path_){
@@ -69,10 +69,10 @@ void VAE::generate_output(std::vector<Tensor> &output_tensors_) {
     output_tensors_.emplace_back(TensorHelper::create(hidden_shape_, output_hidden_));
 }
 
-Tensor VAE::encode(const Tensor &inimage_) {
+Tensor VAE::encode(Tensor inimage_) {
     if (!TensorHelper::have_data(inimage_)) { return TensorHelper::empty<float>(); }
     std::vector<Tensor> input_tensors;
-    input_tensors.push_back(TensorHelper::multiple<float>(inimage_, 2.0f, -1.0f));
+    input_tensors.push_back(std::move(inimage_));
     std::vector<Tensor> output_tensors;
     generate_output(output_tensors);
     execute(input_tensors, output_tensors);
@@ -89,8 +89,7 @@ Tensor VAE::decode(const Tensor &latents_) {
     generate_output(output_tensors);
     execute(input_tensors, output_tensors);
 
-    Tensor result_ = TensorHelper::divide<float>(output_tensors.front(), 2.0f, +0.5f, true);
-    return result_;
+    return std::move(output_tensors.front());
 }
 
 
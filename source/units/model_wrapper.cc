@@ -9,6 +9,7 @@
 #include "model_unet.cc"
 #include "model_vae.cc"
 #include "model_clip.cc"
+#include "model_clip_bank.cc"
 
 namespace onnx {
 namespace sd {